@@ -9,6 +9,11 @@
 #import "MarkdownParser.h"
 #import "NSString+Additions.h"
 #import "NSAttributedString+Additions.h"
+#import "MarkdownParserBenchmarks.h"
+#import "MarkdownParserTests.h"
+#import "MarkdownParserHarness.h"
+#import "StringAdditionsBenchmarks.h"
+#import "StringAdditionsTests.h"
 
 @interface AppDelegate ()
 
@@ -62,7 +67,50 @@ static AppDelegate *_shared;
     
     NSAttributedString *result = [MarkdownParser attributedStringWithAttributedMarkdown:mdAttr];
     
-    [_markdownTextView.layoutManager.textStorage setAttributedString:result];
+    /// Localized markdown
+    ///     Comes from the blob that the "Precompile Markdown" build phase writes, so cmark doesn't run for it.
+    NSAttributedString *localized = [NSAttributedString attributedStringWithLocalizedCoolMarkdown:@"capture-toast.scroll.captured.body"];
+    NSMutableAttributedString *resultWithLocalized = result.mutableCopy;
+    if (localized != nil) {
+        [resultWithLocalized appendAttributedString:@"\n\n".attributed];
+        [resultWithLocalized appendAttributedString:localized];
+    }
+    
+    [_markdownTextView.layoutManager.textStorage setAttributedString:resultWithLocalized];
+    
+    /// Run markdown benchmarks:
+    
+    if ((0)) {
+        markdownparser_incremental_tests();
+        markdownparser_renderops_tests();
+        markdownparser_precompiled_tests();
+        markdownparser_sourcemap_tests();
+        markdownparser_blockops_tests();
+        runMarkdownParserBenchmarks();
+    }
+    
+    if ((0)) {
+        stringadditions_inplace_tests();
+        stringadditions_builder_tests();
+        stringadditions_format_tests();
+        stringadditions_fontcache_tests();
+        stringadditions_measurement_tests();
+        stringadditions_trimming_tests();
+        stringadditions_substringmatcher_tests();
+        stringadditions_runstatistics_tests();
+        stringadditions_compaction_tests();
+        stringadditions_styleregistry_tests();
+        stringadditions_addingbase_tests();
+        stringadditions_setweight_tests();
+        stringadditions_attachment_tests();
+        stringadditions_indent_tests();
+        stringadditions_regex_tests();
+        runStringAdditionsBenchmarks();
+    }
+    
+    if ((0)) {
+        runMarkdownParserHarness(0, NULL); /// Also builds standalone on Linux – see the `GNUmakefile` next to it
+    }
 }
 
 
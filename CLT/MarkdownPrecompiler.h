@@ -0,0 +1,18 @@
+//
+//  MarkdownPrecompiler.h
+//  objc_tests
+//
+//  Created by Noah Nübling on 18.10.26.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Build-time tool that parses the markdown in our `.xcstrings` catalogs and writes a `MarkdownPrecompiledStrings` blob.
+///     Usage: `objc_tests precompile-markdown -o <out.mdblob> <Localizable.xcstrings>...`
+///     Meant to be run from a build phase, so the app can load the blob instead of parsing markdown at launch.
+
+int runMarkdownPrecompiler(int argc, const char *_Nonnull argv[_Nonnull]); /// Pass the arguments after the command name. Returns an exit code.
+
+NS_ASSUME_NONNULL_END
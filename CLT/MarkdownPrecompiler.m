@@ -0,0 +1,103 @@
+//
+//  MarkdownPrecompiler.m
+//  objc_tests
+//
+//  Created by Noah Nübling on 18.10.26.
+//
+
+#import "MarkdownPrecompiler.h"
+#import "MarkdownParser.h"
+#import "MarkdownPrecompiledStrings.h"
+
+static void collectCatalogValues(id localization, NSString *key, NSString *locale, NSMutableDictionary<NSString *, NSMutableDictionary<NSString *, NSString *> *> *result) {
+    
+    /// Collects the `stringUnit.value`s of one localization of one key.
+    ///     Plural and device variations are stored under the key plus their path, e.g. `key|plural.one` or `key|device.mac`. The loader has to ask for those keys explicitly.
+    
+    if (![localization isKindOfClass:[NSDictionary class]]) return;
+    
+    NSString *value = localization[@"stringUnit"][@"value"];
+    if ([value isKindOfClass:[NSString class]]) {
+        if (result[locale] == nil) result[locale] = [NSMutableDictionary dictionary];
+        result[locale][key] = value;
+    }
+    
+    NSDictionary *variations = localization[@"variations"];
+    if (![variations isKindOfClass:[NSDictionary class]]) return;
+    for (NSString *variationType in variations) {
+        NSDictionary *cases = variations[variationType];
+        if (![cases isKindOfClass:[NSDictionary class]]) continue;
+        for (NSString *variationCase in cases) {
+            NSString *variationKey = [key containsString:@"|"] ? [NSString stringWithFormat:@"%@.%@.%@", key, variationType, variationCase]
+                                                                : [NSString stringWithFormat:@"%@|%@.%@", key, variationType, variationCase];
+            collectCatalogValues(cases[variationCase], variationKey, locale, result);
+        }
+    }
+}
+
+int runMarkdownPrecompiler(int argc, const char *argv[]) {
+    
+    @autoreleasepool {
+        
+        /// Parse arguments
+        NSString *outputPath = nil;
+        NSMutableArray<NSString *> *catalogPaths = [NSMutableArray array];
+        for (int i = 0; i < argc; i++) {
+            if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+                outputPath = @(argv[++i]);
+            } else {
+                [catalogPaths addObject:@(argv[i])];
+            }
+        }
+        if (outputPath == nil || catalogPaths.count == 0) {
+            fprintf(stderr, "usage: objc_tests precompile-markdown -o <out.mdblob> <Localizable.xcstrings>...\n");
+            return 64; /// EX_USAGE
+        }
+        
+        /// Read catalogs
+        ///     If several catalogs have the same key for the same locale, the later one wins.
+        NSMutableDictionary<NSString *, NSMutableDictionary<NSString *, NSString *> *> *markdownByLocaleAndKey = [NSMutableDictionary dictionary];
+        for (NSString *path in catalogPaths) {
+            NSData *data = [NSData dataWithContentsOfFile:path];
+            NSError *error = nil;
+            NSDictionary *catalog = data ? [NSJSONSerialization JSONObjectWithData:data options:0 error:&error] : nil;
+            if (![catalog isKindOfClass:[NSDictionary class]] || ![catalog[@"strings"] isKindOfClass:[NSDictionary class]]) {
+                fprintf(stderr, "error: Couldn't read string catalog at %s (%s)\n", path.UTF8String, error.description.UTF8String ?: "not a catalog");
+                return 1;
+            }
+            NSDictionary *strings = catalog[@"strings"];
+            for (NSString *key in strings) {
+                NSDictionary *localizations = strings[key][@"localizations"];
+                if (![localizations isKindOfClass:[NSDictionary class]]) continue;
+                for (NSString *locale in localizations) {
+                    collectCatalogValues(localizations[locale], key, locale, markdownByLocaleAndKey);
+                }
+            }
+        }
+        
+        /// Parse
+        ///     We only run the parse stage. Styling needs AppKit and depends on the style sheet, so the app does that at runtime.
+        NSMutableDictionary<NSString *, NSDictionary<NSString *, MarkdownRenderOps *> *> *renderOps = [NSMutableDictionary dictionary];
+        NSUInteger count = 0;
+        for (NSString *locale in markdownByLocaleAndKey) {
+            NSMutableDictionary<NSString *, MarkdownRenderOps *> *opsByKey = [NSMutableDictionary dictionary];
+            NSDictionary<NSString *, NSString *> *markdownByKey = markdownByLocaleAndKey[locale];
+            for (NSString *key in markdownByKey) {
+                opsByKey[key] = [MarkdownParser renderOpsWithMarkdown:markdownByKey[key]];
+                count += 1;
+            }
+            renderOps[locale] = opsByKey;
+        }
+        
+        /// Write
+        NSData *blob = [MarkdownPrecompiledStrings dataWithRenderOps:renderOps];
+        NSError *error = nil;
+        if (![blob writeToFile:outputPath options:NSDataWritingAtomic error:&error]) {
+            fprintf(stderr, "error: Couldn't write %s (%s)\n", outputPath.UTF8String, error.description.UTF8String);
+            return 1;
+        }
+        
+        printf("Precompiled %lu strings in %lu locales into %s (%lu bytes)\n", (unsigned long)count, (unsigned long)renderOps.count, outputPath.UTF8String, (unsigned long)blob.length);
+        return 0;
+    }
+}
@@ -13,6 +13,7 @@
 #import "MFUtils.h"
 #import "MFLinkedList.h"
 #import "MFObserverTests.h"
+#import "MarkdownPrecompiler.h"
 
 MFDataClass(MFAddress, (MFDataProp(NSString *city)
                         MFDataProp(NSString *street)
@@ -180,6 +181,13 @@ void taskToExecute(void) {
 
 
 int main(int argc, const char * argv[]) {
+    
+    /// Commands
+    ///     Used from build phases. Without a command, we run the tests below.
+    if (argc > 1 && strcmp(argv[1], "precompile-markdown") == 0) {
+        return runMarkdownPrecompiler(argc - 2, argv + 2);
+    }
+    
     @autoreleasepool {
         
                 /// Create an NSTimer and schedule it on the run loop
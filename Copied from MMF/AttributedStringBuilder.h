@@ -0,0 +1,83 @@
+//
+// --------------------------------------------------------------------------
+// AttributedStringBuilder.h
+// Created for Mac Mouse Fix (https://github.com/noah-nuebling/mac-mouse-fix)
+// Created by Noah Nuebling in 2026
+// Licensed under the MMF License (https://github.com/noah-nuebling/mac-mouse-fix/blob/master/License)
+// --------------------------------------------------------------------------
+//
+
+/// Records attribute edits and applies them all at once in `-build`.
+///     Chaining `attributedStringByAdding...` calls runs `rangeOfString:` and enumerates the attributes once per call. The builder instead finds all substrings in one scan over the string, then walks the attribute runs once, applying every edit that covers each run.
+///     That makes it the way to style lots of keywords in a long text.
+///     Edits are applied in the order they were recorded, so the result is the same as calling the in-place methods from `NSMutableAttributedString (Additions)` one after another.
+///
+/// Usage:
+///     ```
+///     AttributedStringBuilder *b = [AttributedStringBuilder builderWithAttributedString:s];
+///     [[[b fillOutBase] addWeight:NSFontWeightSemibold forSubstring:@"Note:"] addHyperlink:url forSubstring:@"Learn more"];
+///     s = [b build];
+///     ```
+///
+/// Notes:
+/// - `forSubstring:` edits target the first occurrence, like `rangeOfString:`. `forAllOccurrencesOfSubstring:` edits target every occurrence. Substrings that don't occur are ignored. (The `NSAttributedString (Additions)` methods would throw in that case.)
+///     All substrings are found together in one pass with `SubstringMatcher`. The matching is literal, while `rangeOfString:` also matches canonically equivalent strings. For our UI strings that doesn't make a difference.
+/// - `addBold...` and `addItalic...` derive the new font from each run's own font. (`addSymbolicFontTraits:` uses the font at index 0 for the whole range.)
+
+#import <Foundation/Foundation.h>
+#import <Cocoa/Cocoa.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface AttributedStringBuilder : NSObject
+
+/// Init
++ (instancetype)builderWithAttributedString:(NSAttributedString *)string;
++ (instancetype)builderWithString:(NSString *)string;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Build
+- (NSAttributedString *)build;
+
+/// Core
+///     Passing NULL for the range means the whole string.
+- (instancetype)modifyAttributesForRange:(const NSRangePointer _Nullable)range modifier:(void (^)(NSMutableDictionary<NSAttributedStringKey, id> *attributes))modifier;
+- (instancetype)modifyAttributesForSubstring:(NSString *)substring modifier:(void (^)(NSMutableDictionary<NSAttributedStringKey, id> *attributes))modifier;
+- (instancetype)modifyAttributesForAllOccurrencesOfSubstring:(NSString *)substring modifier:(void (^)(NSMutableDictionary<NSAttributedStringKey, id> *attributes))modifier;
+
+/// String attributes
+- (instancetype)addStringAttributes:(NSDictionary<NSAttributedStringKey, id> *)attributes forRange:(const NSRangePointer _Nullable)range;
+- (instancetype)addStringAttributes:(NSDictionary<NSAttributedStringKey, id> *)attributes forSubstring:(NSString *)substring;
+- (instancetype)addStringAttributesAsBase:(NSDictionary<NSAttributedStringKey, id> *)baseAttributes; /// Only fills in keys a run doesn't have yet. Applies to the whole string.
+- (instancetype)fillOutBase;
+- (instancetype)addColor:(NSColor *)color forRange:(const NSRangePointer _Nullable)range;
+- (instancetype)addColor:(NSColor *)color forSubstring:(NSString *)substring;
+- (instancetype)addHyperlink:(NSURL *)url forRange:(const NSRangePointer _Nullable)range;
+- (instancetype)addHyperlink:(NSURL *)url forSubstring:(NSString *)substring;
+- (instancetype)addFont:(NSFont *)font forRange:(const NSRangePointer _Nullable)range;
+- (instancetype)addBaseLineOffset:(CGFloat)offset forRange:(const NSRangePointer _Nullable)range;
+
+/// All occurrences
+- (instancetype)addStringAttributes:(NSDictionary<NSAttributedStringKey, id> *)attributes forAllOccurrencesOfSubstring:(NSString *)substring;
+- (instancetype)addColor:(NSColor *)color forAllOccurrencesOfSubstring:(NSString *)substring;
+- (instancetype)addHyperlink:(NSURL *)url forAllOccurrencesOfSubstring:(NSString *)substring;
+- (instancetype)addWeight:(NSFontWeight)weight forAllOccurrencesOfSubstring:(NSString *)substring;
+- (instancetype)addBoldForAllOccurrencesOfSubstring:(NSString *)substring;
+- (instancetype)addItalicForAllOccurrencesOfSubstring:(NSString *)substring;
+
+/// Paragraph style
+- (instancetype)addParagraphSpacing:(CGFloat)spacing forRange:(const NSRangePointer _Nullable)range;
+- (instancetype)addAlignment:(NSTextAlignment)alignment forRange:(const NSRangePointer _Nullable)range;
+
+/// Font
+- (instancetype)addWeight:(NSFontWeight)weight forRange:(const NSRangePointer _Nullable)range;
+- (instancetype)addWeight:(NSFontWeight)weight forSubstring:(NSString *)substring;
+- (instancetype)addBoldForRange:(const NSRangePointer _Nullable)range;
+- (instancetype)addBoldForSubstring:(NSString *)substring;
+- (instancetype)addItalicForRange:(const NSRangePointer _Nullable)range;
+- (instancetype)addItalicForSubstring:(NSString *)substring;
+- (instancetype)setFontSize:(CGFloat)size forRange:(const NSRangePointer _Nullable)range;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,374 @@
+//
+// --------------------------------------------------------------------------
+// AttributedStringBuilder.m
+// Created for Mac Mouse Fix (https://github.com/noah-nuebling/mac-mouse-fix)
+// Created by Noah Nuebling in 2026
+// Licensed under the MMF License (https://github.com/noah-nuebling/mac-mouse-fix/blob/master/License)
+// --------------------------------------------------------------------------
+//
+
+#import "AttributedStringBuilder.h"
+#import "NSAttributedString+Additions.h"
+#import "SubstringMatcher.h"
+
+typedef void (^AttributesModifier)(NSMutableDictionary<NSAttributedStringKey, id> *attributes);
+
+///
+/// Edit
+///
+
+@interface AttributedStringEdit : NSObject {
+    @public
+    NSRange range;              /// Only for range edits
+    NSString *substring;        /// nil for range edits
+    Boolean allOccurrences;     /// Otherwise only the first occurrence of `substring`
+    AttributesModifier modifier;
+}
+@end
+@implementation AttributedStringEdit
+@end
+
+///
+/// Sweep
+///
+
+typedef struct {
+    NSUInteger position;
+    NSUInteger editIndex;
+    Boolean isStart;
+} EditBoundary;
+
+static int compareBoundaries(const void *a, const void *b) {
+    const EditBoundary *x = a;
+    const EditBoundary *y = b;
+    if (x->position != y->position) return (x->position < y->position) ? -1 : 1;
+    return 0;
+}
+
+@implementation AttributedStringBuilder {
+    NSAttributedString *_string;
+    NSMutableArray<AttributedStringEdit *> *_edits;
+}
+
+#pragma mark - Init
+
++ (instancetype)builderWithAttributedString:(NSAttributedString *)string {
+    AttributedStringBuilder *builder = [[AttributedStringBuilder alloc] initWithAttributedString:string];
+    return builder;
+}
+
++ (instancetype)builderWithString:(NSString *)string {
+    return [self builderWithAttributedString:[[NSAttributedString alloc] initWithString:string]];
+}
+
+- (instancetype)initWithAttributedString:(NSAttributedString *)string {
+    self = [super init];
+    if (self) {
+        _string = string.copy;
+        _edits = [NSMutableArray array];
+    }
+    return self;
+}
+
+#pragma mark - Build
+
+- (NSAttributedString *)build {
+
+    /// Notes:
+    /// - Find all substrings with one `SubstringMatcher` pass. That gives us the ranges of every edit.
+    /// - Then sweep over the edit boundaries. Between two boundaries the set of covering edits is constant, so for each attribute run in there we copy its attributes once, run the covering edits in recording order and set the result.
+    /// - The `activeEdits` index set keeps the edits sorted by index, which is the recording order.
+    ///     Occurrences of the same substring can overlap (e.g. "aa" in "aaa"), so we count how many of an edit's ranges cover the current position, and an edit is active while that's > 0. That way it's still applied only once per run.
+
+    NSUInteger editCount = _edits.count;
+    NSUInteger length = _string.length;
+    NSMutableAttributedString *result = _string.mutableCopy;
+    if (editCount == 0 || length == 0) return result;
+
+    /// Collect distinct substrings
+    NSMutableArray<NSString *> *substrings = [NSMutableArray array];
+    NSMutableDictionary<NSString *, NSNumber *> *substringIndexes = [NSMutableDictionary dictionary];
+    NSUInteger *editSubstringIndexes = malloc(editCount * sizeof(NSUInteger));
+    for (NSUInteger i = 0; i < editCount; i++) {
+        NSString *substring = _edits[i]->substring;
+        if (substring == nil) continue;
+        NSNumber *index = substringIndexes[substring];
+        if (index == nil) {
+            index = @(substrings.count);
+            substringIndexes[substring] = index;
+            [substrings addObject:substring];
+        }
+        editSubstringIndexes[i] = index.unsignedIntegerValue;
+    }
+
+    /// Find substrings
+    ///     `firstRanges` for edits that only want the first occurrence, `allRanges` for the others
+    NSUInteger substringCount = substrings.count;
+    NSRange *firstRanges = malloc(MAX(substringCount, 1) * sizeof(NSRange));
+    NSMutableArray<NSMutableData *> *allRanges = [NSMutableArray array];
+    for (NSUInteger i = 0; i < substringCount; i++) {
+        firstRanges[i] = NSMakeRange(NSNotFound, 0);
+        [allRanges addObject:[NSMutableData data]];
+    }
+    if (substringCount > 0) {
+        SubstringMatcher *matcher = [[SubstringMatcher alloc] initWithSubstrings:substrings];
+        [matcher enumerateMatchesInString:_string.string usingBlock:^(NSUInteger substringIndex, NSRange range, BOOL *stop) {
+            if (firstRanges[substringIndex].location == NSNotFound) firstRanges[substringIndex] = range;
+            [allRanges[substringIndex] appendBytes:&range length:sizeof(range)];
+        }];
+    }
+
+    /// Collect boundaries
+    NSMutableData *boundaryData = [NSMutableData data];
+    void (^addRange)(NSRange, NSUInteger) = ^(NSRange range, NSUInteger editIndex) {
+        if (range.location == NSNotFound || range.length == 0) return; /// Substring didn't occur
+        assert(NSMaxRange(range) <= length);
+        EditBoundary start = { range.location, editIndex, true };
+        EditBoundary end = { NSMaxRange(range), editIndex, false };
+        [boundaryData appendBytes:&start length:sizeof(start)];
+        [boundaryData appendBytes:&end length:sizeof(end)];
+    };
+    for (NSUInteger i = 0; i < editCount; i++) {
+        AttributedStringEdit *edit = _edits[i];
+        if (edit->substring == nil) {
+            addRange(edit->range, i);
+        } else if (!edit->allOccurrences) {
+            addRange(firstRanges[editSubstringIndexes[i]], i);
+        } else {
+            NSData *ranges = allRanges[editSubstringIndexes[i]];
+            const NSRange *r = ranges.bytes;
+            for (NSUInteger j = 0; j < ranges.length / sizeof(NSRange); j++) addRange(r[j], i);
+        }
+    }
+    free(firstRanges);
+    free(editSubstringIndexes);
+
+    EditBoundary *boundaries = boundaryData.mutableBytes;
+    NSUInteger boundaryCount = boundaryData.length / sizeof(EditBoundary);
+    qsort(boundaries, boundaryCount, sizeof(EditBoundary), compareBoundaries);
+
+    /// Sweep
+    NSMutableIndexSet *activeEdits = [NSMutableIndexSet indexSet];
+    NSUInteger *coverCounts = calloc(editCount, sizeof(NSUInteger));
+    NSArray<AttributedStringEdit *> *edits = _edits;
+
+    [result beginEditing];
+    NSUInteger b = 0;
+    while (b < boundaryCount) {
+
+        /// Update active edits at this position
+        NSUInteger position = boundaries[b].position;
+        while (b < boundaryCount && boundaries[b].position == position) {
+            NSUInteger i = boundaries[b].editIndex;
+            if (boundaries[b].isStart) {
+                if (coverCounts[i]++ == 0) [activeEdits addIndex:i];
+            } else {
+                if (--coverCounts[i] == 0) [activeEdits removeIndex:i];
+            }
+            b++;
+        }
+        if (b >= boundaryCount || activeEdits.count == 0) continue;
+
+        /// Apply to the runs up to the next boundary
+        NSRange segment = NSMakeRange(position, boundaries[b].position - position);
+        [_string enumerateAttributesInRange:segment options:0 usingBlock:^(NSDictionary<NSAttributedStringKey,id> * _Nonnull attrs, NSRange runRange, BOOL * _Nonnull stop) {
+            NSMutableDictionary<NSAttributedStringKey, id> *newAttributes = attrs.mutableCopy;
+            [activeEdits enumerateIndexesUsingBlock:^(NSUInteger i, BOOL * _Nonnull stop) {
+                edits[i]->modifier(newAttributes);
+            }];
+            [result setAttributes:internedAttributes(newAttributes) range:runRange]; /// Runs that end up with the same attributes share one dictionary
+        }];
+    }
+    [result endEditing];
+
+    free(coverCounts);
+    return result;
+}
+
+#pragma mark - Core
+
+- (instancetype)modifyAttributesForRange:(const NSRangePointer _Nullable)range modifier:(AttributesModifier)modifier {
+    AttributedStringEdit *edit = [AttributedStringEdit new];
+    edit->range = (range == NULL) ? NSMakeRange(0, _string.length) : *range;
+    edit->modifier = modifier;
+    [_edits addObject:edit];
+    return self;
+}
+
+- (instancetype)modifyAttributesForSubstring:(NSString *)substring modifier:(AttributesModifier)modifier {
+    AttributedStringEdit *edit = [AttributedStringEdit new];
+    edit->range = NSMakeRange(NSNotFound, 0);
+    edit->substring = substring.copy;
+    edit->modifier = modifier;
+    [_edits addObject:edit];
+    return self;
+}
+
+- (instancetype)modifyAttributesForAllOccurrencesOfSubstring:(NSString *)substring modifier:(AttributesModifier)modifier {
+    [self modifyAttributesForSubstring:substring modifier:modifier];
+    _edits.lastObject->allOccurrences = true;
+    return self;
+}
+
+#pragma mark - String attributes
+
+- (instancetype)addStringAttributes:(NSDictionary<NSAttributedStringKey, id> *)attributes forRange:(const NSRangePointer _Nullable)range {
+    return [self modifyAttributesForRange:range modifier:^(NSMutableDictionary<NSAttributedStringKey,id> *attrs) {
+        [attrs addEntriesFromDictionary:attributes];
+    }];
+}
+
+- (instancetype)addStringAttributes:(NSDictionary<NSAttributedStringKey, id> *)attributes forSubstring:(NSString *)substring {
+    return [self modifyAttributesForSubstring:substring modifier:^(NSMutableDictionary<NSAttributedStringKey,id> *attrs) {
+        [attrs addEntriesFromDictionary:attributes];
+    }];
+}
+
+- (instancetype)addStringAttributesAsBase:(NSDictionary<NSAttributedStringKey, id> *)baseAttributes {
+    return [self modifyAttributesForRange:NULL modifier:^(NSMutableDictionary<NSAttributedStringKey,id> *attrs) {
+        for (NSAttributedStringKey key in baseAttributes) {
+            if (attrs[key] == nil) attrs[key] = baseAttributes[key];
+        }
+    }];
+}
+
+- (instancetype)fillOutBase {
+    return [self addStringAttributesAsBase:fillOutBaseAttributes()];
+}
+
+- (instancetype)addColor:(NSColor *)color forRange:(const NSRangePointer _Nullable)range {
+    return [self addStringAttributes:@{ NSForegroundColorAttributeName: color } forRange:range];
+}
+
+- (instancetype)addColor:(NSColor *)color forSubstring:(NSString *)substring {
+    return [self addStringAttributes:@{ NSForegroundColorAttributeName: color } forSubstring:substring];
+}
+
+static NSDictionary *hyperlinkAttributes(NSURL *url) {
+    /// Same as `addHyperlink:forRange:`
+    return @{
+        NSLinkAttributeName: url.absoluteString,
+        NSUnderlineStyleAttributeName: @(NSUnderlineStyleSingle),
+    };
+}
+
+- (instancetype)addHyperlink:(NSURL *)url forRange:(const NSRangePointer _Nullable)range {
+    return [self addStringAttributes:hyperlinkAttributes(url) forRange:range];
+}
+
+- (instancetype)addHyperlink:(NSURL *)url forSubstring:(NSString *)substring {
+    return [self addStringAttributes:hyperlinkAttributes(url) forSubstring:substring];
+}
+
+- (instancetype)addFont:(NSFont *)font forRange:(const NSRangePointer _Nullable)range {
+    return [self addStringAttributes:@{ NSFontAttributeName: font } forRange:range];
+}
+
+- (instancetype)addBaseLineOffset:(CGFloat)offset forRange:(const NSRangePointer _Nullable)range {
+    return [self addStringAttributes:@{ NSBaselineOffsetAttributeName: @(offset) } forRange:range];
+}
+
+#pragma mark - All occurrences
+
+- (instancetype)addStringAttributes:(NSDictionary<NSAttributedStringKey, id> *)attributes forAllOccurrencesOfSubstring:(NSString *)substring {
+    return [self modifyAttributesForAllOccurrencesOfSubstring:substring modifier:^(NSMutableDictionary<NSAttributedStringKey,id> *attrs) {
+        [attrs addEntriesFromDictionary:attributes];
+    }];
+}
+
+- (instancetype)addColor:(NSColor *)color forAllOccurrencesOfSubstring:(NSString *)substring {
+    return [self addStringAttributes:@{ NSForegroundColorAttributeName: color } forAllOccurrencesOfSubstring:substring];
+}
+
+- (instancetype)addHyperlink:(NSURL *)url forAllOccurrencesOfSubstring:(NSString *)substring {
+    return [self addStringAttributes:hyperlinkAttributes(url) forAllOccurrencesOfSubstring:substring];
+}
+
+- (instancetype)addWeight:(NSFontWeight)weight forAllOccurrencesOfSubstring:(NSString *)substring {
+    return [self modifyAttributesForAllOccurrencesOfSubstring:substring modifier:^(NSMutableDictionary<NSAttributedStringKey,id> *attrs) {
+        attrs[NSFontAttributeName] = fontByAddingFontTraits(attrs[NSFontAttributeName], @{ NSFontWeightTrait: @(weight) });
+    }];
+}
+
+- (instancetype)addBoldForAllOccurrencesOfSubstring:(NSString *)substring {
+    return [self modifyAttributesForAllOccurrencesOfSubstring:substring modifier:^(NSMutableDictionary<NSAttributedStringKey,id> *attrs) {
+        attrs[NSFontAttributeName] = fontByAddingSymbolicFontTraits(attrs[NSFontAttributeName], NSFontDescriptorTraitBold);
+    }];
+}
+
+- (instancetype)addItalicForAllOccurrencesOfSubstring:(NSString *)substring {
+    return [self modifyAttributesForAllOccurrencesOfSubstring:substring modifier:^(NSMutableDictionary<NSAttributedStringKey,id> *attrs) {
+        attrs[NSFontAttributeName] = fontByAddingSymbolicFontTraits(attrs[NSFontAttributeName], NSFontDescriptorTraitItalic);
+    }];
+}
+
+#pragma mark - Paragraph style
+
+- (instancetype)modifyParagraphStyleForRange:(const NSRangePointer _Nullable)range modifier:(void (^)(NSMutableParagraphStyle *style))modifier {
+    return [self modifyAttributesForRange:range modifier:^(NSMutableDictionary<NSAttributedStringKey,id> *attrs) {
+        NSMutableParagraphStyle *style = ((NSParagraphStyle *)attrs[NSParagraphStyleAttributeName]).mutableCopy;
+        if (style == nil) {
+            style = [NSMutableParagraphStyle new];
+        }
+        modifier(style);
+        attrs[NSParagraphStyleAttributeName] = style;
+    }];
+}
+
+- (instancetype)addParagraphSpacing:(CGFloat)spacing forRange:(const NSRangePointer _Nullable)range {
+    return [self modifyParagraphStyleForRange:range modifier:^(NSMutableParagraphStyle *style) {
+        style.paragraphSpacing = spacing;
+    }];
+}
+
+- (instancetype)addAlignment:(NSTextAlignment)alignment forRange:(const NSRangePointer _Nullable)range {
+    return [self modifyParagraphStyleForRange:range modifier:^(NSMutableParagraphStyle *style) {
+        style.alignment = alignment;
+    }];
+}
+
+#pragma mark - Font
+
+- (instancetype)addWeight:(NSFontWeight)weight forRange:(const NSRangePointer _Nullable)range {
+    return [self modifyAttributesForRange:range modifier:^(NSMutableDictionary<NSAttributedStringKey,id> *attrs) {
+        attrs[NSFontAttributeName] = fontByAddingFontTraits(attrs[NSFontAttributeName], @{ NSFontWeightTrait: @(weight) });
+    }];
+}
+
+- (instancetype)addWeight:(NSFontWeight)weight forSubstring:(NSString *)substring {
+    return [self modifyAttributesForSubstring:substring modifier:^(NSMutableDictionary<NSAttributedStringKey,id> *attrs) {
+        attrs[NSFontAttributeName] = fontByAddingFontTraits(attrs[NSFontAttributeName], @{ NSFontWeightTrait: @(weight) });
+    }];
+}
+
+- (instancetype)addBoldForRange:(const NSRangePointer _Nullable)range {
+    return [self modifyAttributesForRange:range modifier:^(NSMutableDictionary<NSAttributedStringKey,id> *attrs) {
+        attrs[NSFontAttributeName] = fontByAddingSymbolicFontTraits(attrs[NSFontAttributeName], NSFontDescriptorTraitBold);
+    }];
+}
+
+- (instancetype)addBoldForSubstring:(NSString *)substring {
+    return [self modifyAttributesForSubstring:substring modifier:^(NSMutableDictionary<NSAttributedStringKey,id> *attrs) {
+        attrs[NSFontAttributeName] = fontByAddingSymbolicFontTraits(attrs[NSFontAttributeName], NSFontDescriptorTraitBold);
+    }];
+}
+
+- (instancetype)addItalicForRange:(const NSRangePointer _Nullable)range {
+    return [self modifyAttributesForRange:range modifier:^(NSMutableDictionary<NSAttributedStringKey,id> *attrs) {
+        attrs[NSFontAttributeName] = fontByAddingSymbolicFontTraits(attrs[NSFontAttributeName], NSFontDescriptorTraitItalic);
+    }];
+}
+
+- (instancetype)addItalicForSubstring:(NSString *)substring {
+    return [self modifyAttributesForSubstring:substring modifier:^(NSMutableDictionary<NSAttributedStringKey,id> *attrs) {
+        attrs[NSFontAttributeName] = fontByAddingSymbolicFontTraits(attrs[NSFontAttributeName], NSFontDescriptorTraitItalic);
+    }];
+}
+
+- (instancetype)setFontSize:(CGFloat)size forRange:(const NSRangePointer _Nullable)range {
+    return [self modifyAttributesForRange:range modifier:^(NSMutableDictionary<NSAttributedStringKey,id> *attrs) {
+        attrs[NSFontAttributeName] = fontBySettingSize(attrs[NSFontAttributeName], size);
+    }];
+}
+
+@end
@@ -9,6 +9,7 @@
 
 #import <Foundation/Foundation.h>
 #import <Cocoa/Cocoa.h>
+#import "NSAttributedString+Core.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -17,20 +18,16 @@ NS_ASSUME_NONNULL_BEGIN
 /// For usage guide, see Apple Typography Human Interface Guidelines: https://developer.apple.com/design/human-interface-guidelines/typography
 
 void assignAttributedStringKeepingBase(NSAttributedString *_Nonnull *_Nonnull assignee, NSAttributedString *newValue);
+NSDictionary<NSAttributedStringKey, id> *fillOutBaseAttributes(void); /// The attributes `attributedStringByFillingOutBase` adds. Shared instance. Comes from `currentStyleResolver()`.
+NSDictionary<NSAttributedStringKey, id> *fillOutBaseAsHintAttributes(void); /// The attributes `attributedStringByFillingOutBaseAsHint` adds. Shared instance. Comes from `currentStyleResolver()`.
 
-- (NSAttributedString *)attributedStringByCapitalizingFirst;
-- (NSAttributedString *)attributedStringByTrimmingWhitespace;
-
-- (NSAttributedString *)attributedStringByAppending:(NSAttributedString *)string;
-+ (NSAttributedString *)attributedStringWithAttributedFormat:(NSAttributedString *)format args:(NSArray<NSAttributedString *> *)args;
 + (NSAttributedString * _Nullable)attributedStringWithCoolMarkdown:(NSString *)md;
 + (NSAttributedString * _Nullable)attributedStringWithCoolMarkdown:(NSString *)md fillOutBase:(BOOL)fillOutBase;
++ (NSAttributedString * _Nullable)attributedStringWithLocalizedCoolMarkdown:(NSString *)key; /// Precompiled at build time if possible. See `MarkdownPrecompiledStrings`
 + (NSAttributedString * _Nullable)attributedStringWithAttributedMarkdown:(NSAttributedString *)md;
 
 - (NSAttributedString *)attributedStringByAddingBaseLineOffset:(CGFloat)offset forRange:(const NSRangePointer _Nullable)range;
 
-- (NSString *)stringWithAttachmentDescriptions;
-
 - (NSAttributedString *)attributedStringByAddingFontTraits:(NSDictionary<NSFontDescriptorTraitKey, id> *)traits forRange:(const NSRangePointer _Nullable)inRange;
 - (NSAttributedString *)attributedStringByAddingWeight:(NSFontWeight)weight forRange:(const NSRangePointer _Nullable)range;
 
@@ -62,10 +59,110 @@ void assignAttributedStringKeepingBase(NSAttributedString *_Nonnull *_Nonnull as
 - (NSAttributedString *)attributedStringBySettingSemiBoldColorForSubstring:(NSString *)subStr;
 - (NSAttributedString *)attributedStringByAddingHintStyle;
 
-- (NSSize)sizeAtMaxWidth:(CGFloat)maxWidth;
-- (CGFloat)heightAtWidth:(CGFloat)width;
+- (NSAttributedString *)attributedStringByCompactingAttributeRuns;
+
+- (NSSize)sizeAtMaxWidth:(CGFloat)maxWidth; /// Cached. See `textMeasurementCacheStatistics()`
+- (CGFloat)heightAtWidth:(CGFloat)width; /// Cached
+- (CGFloat)uncachedHeightAtWidth:(CGFloat)width;
 //- (CGFloat)preferredWidth;
 
 @end
 
+/// Font helpers
+///     All font derivation (size, weight, traits) goes through these. If `font` is nil, they start from the system font at default size.
+///     The results are cached, so asking for the same font again skips font matching.
+///     They never return nil: If the font can't be resolved, you get back the font they started from.
+
+NSFont *fontByAddingFontTraits(NSFont *_Nullable font, NSDictionary<NSFontDescriptorTraitKey, id> *traits);
+NSFont *fontByAddingSymbolicFontTraits(NSFont *_Nullable font, NSFontDescriptorSymbolicTraits traits);
+NSFont *fontBySettingSize(NSFont *_Nullable font, CGFloat size);
+NSFont *fontBySettingManagerWeight(NSFont *_Nullable font, NSInteger weight); /// NSFontManager weight (0 to 15)
+NSFont *fontByAddingFontAttributes(NSFont *_Nullable font, NSDictionary<NSFontDescriptorAttributeName, id> *attributes);
+
+typedef struct {
+    NSUInteger hits;
+    NSUInteger misses;
+    NSUInteger count;
+    double missSeconds;     /// Time spent resolving fonts on misses. `missSeconds / misses * hits` estimates the time the hits saved.
+} FontCacheStatistics;
+
+FontCacheStatistics fontCacheStatistics(void);
+void clearFontCache(void);
+
+/// Style registry
+///     Interns attribute dictionaries and paragraph styles by content, so equal styles are one shared immutable instance. Use the result in place of the argument.
+
+NSDictionary<NSAttributedStringKey, id> *internedAttributes(NSDictionary<NSAttributedStringKey, id> *attributes);
+NSParagraphStyle *internedParagraphStyle(NSParagraphStyle *style);
+
+typedef struct {
+    NSUInteger hits;
+    NSUInteger misses;
+    NSUInteger count;
+} StyleRegistryStatistics;
+
+StyleRegistryStatistics styleRegistryStatistics(void);
+void clearStyleRegistry(void);
+
+/// Measurement cache
+///     Backs `sizeAtMaxWidth:` and `heightAtWidth:`
+
+typedef struct {
+    NSUInteger hits;
+    NSUInteger misses;
+} TextMeasurementCacheStatistics;
+
+TextMeasurementCacheStatistics textMeasurementCacheStatistics(void);
+void clearTextMeasurementCache(void);
+
+/// In-place versions of the methods above
+///     The immutable methods make a mutable copy and call these. When applying several edits, make one mutable copy and call these on it, so the string isn't copied at every step.
+
+@interface NSMutableAttributedString (Additions)
+
+- (void)fillOutBase;
+- (void)fillOutBaseAsHint;
+- (void)addStringAttributesAsBase:(NSDictionary<NSAttributedStringKey, id> *)baseAttributes;
+
+- (void)addStringAttributes:(NSDictionary<NSAttributedStringKey, id> *)attributes forRange:(const NSRangePointer _Nullable)inRange;
+- (void)addStringAttributes:(NSDictionary<NSAttributedStringKey, id> *)attributes forSubstring:(NSString *)substring;
+- (void)addColor:(NSColor *)color forSubstring:(NSString *)subStr;
+- (void)addColor:(NSColor *)color forRange:(const NSRangePointer _Nullable)range;
+- (void)addBaseLineOffset:(CGFloat)offset forRange:(const NSRangePointer _Nullable)range;
+- (void)addHyperlink:(NSURL *)url forSubstring:(NSString *)substring;
+- (void)addHyperlink:(NSURL *_Nonnull)aURL forRange:(const NSRangePointer _Nullable)range;
+- (void)addFont:(NSFont *)font forRange:(const NSRangePointer _Nullable)range;
+
+- (void)modifyAttribute:(NSAttributedStringKey)attribute forRange:(const NSRangePointer _Nullable)inRange modifier:(id _Nullable (^)(id _Nullable attributeValue))modifier;
+- (void)modifyAttribute:(NSAttributedStringKey)attribute forSubstring:(NSString *)substring modifier:(id _Nullable(^)(id _Nullable attributeValue))modifier;
+- (void)modifyParagraphStyleForRange:(const NSRangePointer _Nullable)inRange modifier:(NSParagraphStyle *_Nullable (^)(NSMutableParagraphStyle *_Nullable style))modifier;
+- (void)modifyParagraphStyleForSubstring:(NSString *)substring modifier:(NSParagraphStyle *_Nullable (^)(NSMutableParagraphStyle *_Nullable style))modifier;
+- (void)addParagraphSpacing:(CGFloat)spacing forRange:(const NSRangePointer _Nullable)range;
+- (void)addAlignment:(NSTextAlignment)alignment forRange:(const NSRangePointer _Nullable)rangeIn;
+
+- (void)addFontAttributes:(NSDictionary<NSFontDescriptorAttributeName,id> *)attributes forRange:(const NSRangePointer _Nullable)inRange;
+- (void)addFontTraits:(NSDictionary<NSFontDescriptorTraitKey, id> *)traits forRange:(const NSRangePointer _Nullable)inRange;
+- (void)addFontTraits:(NSDictionary<NSFontDescriptorTraitKey, id> *)traits forSubstring:(NSString *)substring;
+- (void)addWeight:(NSFontWeight)weight forRange:(const NSRangePointer _Nullable)range;
+- (void)addWeight:(NSFontWeight)weight forSubstring:(NSString *)string;
+- (void)addSymbolicFontTraits:(NSFontDescriptorSymbolicTraits)traits forRange:(const NSRangePointer _Nullable)inRange;
+- (void)addSymbolicFontTraits:(NSFontDescriptorSymbolicTraits)traits forSubstring:(NSString *)subStr;
+- (void)addBoldForSubstring:(NSString *)subStr;
+- (void)addBoldForRange:(const NSRangePointer _Nullable)range;
+- (void)addItalicForSubstring:(NSString *)subStr;
+- (void)addItalicForRange:(const NSRangePointer _Nullable)range;
+
+- (void)setFontSize:(CGFloat)size;
+- (void)setWeight:(NSInteger)weight forRange:(const NSRangePointer _Nullable)inRange;
+- (void)setWeight:(NSInteger)weight forSubstring:(NSString *)subStr;
+- (void)setThinForSubstring:(NSString *)subStr;
+- (void)addSemiBoldForSubstring:(NSString *)subStr;
+
+- (void)addHintStyle;
+- (void)setSemiBoldColorForSubstring:(NSString *)subStr;
+
+- (void)compactAttributeRuns; /// Runs with equal attributes share one dictionary from the style registry. Check the effect with `attributeRunStatistics()`.
+
+@end
+
 NS_ASSUME_NONNULL_END
@@ -10,6 +10,8 @@
 #import "NSAttributedString+Additions.h"
 #import <Cocoa/Cocoa.h>
 #import "MarkdownParser.h"
+#import "MarkdownPrecompiledStrings.h"
+#import "NSString+Additions.h"
 
 #if IS_MAIN_APP
 #import "Mac_Mouse_Fix-Swift.h"
@@ -19,145 +21,222 @@
 #import "Mac_Mouse_Fix_Helper-Swift.h"
 #endif
 
-@implementation NSAttributedString (Additions)
+#pragma mark - Style resolver
 
-#pragma mark Trim whitespace
+/// Notes:
+/// - The Foundation-only core (NSAttributedString+Core) gets its fonts, colors and attachments from the `StyleResolver`. This is the AppKit one. We install it in `+load`, so it's in place before any string is styled.
+/// - The base attributes come from the style registry. The system font size doesn't change at runtime and labelColor is dynamic, so building them once is fine.
 
-- (NSAttributedString *)attributedStringByCapitalizingFirst {
-    
-    NSMutableAttributedString *s = self.mutableCopy;
-    [s replaceCharactersInRange:NSMakeRange(0, 1) withString:[[s.string substringToIndex:1] localizedUppercaseString]];
-    
-    return s;
+@interface AppKitStyleResolver : NSObject <StyleResolver>
+@end
+@implementation AppKitStyleResolver
+
++ (void)load {
+    setStyleResolver([[AppKitStyleResolver alloc] init]);
+}
+
+- (NSDictionary<NSAttributedStringKey, id> *)baseAttributes {
+    static NSDictionary *attributes;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        attributes = internedAttributes(@{
+            NSFontAttributeName: [NSFont systemFontOfSize:NSFont.systemFontSize],
+            NSForegroundColorAttributeName: NSColor.labelColor,
+            NSFontWeightTrait: @(NSFontWeightMedium),
+        });
+    });
+    return attributes;
+}
+
+- (NSDictionary<NSAttributedStringKey, id> *)hintBaseAttributes {
+    static NSDictionary *attributes;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        attributes = internedAttributes(@{
+            NSFontAttributeName: [NSFont systemFontOfSize:NSFont.smallSystemFontSize],
+            NSForegroundColorAttributeName: NSColor.secondaryLabelColor,
+            NSFontWeightTrait: @(NSFontWeightRegular), /// Not sure whether to use medium or regular here
+        });
+    });
+    return attributes;
+}
+
+- (NSAttributedStringKey)attachmentAttributeName {
+    return NSAttachmentAttributeName;
+}
+
+- (NSString *_Nullable)descriptionForAttachment:(id)attachment {
+    return ((NSTextAttachment *)attachment).image.accessibilityDescription;
+}
+
+@end
+
+#pragma mark - Measurement helpers
+/// Used by `sizeAtMaxWidth:` and `heightAtWidth:`
+
+///
+/// Measurement cache
+///
+
+/// Notes:
+/// - Toasts and table cells measure the same strings at the same widths over and over. Layout is expensive, so we cache the results, keyed by (string, width, what we measured).
+/// - The key holds on to the string and compares it with `isEqualToAttributedString:`, so two different strings with the same hash never share a result. The cost of an entry is its length, so the memory we keep is bounded by `kMeasurementCacheCharacterLimit`.
+/// - NSCache is thread safe and evicts by itself. The statistics are `@synchronized`.
+
+typedef NS_ENUM(NSInteger, MeasurementKind) {
+    kMeasurementKindSizeAtMaxWidth = 0,
+    kMeasurementKindHeightAtWidth,
+};
+
+static const NSUInteger kMeasurementCacheCountLimit = 1000;
+static const NSUInteger kMeasurementCacheCharacterLimit = 1000000;
+
+@interface MeasurementCacheKey : NSObject <NSCopying> {
+    @public
+    NSAttributedString *_string;
+    CGFloat _width;
+    MeasurementKind _kind;
+}
+@end
+@implementation MeasurementCacheKey
+- (id)copyWithZone:(NSZone *)zone {
+    return self; /// Immutable
+}
+- (NSUInteger)hash {
+    uint64_t widthBits;
+    memcpy(&widthBits, &_width, sizeof(widthBits)); /// Widths can be huge (CGFLOAT_MAX), so don't convert to an integer
+    return _string.hash ^ (NSUInteger)(widthBits * 31) ^ ((NSUInteger)_kind << 20);
+}
+- (BOOL)isEqual:(MeasurementCacheKey *)other {
+    if (self == other) return YES;
+    if (![other isKindOfClass:[MeasurementCacheKey class]]) return NO;
+    return _width == other->_width && _kind == other->_kind && [_string isEqualToAttributedString:other->_string];
+}
+@end
+
+static NSCache<MeasurementCacheKey *, NSValue *> *measurementCache(void) {
+    static NSCache *cache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        cache = [[NSCache alloc] init];
+        cache.countLimit = kMeasurementCacheCountLimit;
+        cache.totalCostLimit = kMeasurementCacheCharacterLimit;
+    });
+    return cache;
+}
+
+static TextMeasurementCacheStatistics _measurementCacheStats;
+static NSObject *measurementCacheStatsLock(void) {
+    static NSObject *lock;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        lock = [[NSObject alloc] init];
+    });
+    return lock;
 }
 
-- (NSAttributedString *)attributedStringByTrimmingWhitespace {
+static NSSize cachedMeasurement(NSAttributedString *string, CGFloat width, MeasurementKind kind, NSSize (^measure)(void)) {
     
-    /// Deletes leading, trailing, and duplicate whitespace from a string.
-    ///     "Trimming" should maybe be "stripping"? Trimming usually only refers to cutting off the leading and trailing.
+    /// Lookup
+    ///     The lookup key doesn't copy the string. Only the key we store does, so a mutable string can't change under us.
+    MeasurementCacheKey *key = [[MeasurementCacheKey alloc] init];
+    key->_string = string;
+    key->_width = width;
+    key->_kind = kind;
     
-    /// Mutable copy
-    NSMutableAttributedString *s = self.mutableCopy;
+    NSValue *hit = [measurementCache() objectForKey:key];
+    if (hit != nil) {
+        @synchronized (measurementCacheStatsLock()) { _measurementCacheStats.hits += 1; }
+        return hit.sizeValue;
+    }
     
-    /// Declare chars to trim
-    NSCharacterSet *whitespaceChars = NSCharacterSet.whitespaceCharacterSet; /// I don't think this contains linebreaks? Not sure.
+    /// Measure
+    NSSize result = measure();
     
-    /// Loop forwards
-    ///     Remove leading
+    /// Store
+    key->_string = string.copy;
+    [measurementCache() setObject:[NSValue valueWithSize:result] forKey:key cost:string.length];
+    @synchronized (measurementCacheStatsLock()) { _measurementCacheStats.misses += 1; }
     
-    while (true) {
-        
-        /// Get next whitespace
-        NSRange whitespace = [s.string rangeOfCharacterFromSet:whitespaceChars];
-        
-        /// Remove whitespace if leading
-        ///     Break if no leading whitespace
-        if (whitespace.location == 0) {
-            [s deleteCharactersInRange: whitespace];
-        } else {
-            break;
-        }
+    return result;
+}
+
+TextMeasurementCacheStatistics textMeasurementCacheStatistics(void) {
+    @synchronized (measurementCacheStatsLock()) {
+        return _measurementCacheStats;
     }
-    
-    /// Loop backwards
-    ///     Remove trailing and duplicates
-    
-    NSRange lastWhitespace = NSMakeRange(NSNotFound, 0);
-    NSRange searchRange = NSMakeRange(0, s.length);
-    while (true) {
-        
-        /// Get next range
-        NSRange whitespace = [s.string rangeOfCharacterFromSet:whitespaceChars options:NSBackwardsSearch range:searchRange];
-        
-        /// Break
-        if (whitespace.location == NSNotFound) {
-            break;
-        }
-        
-        /// Delete things
-        
-        BOOL deletedWhitespace = YES;
-        
-        if (NSMaxRange(whitespace) - 1 == s.length - 1) {
-            
-            /// Delete trailing
-            [s deleteCharactersInRange:whitespace];
-            
-        } else if (NSMaxRange(whitespace) == lastWhitespace.location) {
-            
-            /// Delete consecutive
-            [s deleteCharactersInRange:whitespace];
-            
-        } else {
-            deletedWhitespace = NO;
-        }
-        
-        /// Update search range
-        ///     This makes the new search range go up to, but not include, the whitespace char we just processed
-        searchRange = NSMakeRange(searchRange.location, whitespace.location);
-        
-        /// Update last
-        if (!deletedWhitespace) {
-            lastWhitespace = whitespace;
-        } else {
-            lastWhitespace.location -= 1;
-        }
+}
+
+void clearTextMeasurementCache(void) {
+    [measurementCache() removeAllObjects];
+    @synchronized (measurementCacheStatsLock()) {
+        _measurementCacheStats = (TextMeasurementCacheStatistics){0};
     }
-    
-    /// Return
-    return s;
 }
 
-#pragma mark Append
+///
+/// Layout stack
+///
 
-- (NSAttributedString *)attributedStringByAppending:(NSAttributedString *)string {
-    return [NSAttributedString attributedStringWithFormat:@"%@%@" args:@[self, string]];
+/// Notes:
+/// - Setting up an NSTextStorage + NSLayoutManager + NSTextContainer for every measurement is a lot of allocations. So every thread keeps one around and reuses it. (TextKit objects aren't thread safe, so they can't be shared between threads.)
+/// - If we're asked to measure while we're already measuring on this thread (shouldn't happen, but e.g. text attachments could in theory call back into us), we use a fresh stack.
+
+@interface MeasurementLayoutStack : NSObject {
+    @public
+    NSTextStorage *_textStorage;
+    NSLayoutManager *_layoutManager;
+    NSTextContainer *_textContainer;
+    Boolean _inUse;
+}
+@end
+@implementation MeasurementLayoutStack
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _textContainer = [[NSTextContainer alloc] initWithSize:CGSizeMake(0, CGFLOAT_MAX)];
+        _layoutManager = [[NSLayoutManager alloc] init];
+        [_layoutManager addTextContainer:_textContainer];
+        _textStorage = [[NSTextStorage alloc] init];
+        [_textStorage addLayoutManager:_layoutManager];
+    }
+    return self;
 }
+@end
 
-#pragma mark Replace substring
+static NSString *const kMeasurementLayoutStackKey = @"com.nuebling.NSAttributedStringAdditions.measurementLayoutStack";
 
-+ (NSAttributedString *)attributedStringWithFormat:(NSString *)format args:(NSArray<NSAttributedString *> *)args {
-    
-    /// Convert format to attributed
-    NSAttributedString *attributedFormat = [[NSAttributedString alloc] initWithString:format];
-    
-    /// Call core method
-    return [self attributedStringWithAttributedFormat:attributedFormat args:args];
+static MeasurementLayoutStack *threadLayoutStack(void) {
+    NSMutableDictionary *threadDictionary = NSThread.currentThread.threadDictionary;
+    MeasurementLayoutStack *stack = threadDictionary[kMeasurementLayoutStackKey];
+    if (stack == nil) {
+        stack = [[MeasurementLayoutStack alloc] init];
+        threadDictionary[kMeasurementLayoutStackKey] = stack;
+    }
+    return stack;
 }
 
-+ (NSAttributedString *)attributedStringWithAttributedFormat:(NSAttributedString *)format args:(NSArray<NSAttributedString *> *)args {
-    
-    /// Replaces occurences of %@ in the attributedString with the args
-    ///     Also see lib function `initWithFormat:options:locale:`
-    
-    /// Early return
-    if (args.count == 0) return format;
-    if ([format.string isEqual:@""]) return format;
+static NSSize layoutSize(NSAttributedString *string, CGFloat maxWidth) {
     
-    /// Get mutable copy
-    ///     On Ventura Beta, `format.mutableCopy` returns creates unreadable data, if format is an empty string.
-    NSMutableAttributedString *mutableFormat = format.mutableCopy;
+    /// Copied from here https://stackoverflow.com/a/33903242/10601702
     
-    /// Loop
-    int i = 0;
-    while (true) {
-        
-        /// Update replace range
-        ///     Not sure if the localized is necessary/good here?
-        NSRange replaceRange = [mutableFormat.string localizedStandardRangeOfString:@"%@"];
-        if (replaceRange.location == NSNotFound) break;
-        
-        /// Replace
-        [mutableFormat replaceCharactersInRange:replaceRange withAttributedString:args[i]];
-        
-        /// Update array index
-        i++;
-        if (args.count <= i) break;
+    MeasurementLayoutStack *stack = threadLayoutStack();
+    if (stack->_inUse) {
+        stack = [[MeasurementLayoutStack alloc] init];
     }
     
-    return mutableFormat;
+    stack->_inUse = true;
+    stack->_textContainer.size = CGSizeMake(maxWidth, CGFLOAT_MAX);
+    [stack->_textStorage setAttributedString:string];
+    [stack->_layoutManager glyphRangeForTextContainer:stack->_textContainer];
+    NSSize size = [stack->_layoutManager usedRectForTextContainer:stack->_textContainer].size;
+    stack->_inUse = false;
+    
+    return size;
 }
 
+@implementation NSAttributedString (Additions)
+
 #pragma mark Padding
 
 + (NSAttributedString *)paddingStringWithWidth:(CGFloat)padding {
@@ -234,9 +313,9 @@
 }
 + (NSAttributedString *)secondaryLabelWithMarkdown:(NSString *)md {
     
-    NSAttributedString *s = [self attributedStringWithCoolMarkdown:md];
-    s = [s attributedStringBySettingFontSize:11];
-    s = [s attributedStringByAddingColor:NSColor.secondaryLabelColor forRange:NULL];
+    NSMutableAttributedString *s = [self attributedStringWithCoolMarkdown:md].mutableCopy;
+    [s setFontSize:11];
+    [s addColor:NSColor.secondaryLabelColor forRange:NULL];
     
     return s;
 }
@@ -276,33 +355,32 @@
     } else {
         
         /// Fallback to custom function
+        ///     Filling out the base goes through the parser so it's cached along with the parse result.
         
-        result = [MarkdownParser attributedStringWithMarkdown:md];
-    }
-    
-    if (fillOutBase) {
-        result = [result attributedStringByFillingOutBase];
+        result = [MarkdownParser attributedStringWithMarkdown:md baseAttributes:(fillOutBase ? fillOutBaseAttributes() : nil)];
     }
     
     return result;
 }
 
++ (NSAttributedString *_Nullable)attributedStringWithLocalizedCoolMarkdown:(NSString *)key {
+    
+    /// Same result as `attributedStringWithCoolMarkdown:` on the localized string for `key`.
+    ///     If the markdown was precompiled at build time, we only run the styling stage. Otherwise we parse the localized string at runtime.
+    
+    NSAttributedString *precompiled = [MarkdownPrecompiledStrings localizedAttributedStringForKey:key];
+    if (precompiled != nil) {
+        return [precompiled attributedStringByAddingStringAttributesAsBase:fillOutBaseAttributes()];
+    }
+    return [self attributedStringWithCoolMarkdown:[NSBundle.mainBundle localizedStringForKey:key value:nil table:nil]];
+}
+
 #pragma mark Determine size
 
 - (NSSize)sizeAtMaxWidth:(CGFloat)maxWidth {
-    /// Copied from here https://stackoverflow.com/a/33903242/10601702
-    
-    NSTextContainer *textContainer = [[NSTextContainer alloc] initWithSize:CGSizeMake(maxWidth, CGFLOAT_MAX)];
-    NSLayoutManager *layoutManager = [[NSLayoutManager alloc] init];
-    [layoutManager addTextContainer:textContainer];
-    
-    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithAttributedString:self];
-    [textStorage addLayoutManager:layoutManager];
-    [layoutManager glyphRangeForTextContainer:textContainer];
-    
-    NSSize size = [layoutManager usedRectForTextContainer:textContainer].size;
-    
-    return size;
+    return cachedMeasurement(self, maxWidth, kMeasurementKindSizeAtMaxWidth, ^NSSize{
+        return layoutSize(self, maxWidth);
+    });
 }
 
 - (NSSize)sizeAtMaxWidthOld:(CGFloat)maxWidth {
@@ -318,6 +396,12 @@
 }
 
 - (CGFloat)heightAtWidth:(CGFloat)width {
+    return cachedMeasurement(self, width, kMeasurementKindHeightAtWidth, ^NSSize{
+        return NSMakeSize(width, [self uncachedHeightAtWidth:width]);
+    }).height;
+}
+
+- (CGFloat)uncachedHeightAtWidth:(CGFloat)width {
     /// Derived from sizeAtMaxWidth
     
     /// Method 1
@@ -369,42 +453,30 @@
 #pragma mark Fill out base
 /// Need this to make size code work
 
+NSDictionary *fillOutBaseAttributes(void) {
+    return currentStyleResolver().baseAttributes;
+}
+
+NSDictionary *fillOutBaseAsHintAttributes(void) {
+    return currentStyleResolver().hintBaseAttributes;
+}
+
 - (NSAttributedString *)attributedStringByFillingOutBase {
-    
-    /// Fill out default attributes, because layout code won't work if the string doesn't have a font and a textColor attribute on every character. See https://stackoverflow.com/questions/13621084/boundingrectwithsize-for-nsattributedstring-returning-wrong-size
-    
-    NSDictionary *attributesDictionary = @{
-        NSFontAttributeName: [NSFont systemFontOfSize:NSFont.systemFontSize],
-        NSForegroundColorAttributeName: NSColor.labelColor,
-        NSFontWeightTrait: @(NSFontWeightMedium),
-    };
-    
-    return [self attributedStringByAddingStringAttributesAsBase:attributesDictionary];
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s fillOutBase];
+    return s;
 }
 
 - (NSAttributedString *)attributedStringByFillingOutBaseAsHint {
-    
-    NSDictionary *attributesDictionary = @{
-        NSFontAttributeName: [NSFont systemFontOfSize:NSFont.smallSystemFontSize],
-        NSForegroundColorAttributeName: NSColor.secondaryLabelColor,
-        NSFontWeightTrait: @(NSFontWeightRegular), /// Not sure whether to use medium or regular here
-    };
-    
-    return [self attributedStringByAddingStringAttributesAsBase:attributesDictionary];
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s fillOutBaseAsHint];
+    return s;
 }
 
 - (NSAttributedString *)attributedStringByAddingStringAttributesAsBase:(NSDictionary<NSAttributedStringKey, id> *)baseAttributes {
-    
-    /// Create string by adding values from `baseAttributes`, without overriding any of the attributes set for `self`
-    
     NSMutableAttributedString *s = self.mutableCopy;
-    
-    [s addAttributes:baseAttributes range:NSMakeRange(0, s.length)]; /// Base attributes will override string attributes
-    [self enumerateAttributesInRange:NSMakeRange(0, s.length) options:0 usingBlock:^(NSDictionary<NSAttributedStringKey,id> * _Nonnull attrs, NSRange range, BOOL * _Nonnull stop) {
-        [s addAttributes:attrs range:range];
-    }]; /// Override base attributes with original string attributes to undo overrides of original string attributes
-    
-    return s.copy; /// Why are we copying here?
+    [s addStringAttributesAsBase:baseAttributes];
+    return s;
 }
 
 #pragma mark Assign while keeping base
@@ -429,284 +501,408 @@ void assignAttributedStringKeepingBase(NSAttributedString *_Nonnull *_Nonnull as
     *assignee = newValue;
 }
 
-#pragma mark Attachment fallback
-
-- (NSString *)stringWithAttachmentDescriptions {
-    /// NSStrings can't display attachments. This method inserts a description of the attachment where the attachment would be in the attributedString.
-    ///     Can't override `- string` for some reason. Probably bc `- string` is already declared in another category or sth
-    
-    NSMutableString *result = [NSMutableString string];
-    
-    NSUInteger i = 0;
-    while (true) {
-        if (i >= self.length) break;
-        
-        NSRange range;
-        NSDictionary<NSAttributedStringKey, id> *attributes = [self attributesAtIndex:i effectiveRange:&range];
-        NSTextAttachment *attachment = attributes[NSAttachmentAttributeName];
-        if (attachment != nil) {
-            NSString *description = attachment.image.accessibilityDescription;
-            if (description != nil) {
-                [result appendString:description];
-            }
-        } else {
-            NSString *substring = [self attributedSubstringFromRange:range].string;
-            [result appendString:substring];
-        }
-        i = NSMaxRange(range);
-    }
-    
-    return result;
-}
-
 #pragma mark - CORE: String attrs
-///
-
+///     The immutable API. Each method makes one mutable copy and calls the in-place version from `NSMutableAttributedString (Additions)`.
+///     If you apply several of these in a row, use the in-place versions on one mutable copy instead. Otherwise every step copies the whole string.
 
 - (NSAttributedString *)attributedStringByAddingStringAttributes:(NSDictionary<NSAttributedStringKey, id> *)attributes forRange:(const NSRangePointer _Nullable)inRange {
-    
-    /// Set range to cover whole string if NULL
-    
-    NSRange range;
-    if (inRange == NULL) {
-        range = NSMakeRange(0, self.length);
-    } else {
-        range = *inRange;
-    }
-    
-    /// Create mutable copy
-    NSMutableAttributedString *ret = self.mutableCopy;
-    
-    /// Call lib method
-    [ret addAttributes:attributes range:range];
-    
-    /// Return
-    return ret;
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s addStringAttributes:attributes forRange:inRange];
+    return s;
 }
 
 - (NSAttributedString *)attributedStringByAddingStringAttributes:(NSDictionary<NSAttributedStringKey, id> *)attributes forSubstring:(NSString *)substring {
-    
-    NSRange range = [self.string rangeOfString:substring];
-    return [self attributedStringByAddingStringAttributes:attributes forRange:&range];
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s addStringAttributes:attributes forSubstring:substring];
+    return s;
 }
 
 #pragma mark Color
 
 - (NSAttributedString *)attributedStringByAddingColor:(NSColor *)color forSubstring:(NSString *)subStr {
-    
-    assert(subStr != nil);
-    
-    return [self attributedStringByAddingStringAttributes:@{
-        NSForegroundColorAttributeName: color //NSColor.secondaryLabelColor
-    } forSubstring:subStr];
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s addColor:color forSubstring:subStr];
+    return s;
 }
 
 - (NSAttributedString *)attributedStringByAddingColor:(NSColor *)color forRange:(const NSRangePointer _Nullable)range {
-    
-    return [self attributedStringByAddingStringAttributes:@{
-        NSForegroundColorAttributeName: color //NSColor.secondaryLabelColor
-    } forRange:range];
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s addColor:color forRange:range];
+    return s;
 }
 
 #pragma mark Baseline offset
 
 - (NSAttributedString *)attributedStringByAddingBaseLineOffset:(CGFloat)offset forRange:(const NSRangePointer _Nullable)range {
-    /// Offset in points
-    
-    return [self attributedStringByAddingStringAttributes:@{
-        NSBaselineOffsetAttributeName: @(offset),
-    } forRange:range];
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s addBaseLineOffset:offset forRange:range];
+    return s;
 }
 
 #pragma mark Hyperlink
 
 + (NSAttributedString *)hyperlinkFromString:(NSString *)inString withURL:(NSURL *)url {
     
-    /// Note: is .mutableCopy really necessary here?
-    NSAttributedString *string = [[NSAttributedString alloc] initWithString:inString];
-    string = [string attributedStringByAddingHyperlink:url forRange:NULL];
+    NSMutableAttributedString *string = [[NSMutableAttributedString alloc] initWithString:inString];
+    [string addHyperlink:url forRange:NULL];
     
     return string;
 }
 
 - (NSAttributedString *)attributedStringByAddingHyperlink:(NSURL *)url forSubstring:(NSString *)substring {
-    
-    NSRange subRange = [self.string rangeOfString:substring];
-    return [self attributedStringByAddingHyperlink:url forRange:&subRange];
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s addHyperlink:url forSubstring:substring];
+    return s;
 }
 
 - (NSAttributedString *)attributedStringByAddingHyperlink:(NSURL *_Nonnull)aURL forRange:(const NSRangePointer _Nullable)range {
-    
-    /// Notes:
-    /// - Making the text blue explicitly doesn't seem to be necessary. The links will still be blue if we don't do this.
-    /// - Adding an underline explicitlyis unnecessary in NSTextView but necessary in NSTextField
-    
-    return [self attributedStringByAddingStringAttributes:@{
-        NSLinkAttributeName: aURL.absoluteString,
-        NSUnderlineStyleAttributeName: @(NSUnderlineStyleSingle),
-        //        NSForegroundColorAttributeName: NSColor.blueColor,
-    } forRange:range];
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s addHyperlink:aURL forRange:range];
+    return s;
 }
 
-
 - (NSAttributedString *)attributedStringByAddingFont:(NSFont *)font forRange:(const NSRangePointer _Nullable)range {
-    
-    NSAttributedString *result = [self attributedStringByAddingStringAttributes:@{
-        NSFontAttributeName: font,
-    } forRange:range];
-    
-    return result;
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s addFont:font forRange:range];
+    return s;
 }
 
-
 #pragma mark - META CORE: Modify attrs
 
 - (NSAttributedString *)attributedStringByModifyingAttribute:(NSAttributedStringKey)attribute forRange:(const NSRangePointer _Nullable)inRange modifier:(id _Nullable (^)(id _Nullable attributeValue))modifier {
-    
-    NSRange range;
-    if (inRange == NULL) {
-        range = NSMakeRange(0, self.length);
-    } else {
-        range = *inRange;
-    }
-    
-    NSMutableAttributedString *result = self.mutableCopy;
-    
-    [self enumerateAttribute:attribute inRange:range options:0 usingBlock:^(id _Nullable value, NSRange range, BOOL * _Nonnull stop) {
-        
-        /// Notes:
-        /// Should we pass in `stop` to the callback?
-        /// Do we need to copy the value or sth?
-        
-        id newValue = modifier(value);
-        [result addAttribute:attribute value:newValue range:range];
-    }];
-    
-    return result;
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s modifyAttribute:attribute forRange:inRange modifier:modifier];
+    return s;
 }
 
 - (NSAttributedString *)attributedStringByModifyingAttribute:(NSAttributedStringKey)attribute forSubstring:(NSString *)substring modifier:(id _Nullable(^)(id _Nullable attributeValue))modifier {
-    
-    NSRange range = [self.string rangeOfString:substring];
-    return [self attributedStringByModifyingAttribute:attribute forRange:&range modifier:modifier];
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s modifyAttribute:attribute forSubstring:substring modifier:modifier];
+    return s;
 }
 
 #pragma mark - CORE: Paragraph style
 
 - (NSAttributedString *)attributedStringByModifyingParagraphStyleForRange:(const NSRangePointer _Nullable)inRange modifier:(NSParagraphStyle *_Nullable (^)(NSMutableParagraphStyle *_Nullable style))modifier {
-    
-    return [self attributedStringByModifyingAttribute:NSParagraphStyleAttributeName forRange:inRange modifier:^id _Nullable(id  _Nullable attributeValue) {
-        
-        NSMutableParagraphStyle *newValue = ((NSMutableParagraphStyle *)attributeValue).mutableCopy;
-        if (newValue == nil) {
-            newValue = [NSMutableParagraphStyle new];
-        }
-        return modifier(newValue);
-    }];
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s modifyParagraphStyleForRange:inRange modifier:modifier];
+    return s;
 }
 
 - (NSAttributedString *)attributedStringByModifyingParagraphStyleForSubstring:(NSString *)substring modifier:(NSParagraphStyle *_Nullable (^)(NSMutableParagraphStyle *_Nullable style))modifier {
-    
-    NSRange subRange = [self.string rangeOfString:substring];
-    return [self attributedStringByModifyingParagraphStyleForRange:&subRange modifier:modifier];
-    
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s modifyParagraphStyleForSubstring:substring modifier:modifier];
+    return s;
 }
 
 #pragma mark Paragraph spacing
 
 - (NSAttributedString *)attributedStringByAddingParagraphSpacing:(CGFloat)spacing forRange:(const NSRangePointer _Nullable)range {
-    
-    return [self attributedStringByModifyingParagraphStyleForRange:range modifier:^NSParagraphStyle * _Nullable(NSMutableParagraphStyle * _Nullable style) {
-        style.paragraphSpacing = spacing;
-        return style;
-    }];
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s addParagraphSpacing:spacing forRange:range];
+    return s;
 }
 
 #pragma mark Alignment
 
 - (NSAttributedString *)attributedStringByAddingAlignment:(NSTextAlignment)alignment forRange:(const NSRangePointer _Nullable)rangeIn {
-    
-    return [self attributedStringByModifyingParagraphStyleForRange:rangeIn modifier:^NSParagraphStyle * _Nullable(NSMutableParagraphStyle * _Nullable style) {
-        style.alignment = alignment;
-        return style;
-    }];
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s addAlignment:alignment forRange:rangeIn];
+    return s;
 }
 
-//- (NSAttributedString *)attributedStringByAddingAlignment:(NSTextAlignment)alignment forSubstring:(NSString * _Nullable)subStr {
-//
-//    return [self attributedStringByModifyingAttribute:NSParagraphStyleAttributeName forSubstring:subStr modifier:^NSParagraphStyle *(NSParagraphStyle *value) {
-//
-//        NSMutableParagraphStyle *newValue = value.mutableCopy;
-//        if (newValue == nil) {
-//            newValue = [NSMutableParagraphStyle new];
-//        }
-//        newValue.alignment = alignment;
-//        return newValue;
-//    }];
-//}
-
 #pragma mark - CORE: Font attributes
-/// Font attributes are a subset of attributed string attributes.
-///     It might be smart to use our function for adding string attributes instead of the function for adding font attributes
 
 - (NSAttributedString *)attributedStringByAddingFontAttributes:(NSDictionary<NSFontDescriptorAttributeName,id> *)attributes forRange:(const NSRangePointer _Nullable)inRange {
-    
-    /// TODO: Use `attributedStringByModifyingAttribute:`
-    
-    NSRange range;
-    if (inRange == NULL) {
-        range = NSMakeRange(0, self.length);
-    } else {
-        range = *inRange;
-    }
-    
-    NSMutableAttributedString *ret = self.mutableCopy;
-    
-    [self enumerateAttribute:NSFontAttributeName inRange:range options:0 usingBlock:^(id  _Nullable value, NSRange range, BOOL * _Nonnull stop) {
-        NSFont *currentFont = (NSFont *)value;
-        
-        if (currentFont == nil) {
-            currentFont = [NSFont systemFontOfSize:NSFont.systemFontSize];
-        }
-        NSFontDescriptor *newDescriptor = [currentFont.fontDescriptor fontDescriptorByAddingAttributes:attributes];
-        
-        NSFont *newFont = [NSFont fontWithDescriptor:newDescriptor size:currentFont.pointSize];
-        
-        [ret addAttribute:NSFontAttributeName value:newFont range:range];
-    }];
-    return ret;
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s addFontAttributes:attributes forRange:inRange];
+    return s;
 }
 
 #pragma mark CORE: Font traits
-/// Font traits are a subset of font attributes
-///     We have a completely separate function for adding font traits (instead of utilitzing the func for adding font attributes), so that we can add font traits without overriding exising ones. Not sure if this separate func is actually necessary to achieve this.
 
 - (NSAttributedString *)attributedStringByAddingFontTraits:(NSDictionary<NSFontDescriptorTraitKey, id> *)traits forRange:(const NSRangePointer _Nullable)inRange {
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s addFontTraits:traits forRange:inRange];
+    return s;
+}
+
+- (NSAttributedString *)attributedStringByAddingFontTraits:(NSDictionary<NSFontDescriptorTraitKey, id> *)traits forSubstring:(NSString *)substring {
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s addFontTraits:traits forSubstring:substring];
+    return s;
+}
+
+- (NSAttributedString *)attributedStringByAddingFontTraits:(NSDictionary<NSFontDescriptorTraitKey, id> *)traits {
     
-    /// TODO: Move this to modifyFont core
+    assert(false); /// Just pass nil for the range to achieve the same thing
     
-    /// This might mutate the font and the size
-    ///  (If there's no font, yet, this will assign systemFont at default size.)
+    return [self attributedStringByAddingFontTraits:traits forRange:NULL];
+}
+
+#pragma mark Weight
+
+- (NSAttributedString *)attributedStringByAddingWeight:(NSFontWeight)weight {
     
-    NSRange range;
-    if (inRange == NULL) {
-        range = NSMakeRange(0, self.length);
-    } else {
-        range = *inRange;
-    }
+    assert(false); /// Just pass nil for the range to achieve the same thing
     
-    NSMutableAttributedString *ret = self.mutableCopy;
-    [self enumerateAttribute:NSFontAttributeName inRange:range options:0 usingBlock:^(id  _Nullable value, NSRange range, BOOL * _Nonnull stop) {
-        
-        NSFont *currentFont = (NSFont *)value;
+    return [self attributedStringByAddingWeight:weight forRange:NULL];
+}
+
+- (NSAttributedString *)attributedStringByAddingWeight:(NSFontWeight)weight forRange:(const NSRangePointer _Nullable)range {
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s addWeight:weight forRange:range];
+    return s;
+}
+
+- (NSAttributedString *)attributedStringByAddingWeight:(NSFontWeight)weight forSubstring:(NSString *)string {
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s addWeight:weight forSubstring:string];
+    return s;
+}
+
+#pragma mark CORE: Symbolic font traits
+
+- (NSAttributedString *)attributedStringByAddingSymbolicFontTraits:(NSFontDescriptorSymbolicTraits)traits forRange:(const NSRangePointer _Nullable)inRange {
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s addSymbolicFontTraits:traits forRange:inRange];
+    return s;
+}
+
+- (NSAttributedString *)attributedStringByAddingSymbolicFontTraits:(NSFontDescriptorSymbolicTraits)traits forSubstring:(NSString *)subStr {
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s addSymbolicFontTraits:traits forSubstring:subStr];
+    return s;
+}
+
+#pragma mark Bold
+
+- (NSAttributedString *)attributedStringByAddingBoldForSubstring:(NSString *)subStr {
+    return [self attributedStringByAddingSymbolicFontTraits:NSFontDescriptorTraitBold forSubstring:subStr];
+}
+    
+- (NSAttributedString *)attributedStringByAddingBoldForRange:(const NSRangePointer _Nullable)range {
+    return [self attributedStringByAddingSymbolicFontTraits:NSFontDescriptorTraitBold forRange:range];
+}
+
+#pragma mark Italic
+
+- (NSAttributedString *)attributedStringByAddingItalicForSubstring:(NSString *)subStr {
+    return [self attributedStringByAddingSymbolicFontTraits:NSFontDescriptorTraitItalic forSubstring:subStr];
+}
+
+- (NSAttributedString *)attributedStringByAddingItalicForRange:(const NSRangePointer _Nullable)range {
+    return [self attributedStringByAddingSymbolicFontTraits:NSFontDescriptorTraitItalic forRange:range];
+}
+
+#pragma mark - Weird CORES
+
+#pragma mark Font size
+
+- (NSAttributedString *)attributedStringBySettingFontSize:(CGFloat)size {
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s setFontSize:size];
+    return s;
+}
+
+#pragma mark Weight
+
+- (NSMutableAttributedString *)attributedStringBySettingWeight:(NSInteger)weight forRange:(const NSRangePointer _Nullable)inRange {
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s setWeight:weight forRange:inRange];
+    return s;
+}
+
+- (NSMutableAttributedString *)attributedStringBySettingWeight:(NSInteger)weight forSubstring:(NSString * _Nonnull)subStr {
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s setWeight:weight forSubstring:subStr];
+    return s;
+}
+
+- (NSMutableAttributedString *)attributedStringBySettingWeight:(NSInteger)weight {
+    return [self attributedStringBySettingWeight:weight forRange:NULL];
+}
+
+- (NSAttributedString *)attributedStringBySettingThinForSubstring:(NSString *)subStr {
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s setThinForSubstring:subStr];
+    return s;
+}
+
+- (NSAttributedString *)attributedStringByAddingSemiBoldForSubstring:(NSString *)subStr {
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s addSemiBoldForSubstring:subStr];
+    return s;
+}
+
+#pragma mark - Special usecases
+
+- (NSAttributedString *)attributedStringByAddingHintStyle {
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s addHintStyle];
+    return s;
+}
+
+- (NSAttributedString *)attributedStringBySettingSemiBoldColorForSubstring:(NSString *)subStr {
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s setSemiBoldColorForSubstring:subStr];
+    return s;
+}
+
+#pragma mark - Compact attribute runs
+
+- (NSAttributedString *)attributedStringByCompactingAttributeRuns {
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s compactAttributeRuns];
+    return s;
+}
+
+@end
+
+#pragma mark - Font helpers
+/// Shared with `AttributedStringBuilder`
+
+///
+/// Font cache
+///
+
+/// Notes:
+/// - Deriving a font (`fontDescriptorByAddingAttributes:` + `fontWithDescriptor:size:`, or NSFontManager) goes through font matching, which is slow. And our UI strings keep asking for the same few fonts. So we memoize: (base font, operation, argument) -> resolved font.
+/// - NSFont is immutable, so sharing the results between threads is fine. All access to the cache is `@synchronized`.
+/// - All font derivation in this file and in `AttributedStringBuilder` goes through the helpers below, so each unique (font, change) pair is resolved once per process, no matter which method asked for it.
+/// - There are only a handful of distinct fonts in practice. If we ever get past `kFontCacheCapacity` entries, we just start over instead of tracking recency.
+/// - Resolving can fail (NSFontManager returns nil if the family doesn't have the weight, `fontWithDescriptor:size:` if nothing matches). Then the helpers return the font they started from, so callers never get nil. Failures aren't cached.
+
+typedef NS_ENUM(NSInteger, FontCacheOperation) {
+    kFontCacheOperationTraits = 0,
+    kFontCacheOperationSymbolicTraits,
+    kFontCacheOperationSize,
+    kFontCacheOperationManagerWeight,
+    kFontCacheOperationAttributes,
+};
+
+static const NSUInteger kFontCacheCapacity = 1024;
+
+@interface FontCacheKey : NSObject <NSCopying> {
+    @public
+    NSFont *_font;
+    FontCacheOperation _operation;
+    id _argument;           /// NSDictionary of traits or NSNumber
+    NSUInteger _hash;
+}
+@end
+@implementation FontCacheKey
+
+- (instancetype)initWithFont:(NSFont *)font operation:(FontCacheOperation)operation argument:(id)argument {
+    self = [super init];
+    if (self) {
+        _font = font;
+        _operation = operation;
+        _argument = argument;
         
-        if (currentFont == nil) {
-            //            assert(false);
-            currentFont = [NSFont systemFontOfSize:NSFont.systemFontSize];
+        NSUInteger argumentHash = [argument isKindOfClass:[NSDictionary class]] ? dictionaryContentHash(argument) : [argument hash];
+        _hash = font.hash ^ (argumentHash * 17) ^ (NSUInteger)operation;
+    }
+    return self;
+}
+- (id)copyWithZone:(NSZone *)zone {
+    return self; /// Immutable
+}
+- (NSUInteger)hash {
+    return _hash;
+}
+- (BOOL)isEqual:(FontCacheKey *)other {
+    if (self == other) return YES;
+    if (![other isKindOfClass:[FontCacheKey class]]) return NO;
+    return _hash == other->_hash && _operation == other->_operation && [_font isEqual:other->_font] && [_argument isEqual:other->_argument];
+}
+@end
+
+static NSMutableDictionary<FontCacheKey *, NSFont *> *_fontCache;
+static FontCacheStatistics _fontCacheStats;
+
+static NSMutableDictionary<FontCacheKey *, NSFont *> *fontCache(void) {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _fontCache = [NSMutableDictionary dictionary];
+    });
+    return _fontCache;
+}
+
+static NSFont *cachedFont(NSFont *font, FontCacheOperation operation, id argument, NSFont *(^resolve)(void)) {
+    
+    NSMutableDictionary<FontCacheKey *, NSFont *> *cache = fontCache();
+    FontCacheKey *key = [[FontCacheKey alloc] initWithFont:font operation:operation argument:argument];
+    
+    @synchronized (cache) {
+        NSFont *hit = cache[key];
+        if (hit != nil) {
+            _fontCacheStats.hits += 1;
+            return hit;
+        }
+    }
+    
+    /// Resolve outside the lock so other threads don't have to wait for us.
+    NSTimeInterval startTime = NSDate.timeIntervalSinceReferenceDate;
+    NSFont *result = resolve();
+    NSTimeInterval resolveTime = NSDate.timeIntervalSinceReferenceDate - startTime;
+    if (result == nil) return font; /// Keep the font we started from. Don't cache that.
+    
+    @synchronized (cache) {
+        _fontCacheStats.misses += 1;
+        _fontCacheStats.missSeconds += resolveTime;
+        if (cache.count >= kFontCacheCapacity) {
+            [cache removeAllObjects];
         }
+        cache[key] = result;
+    }
+    return result;
+}
+
+FontCacheStatistics fontCacheStatistics(void) {
+    NSMutableDictionary *cache = fontCache();
+    @synchronized (cache) {
+        FontCacheStatistics stats = _fontCacheStats;
+        stats.count = cache.count;
+        return stats;
+    }
+}
+
+void clearFontCache(void) {
+    NSMutableDictionary *cache = fontCache();
+    @synchronized (cache) {
+        [cache removeAllObjects];
+        _fontCacheStats = (FontCacheStatistics){0};
+    }
+}
+
+///
+/// Helpers
+///
+
+static NSFont *defaultFont(void) {
+    /// The font runs without a font get. Same instance as in `fillOutBaseAttributes()`, so we don't look up the system font for every run.
+    ///     Resolvers other than the AppKit one might not have a font, so fall back to the system font.
+    static NSFont *font;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        font = fillOutBaseAttributes()[NSFontAttributeName] ?: [NSFont systemFontOfSize:NSFont.systemFontSize];
+    });
+    return font;
+}
+
+NSFont *fontByAddingFontTraits(NSFont *_Nullable font, NSDictionary<NSFontDescriptorTraitKey, id> *traits) {
+    
+    /// Merges `traits` into the existing traits of `font`. (If there's no font, this uses systemFont at default size.)
+    
+    if (font == nil) {
+        font = defaultFont();
+    }
+    
+    return cachedFont(font, kFontCacheOperationTraits, traits, ^NSFont *{
         
         /// Get existing traits
-        NSDictionary<NSFontDescriptorTraitKey, id> *currentTraits = [currentFont.fontDescriptor fontAttributes][NSFontTraitsAttribute];
+        NSDictionary<NSFontDescriptorTraitKey, id> *currentTraits = [font.fontDescriptor fontAttributes][NSFontTraitsAttribute];
         if (currentTraits == nil) {
             currentTraits = [NSMutableDictionary dictionary];
         }
@@ -717,56 +913,424 @@ void assignAttributedStringKeepingBase(NSAttributedString *_Nonnull *_Nonnull as
         }
         
         /// Set new overriden traits
-        NSFontDescriptor *newDescriptor = [currentFont.fontDescriptor fontDescriptorByAddingAttributes:@{
+        NSFontDescriptor *newDescriptor = [font.fontDescriptor fontDescriptorByAddingAttributes:@{
             NSFontTraitsAttribute: newTraits
         }];
-        NSFont *newFont = [NSFont fontWithDescriptor:newDescriptor size:currentFont.pointSize];
+        return [NSFont fontWithDescriptor:newDescriptor size:font.pointSize];
+    });
+}
+
+NSFont *fontByAddingSymbolicFontTraits(NSFont *_Nullable font, NSFontDescriptorSymbolicTraits traits) {
+    
+    if (font == nil) {
+        font = defaultFont();
+    }
+    
+    return cachedFont(font, kFontCacheOperationSymbolicTraits, @(traits), ^NSFont *{
+        NSFontDescriptor *newFontDescriptor = [font.fontDescriptor fontDescriptorWithSymbolicTraits:traits];
+        return [NSFont fontWithDescriptor:newFontDescriptor size:font.pointSize];
+    });
+}
+
+NSFont *fontBySettingSize(NSFont *_Nullable font, CGFloat size) {
+    
+    if (font == nil) {
+        font = defaultFont();
+    }
+    
+    if (font.pointSize == size) return font; /// Nothing to resolve
+    
+    return cachedFont(font, kFontCacheOperationSize, @(size), ^NSFont *{
+        return [NSFont fontWithDescriptor:font.fontDescriptor size:size];
+    });
+}
+
+NSFont *fontBySettingManagerWeight(NSFont *_Nullable font, NSInteger weight) {
+    
+    /// Weight is int between 0 and 15. 5 is normal weight. See `setWeight:forRange:`
+    
+    if (font == nil) {
+        font = defaultFont();
+    }
+    
+    return cachedFont(font, kFontCacheOperationManagerWeight, @(weight), ^NSFont *{
+        NSString *fontFamily = font.familyName;
+        NSFontTraitMask traits = [NSFontManager.sharedFontManager traitsOfFont:font];
+        CGFloat size = font.pointSize;
+        return [NSFontManager.sharedFontManager fontWithFamily:fontFamily traits:traits weight:weight size:size];
+    });
+}
+
+NSFont *fontByAddingFontAttributes(NSFont *_Nullable font, NSDictionary<NSFontDescriptorAttributeName, id> *attributes) {
+    
+    if (font == nil) {
+        font = defaultFont();
+    }
+    
+    return cachedFont(font, kFontCacheOperationAttributes, attributes, ^NSFont *{
+        NSFontDescriptor *newDescriptor = [font.fontDescriptor fontDescriptorByAddingAttributes:attributes];
+        return [NSFont fontWithDescriptor:newDescriptor size:font.pointSize];
+    });
+}
+
+#pragma mark - Style registry
+
+/// Notes:
+/// - Every label render used to build a fresh base attributes dictionary and look up the system font. Most of our strings end up with the same handful of attribute dictionaries and paragraph styles, so we keep one shared immutable instance per distinct content and hand that out instead.
+/// - Interning is by content: `internedAttributes()` returns the registered dictionary that `isEqual:` to the argument, or registers a copy. Paragraph styles inside a dictionary are interned too, so equal dictionaries also share their paragraph style.
+/// - The objects are wrapped in `StyleRegistryKey`, which hashes dictionaries with `dictionaryContentHash()`.
+/// - Same policy as the font cache: `@synchronized`, and if we ever get past `kStyleRegistryCapacity` entries, we start over. Instances that were handed out stay valid, they're just not shared with later lookups anymore.
+
+static const NSUInteger kStyleRegistryCapacity = 1024;
+
+@interface StyleRegistryKey : NSObject <NSCopying> {
+    @public
+    id _object;             /// NSDictionary or NSParagraphStyle
+    NSUInteger _hash;
+}
+@end
+@implementation StyleRegistryKey
+
+- (instancetype)initWithObject:(id)object {
+    self = [super init];
+    if (self) {
+        _object = object;
+        _hash = [object isKindOfClass:[NSDictionary class]] ? dictionaryContentHash(object) : [object hash];
+    }
+    return self;
+}
+- (id)copyWithZone:(NSZone *)zone {
+    return self; /// Immutable
+}
+- (NSUInteger)hash {
+    return _hash;
+}
+- (BOOL)isEqual:(StyleRegistryKey *)other {
+    if (self == other) return YES;
+    if (![other isKindOfClass:[StyleRegistryKey class]]) return NO;
+    return _hash == other->_hash && [_object isEqual:other->_object];
+}
+@end
+
+static NSMutableDictionary<StyleRegistryKey *, id> *_styleRegistry;
+static StyleRegistryStatistics _styleRegistryStats;
+
+static NSMutableDictionary<StyleRegistryKey *, id> *styleRegistry(void) {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _styleRegistry = [NSMutableDictionary dictionary];
+    });
+    return _styleRegistry;
+}
+
+static id internedObject(id object, id (^makeImmutable)(void)) {
+    
+    NSMutableDictionary<StyleRegistryKey *, id> *registry = styleRegistry();
+    StyleRegistryKey *key = [[StyleRegistryKey alloc] initWithObject:object];
+    
+    @synchronized (registry) {
+        id hit = registry[key];
+        if (hit != nil) {
+            _styleRegistryStats.hits += 1;
+            return hit;
+        }
+    }
+    
+    id result = makeImmutable();
+    key = [[StyleRegistryKey alloc] initWithObject:result]; /// Don't keep a reference to the caller's (possibly mutable) object
+    
+    @synchronized (registry) {
+        id hit = registry[key]; /// Another thread might have registered it in the meantime
+        if (hit != nil) {
+            _styleRegistryStats.hits += 1;
+            return hit;
+        }
+        _styleRegistryStats.misses += 1;
+        if (registry.count >= kStyleRegistryCapacity) {
+            [registry removeAllObjects];
+        }
+        registry[key] = result;
+    }
+    return result;
+}
+
+NSParagraphStyle *internedParagraphStyle(NSParagraphStyle *style) {
+    return internedObject(style, ^id{
+        return style.copy;
+    });
+}
+
+NSDictionary<NSAttributedStringKey, id> *internedAttributes(NSDictionary<NSAttributedStringKey, id> *attributes) {
+    return internedObject(attributes, ^id{
+        NSParagraphStyle *style = attributes[NSParagraphStyleAttributeName];
+        if (style == nil) return attributes.copy;
+        NSMutableDictionary *result = attributes.mutableCopy;
+        result[NSParagraphStyleAttributeName] = internedParagraphStyle(style);
+        return result.copy;
+    });
+}
+
+StyleRegistryStatistics styleRegistryStatistics(void) {
+    NSMutableDictionary *registry = styleRegistry();
+    @synchronized (registry) {
+        StyleRegistryStatistics stats = _styleRegistryStats;
+        stats.count = registry.count;
+        return stats;
+    }
+}
+
+void clearStyleRegistry(void) {
+    NSMutableDictionary *registry = styleRegistry();
+    @synchronized (registry) {
+        [registry removeAllObjects];
+        _styleRegistryStats = (StyleRegistryStatistics){0};
+    }
+}
+
+@implementation NSMutableAttributedString (Additions)
+
+/// In-place versions of the `NSAttributedString (Additions)` methods. The immutable methods are built on these.
+
+static NSRange resolveRange(NSAttributedString *s, const NSRangePointer _Nullable inRange) {
+    /// NULL means the whole string
+    return (inRange == NULL) ? NSMakeRange(0, s.length) : *inRange;
+}
+
+#pragma mark Fill out base
+
+- (void)fillOutBase {
+    
+    /// Fill out default attributes, because layout code won't work if the string doesn't have a font and a textColor attribute on every character. See https://stackoverflow.com/questions/13621084/boundingrectwithsize-for-nsattributedstring-returning-wrong-size
+    
+    [self addStringAttributesAsBase:fillOutBaseAttributes()];
+}
+
+- (void)fillOutBaseAsHint {
+    [self addStringAttributesAsBase:fillOutBaseAsHintAttributes()];
+}
+
+- (void)addStringAttributesAsBase:(NSDictionary<NSAttributedStringKey, id> *)baseAttributes {
+    
+    /// Add values from `baseAttributes`, without overriding any of the attributes that are already set
+    ///
+    /// Notes:
+    /// - We walk the runs once and write each run's merged dictionary once. (We used to add the base over the whole string and then re-add every original run on top, which wrote every character's attributes twice and needed a copy of the string.)
+    /// - Setting attributes within the enumerated run is allowed for NSMutableAttributedString.
+    /// - Runs without attributes (most labels are a single one of those) just get `baseAttributes` itself. With a dictionary from the style registry, that's the shared instance.
+    /// - Runs that already have every base key are left alone.
+    
+    NSUInteger length = self.length;
+    if (length == 0 || baseAttributes.count == 0) return;
+    
+    [self beginEditing];
+    [self enumerateAttributesInRange:NSMakeRange(0, length) options:0 usingBlock:^(NSDictionary<NSAttributedStringKey,id> * _Nonnull attrs, NSRange range, BOOL * _Nonnull stop) {
         
-        [ret addAttribute:NSFontAttributeName value:newFont range:range];
+        if (attrs.count == 0) {
+            [self setAttributes:baseAttributes range:range];
+            return;
+        }
+        
+        NSMutableDictionary<NSAttributedStringKey, id> *merged = nil;
+        for (NSAttributedStringKey key in baseAttributes) {
+            if (attrs[key] != nil) continue;
+            if (merged == nil) merged = attrs.mutableCopy;
+            merged[key] = baseAttributes[key];
+        }
+        if (merged != nil) {
+            [self setAttributes:merged range:range];
+        }
     }];
+    [self endEditing];
+}
+
+#pragma mark - CORE: String attrs
+
+- (void)addStringAttributes:(NSDictionary<NSAttributedStringKey, id> *)attributes forRange:(const NSRangePointer _Nullable)inRange {
+    [self addAttributes:attributes range:resolveRange(self, inRange)];
+}
+
+- (void)addStringAttributes:(NSDictionary<NSAttributedStringKey, id> *)attributes forSubstring:(NSString *)substring {
+    NSRange range = [self.string rangeOfString:substring];
+    [self addStringAttributes:attributes forRange:&range];
+}
+
+#pragma mark Color
+
+- (void)addColor:(NSColor *)color forSubstring:(NSString *)subStr {
+    
+    assert(subStr != nil);
     
-    return ret;
+    [self addStringAttributes:@{
+        NSForegroundColorAttributeName: color //NSColor.secondaryLabelColor
+    } forSubstring:subStr];
 }
 
-- (NSAttributedString *)attributedStringByAddingFontTraits:(NSDictionary<NSFontDescriptorTraitKey, id> *)traits forSubstring:(NSString *)substring {
+- (void)addColor:(NSColor *)color forRange:(const NSRangePointer _Nullable)range {
+    
+    [self addStringAttributes:@{
+        NSForegroundColorAttributeName: color //NSColor.secondaryLabelColor
+    } forRange:range];
+}
+
+#pragma mark Baseline offset
+
+- (void)addBaseLineOffset:(CGFloat)offset forRange:(const NSRangePointer _Nullable)range {
+    /// Offset in points
+    
+    [self addStringAttributes:@{
+        NSBaselineOffsetAttributeName: @(offset),
+    } forRange:range];
+}
+
+#pragma mark Hyperlink
+
+- (void)addHyperlink:(NSURL *)url forSubstring:(NSString *)substring {
+    NSRange subRange = [self.string rangeOfString:substring];
+    [self addHyperlink:url forRange:&subRange];
+}
+
+- (void)addHyperlink:(NSURL *_Nonnull)aURL forRange:(const NSRangePointer _Nullable)range {
+    
+    /// Notes:
+    /// - Making the text blue explicitly doesn't seem to be necessary. The links will still be blue if we don't do this.
+    /// - Adding an underline explicitlyis unnecessary in NSTextView but necessary in NSTextField
+    
+    [self addStringAttributes:@{
+        NSLinkAttributeName: aURL.absoluteString,
+        NSUnderlineStyleAttributeName: @(NSUnderlineStyleSingle),
+        //        NSForegroundColorAttributeName: NSColor.blueColor,
+    } forRange:range];
+}
+
+- (void)addFont:(NSFont *)font forRange:(const NSRangePointer _Nullable)range {
+    [self addStringAttributes:@{
+        NSFontAttributeName: font,
+    } forRange:range];
+}
+
+#pragma mark - META CORE: Modify attrs
+
+- (void)modifyAttribute:(NSAttributedStringKey)attribute forRange:(const NSRangePointer _Nullable)inRange modifier:(id _Nullable (^)(id _Nullable attributeValue))modifier {
     
+    /// Notes:
+    /// - Mutating the attributes inside the enumerated range is allowed for NSMutableAttributedString.
+    /// - Should we pass in `stop` to the callback?
+    /// - Do we need to copy the value or sth?
+    
+    [self enumerateAttribute:attribute inRange:resolveRange(self, inRange) options:0 usingBlock:^(id _Nullable value, NSRange range, BOOL * _Nonnull stop) {
+        id newValue = modifier(value);
+        [self addAttribute:attribute value:newValue range:range];
+    }];
+}
+
+- (void)modifyAttribute:(NSAttributedStringKey)attribute forSubstring:(NSString *)substring modifier:(id _Nullable(^)(id _Nullable attributeValue))modifier {
     NSRange range = [self.string rangeOfString:substring];
-    return [self attributedStringByAddingFontTraits:traits forRange:&range];
+    [self modifyAttribute:attribute forRange:&range modifier:modifier];
 }
 
-- (NSAttributedString *)attributedStringByAddingFontTraits:(NSDictionary<NSFontDescriptorTraitKey, id> *)traits {
+- (void)modifyFontForRange:(const NSRangePointer _Nullable)inRange modifier:(NSFont *(^)(NSFont *font))modifier {
     
-    assert(false); /// Just pass nil for the range to achieve the same thing
+    /// Like `modifyAttribute:` for the font, but runs without a font get the system font at the default size first.
+    ///     Neighbouring runs usually have the same font (they differ in color, links, etc.), so we remember the last font we derived and skip the font helpers when it comes up again.
     
-    NSRange range = NSMakeRange(0, self.length);
-    return [self attributedStringByAddingFontTraits:traits forRange:&range];
+    __block NSFont *lastFont = nil;
+    __block NSFont *lastResult = nil;
+    [self modifyAttribute:NSFontAttributeName forRange:inRange modifier:^id _Nullable(id  _Nullable attributeValue) {
+        NSFont *currentFont = (NSFont *)attributeValue;
+        if (currentFont == nil) {
+            currentFont = defaultFont();
+        }
+        if (currentFont != lastFont) {
+            lastFont = currentFont;
+            lastResult = modifier(currentFont);
+        }
+        return lastResult;
+    }];
 }
 
+#pragma mark - CORE: Paragraph style
 
+- (void)modifyParagraphStyleForRange:(const NSRangePointer _Nullable)inRange modifier:(NSParagraphStyle *_Nullable (^)(NSMutableParagraphStyle *_Nullable style))modifier {
+    
+    [self modifyAttribute:NSParagraphStyleAttributeName forRange:inRange modifier:^id _Nullable(id  _Nullable attributeValue) {
+        
+        NSMutableParagraphStyle *newValue = ((NSMutableParagraphStyle *)attributeValue).mutableCopy;
+        if (newValue == nil) {
+            newValue = [NSMutableParagraphStyle new];
+        }
+        NSParagraphStyle *result = modifier(newValue);
+        return result ? internedParagraphStyle(result) : nil; /// So runs with the same style share one instance
+    }];
+}
 
-#pragma mark Weight
+- (void)modifyParagraphStyleForSubstring:(NSString *)substring modifier:(NSParagraphStyle *_Nullable (^)(NSMutableParagraphStyle *_Nullable style))modifier {
+    NSRange subRange = [self.string rangeOfString:substring];
+    [self modifyParagraphStyleForRange:&subRange modifier:modifier];
+}
 
-- (NSAttributedString *)attributedStringByAddingWeight:(NSFontWeight)weight {
+#pragma mark Paragraph spacing
+
+- (void)addParagraphSpacing:(CGFloat)spacing forRange:(const NSRangePointer _Nullable)range {
     
-    assert(false); /// Just pass nil for the range to achieve the same thing
+    [self modifyParagraphStyleForRange:range modifier:^NSParagraphStyle * _Nullable(NSMutableParagraphStyle * _Nullable style) {
+        style.paragraphSpacing = spacing;
+        return style;
+    }];
+}
+
+#pragma mark Alignment
+
+- (void)addAlignment:(NSTextAlignment)alignment forRange:(const NSRangePointer _Nullable)rangeIn {
     
-    return [self attributedStringByAddingFontTraits:@{
-        NSFontWeightTrait: @(weight),
+    [self modifyParagraphStyleForRange:rangeIn modifier:^NSParagraphStyle * _Nullable(NSMutableParagraphStyle * _Nullable style) {
+        style.alignment = alignment;
+        return style;
     }];
 }
 
-- (NSAttributedString *)attributedStringByAddingWeight:(NSFontWeight)weight forRange:(const NSRangePointer _Nullable)range {
+#pragma mark - CORE: Font attributes
+/// Font attributes are a subset of attributed string attributes.
+///     It might be smart to use our function for adding string attributes instead of the function for adding font attributes
+
+- (void)addFontAttributes:(NSDictionary<NSFontDescriptorAttributeName,id> *)attributes forRange:(const NSRangePointer _Nullable)inRange {
+    
+    [self modifyFontForRange:inRange modifier:^NSFont *(NSFont *currentFont) {
+        return fontByAddingFontAttributes(currentFont, attributes);
+    }];
+}
+
+#pragma mark CORE: Font traits
+/// Font traits are a subset of font attributes
+///     We have a completely separate function for adding font traits (instead of utilitzing the func for adding font attributes), so that we can add font traits without overriding exising ones. Not sure if this separate func is actually necessary to achieve this.
+
+- (void)addFontTraits:(NSDictionary<NSFontDescriptorTraitKey, id> *)traits forRange:(const NSRangePointer _Nullable)inRange {
+    
+    /// This might mutate the font and the size
+    ///  (If there's no font, yet, this will assign systemFont at default size.)
+    
+    [self modifyFontForRange:inRange modifier:^NSFont *(NSFont *currentFont) {
+        return fontByAddingFontTraits(currentFont, traits);
+    }];
+}
+
+- (void)addFontTraits:(NSDictionary<NSFontDescriptorTraitKey, id> *)traits forSubstring:(NSString *)substring {
+    NSRange range = [self.string rangeOfString:substring];
+    [self addFontTraits:traits forRange:&range];
+}
+
+#pragma mark Weight
+
+- (void)addWeight:(NSFontWeight)weight forRange:(const NSRangePointer _Nullable)range {
     
     ///  Weight is a double between -1 and 1
     ///  You can use predefined constants starting with NSFontWeight, such as NSFontWeightBold
-    return [self attributedStringByAddingFontTraits:@{
+    [self addFontTraits:@{
         NSFontWeightTrait: @(weight),
     } forRange:range];
 }
 
-- (NSAttributedString *)attributedStringByAddingWeight:(NSFontWeight)weight forSubstring:(NSString *)string {
-    
-    return [self attributedStringByAddingFontTraits:@{
+- (void)addWeight:(NSFontWeight)weight forSubstring:(NSString *)string {
+    [self addFontTraits:@{
         NSFontWeightTrait: @(weight)
     } forSubstring:string];
 }
@@ -774,180 +1338,107 @@ void assignAttributedStringKeepingBase(NSAttributedString *_Nonnull *_Nonnull as
 #pragma mark CORE: Symbolic font traits
 /// Symbolic font traits are an abstract and easy way to control font traits and font attributes
 
-- (NSAttributedString *)attributedStringByAddingSymbolicFontTraits:(NSFontDescriptorSymbolicTraits)traits forRange:(const NSRangePointer _Nullable)inRange {
+- (void)addSymbolicFontTraits:(NSFontDescriptorSymbolicTraits)traits forRange:(const NSRangePointer _Nullable)inRange {
     
     /// This might unintentionally mutate  font and size!
     /// (If there's no font, yet, this will asign systemFont at default size)
     
-    NSRange range;
-    if (inRange == NULL) {
-        range = NSMakeRange(0, self.length);
-    } else {
-        range = *inRange;
-    }
-    
     NSDictionary *originalAttributes = [self attributesAtIndex:0 effectiveRange:nil];
-    NSFont *originalFont = originalAttributes[NSFontAttributeName];
-    
-    if (originalFont == nil) {
-//        assert(false);
-        originalFont = [NSFont systemFontOfSize:NSFont.systemFontSize];
-    }
-    
-    NSFontDescriptor *newFontDescriptor = [originalFont.fontDescriptor fontDescriptorWithSymbolicTraits:traits];
-    NSFont *newFont = [NSFont fontWithDescriptor:newFontDescriptor size:originalFont.pointSize];
+    NSFont *newFont = fontByAddingSymbolicFontTraits(originalAttributes[NSFontAttributeName], traits);
     
-    NSMutableAttributedString *ret = [[NSMutableAttributedString alloc] initWithAttributedString:self];
-    [ret addAttribute:NSFontAttributeName value:newFont range:range];
-    
-    return ret;
+    [self addAttribute:NSFontAttributeName value:newFont range:resolveRange(self, inRange)];
 }
-- (NSAttributedString *)attributedStringByAddingSymbolicFontTraits:(NSFontDescriptorSymbolicTraits)traits forSubstring:(NSString *)subStr {
-    
+
+- (void)addSymbolicFontTraits:(NSFontDescriptorSymbolicTraits)traits forSubstring:(NSString *)subStr {
     NSRange range = [self.string rangeOfString:subStr];
-    return [self attributedStringByAddingSymbolicFontTraits:traits forRange:&range];
+    [self addSymbolicFontTraits:traits forRange:&range];
 }
 
 #pragma mark Bold
 
-- (NSAttributedString *)attributedStringByAddingBoldForSubstring:(NSString *)subStr {
-    return [self attributedStringByAddingSymbolicFontTraits:NSFontDescriptorTraitBold forSubstring:subStr];
+- (void)addBoldForSubstring:(NSString *)subStr {
+    [self addSymbolicFontTraits:NSFontDescriptorTraitBold forSubstring:subStr];
 }
-    
-- (NSAttributedString *)attributedStringByAddingBoldForRange:(const NSRangePointer _Nullable)range {
-    return [self attributedStringByAddingSymbolicFontTraits:NSFontDescriptorTraitBold forRange:range];
+
+- (void)addBoldForRange:(const NSRangePointer _Nullable)range {
+    [self addSymbolicFontTraits:NSFontDescriptorTraitBold forRange:range];
 }
 
 #pragma mark Italic
 
-- (NSAttributedString *)attributedStringByAddingItalicForSubstring:(NSString *)subStr {
-    return [self attributedStringByAddingSymbolicFontTraits:NSFontDescriptorTraitItalic forSubstring:subStr];
+- (void)addItalicForSubstring:(NSString *)subStr {
+    [self addSymbolicFontTraits:NSFontDescriptorTraitItalic forSubstring:subStr];
 }
 
-- (NSAttributedString *)attributedStringByAddingItalicForRange:(const NSRangePointer _Nullable)range {
-    return [self attributedStringByAddingSymbolicFontTraits:NSFontDescriptorTraitItalic forRange:range];
+- (void)addItalicForRange:(const NSRangePointer _Nullable)range {
+    [self addSymbolicFontTraits:NSFontDescriptorTraitItalic forRange:range];
 }
 
 #pragma mark - Weird CORES
 /// Using  weird methods that can't be reduced to the other CORE methods
-///
-///
 
 #pragma mark Font size
 
-- (NSAttributedString *)attributedStringBySettingFontSize:(CGFloat)size {
-    
-    /// TODO: Move this to modifiyFont core
+- (void)setFontSize:(CGFloat)size {
     
-    /// I think it is more  ideal to use `attributedStringByAddingFontAttributes:` (ideally build a wrapper around it for setting size)
-    ///  NSFontManager is not intended for this, this is probably slower than using `attributedStringByAddingFontAttributes:`.
+    /// I think it is more  ideal to use `addFontAttributes:` (ideally build a wrapper around it for setting size)
     ///
     /// How to use:
     /// - You can pass in NSFont.smallSystemFontSize, which is 11.0
     /// - You can pass in NSFont.systemFontSize, which is 13.0 I believe
     /// - You can pass in other arbitrary floating point numbers
     
-    
-    NSMutableAttributedString *ret = self.mutableCopy;
-    NSRange enumerateRange = NSMakeRange(0, self.length);
-    
-    [self enumerateAttribute:NSFontAttributeName inRange:enumerateRange options:0 usingBlock:^(id  _Nullable value, NSRange range, BOOL * _Nonnull stop) {
-        
-        NSFont *currentFont = (NSFont *)value;
-        if (currentFont == nil) {
-            currentFont = [NSFont systemFontOfSize:NSFont.systemFontSize];
-        }
-            
-        NSFont *newFont = [NSFont fontWithDescriptor:currentFont.fontDescriptor size:size];
-        
-        [ret addAttribute:NSFontAttributeName value:newFont range:range];
+    [self modifyFontForRange:NULL modifier:^NSFont *(NSFont *currentFont) {
+        return fontBySettingSize(currentFont, size);
     }];
-    
-    
-    return ret;
 }
 
 #pragma mark Weight
 
-- (NSMutableAttributedString *)attributedStringBySettingWeight:(NSInteger)weight forRange:(const NSRangePointer _Nullable)inRange {
-
-    /// TODO: Move this to modifyFont core
+- (void)setWeight:(NSInteger)weight forRange:(const NSRangePointer _Nullable)inRange {
     
     /// Notes:
     /// - This uses NSFontManager init to get a font of the desired size. Should probably stop using this at some point.
     /// - Weight is int between 0 and 15. 5 is normal weight
-    ///   - I think it is more  ideal to use `attributedStringByAddingFontTraits:` (or `attributedStringByAddingWeight:` which is built on it)
-    ///   - This function is for legacy. It only allows 15 weights and is incompatible with NSFontWeight. NSFontManager is not intended for this I think. Remove this eventually in favour of `attributedStringByAddingWeight:`
+    ///   - I think it is more  ideal to use `addFontTraits:` (or `addWeight:` which is built on it)
+    ///   - This function is for legacy. It only allows 15 weights and is incompatible with NSFontWeight. NSFontManager is not intended for this I think. Remove this eventually in favour of `addWeight:`
     /// - This will also add systemFont at default size to subRange if there is no font, yet
-
-    NSRange range;
-    if (inRange == NULL) {
-        range = NSMakeRange(0, self.length);
-    } else {
-        range = *inRange;
-    }
     
-    NSMutableAttributedString *ret = self.mutableCopy;
-
-    [self enumerateAttribute:NSFontAttributeName inRange:range options:0 usingBlock:^(id  _Nullable value, NSRange range, BOOL * _Nonnull stop) {
-        NSFont *currentFont = (NSFont *)value;
-
-        if (currentFont == nil) {
-            currentFont = [NSFont systemFontOfSize:NSFont.systemFontSize];
-        }
-
-        NSString *fontFamily = currentFont.familyName;
-        NSFontTraitMask traits = [NSFontManager.sharedFontManager traitsOfFont:currentFont];
-//        NSInteger originalWeight = [NSFontManager.sharedFontManager weightOfFont:currentFont];
-        CGFloat size = currentFont.pointSize;
-
-        NSFont *newFont = [NSFontManager.sharedFontManager fontWithFamily:fontFamily traits:traits weight:weight size:size];
-
-        [ret addAttribute:NSFontAttributeName value:newFont range:range];
+    [self modifyFontForRange:inRange modifier:^NSFont *(NSFont *currentFont) {
+        return fontBySettingManagerWeight(currentFont, weight);
     }];
-    return ret;
 }
 
-- (NSMutableAttributedString *)attributedStringBySettingWeight:(NSInteger)weight forSubstring:(NSString * _Nonnull)subStr {
+- (void)setWeight:(NSInteger)weight forSubstring:(NSString * _Nonnull)subStr {
     NSRange subRange = [self.string rangeOfString:subStr];
-    return [self attributedStringBySettingWeight:weight forRange:&subRange];
+    [self setWeight:weight forRange:&subRange];
 }
 
-- (NSMutableAttributedString *)attributedStringBySettingWeight:(NSInteger)weight {
-    return [self attributedStringBySettingWeight:weight forRange:NULL];
-}
-
-- (NSAttributedString *)attributedStringBySettingThinForSubstring:(NSString *)subStr {
-
+- (void)setThinForSubstring:(NSString *)subStr {
     NSInteger weight = 3;
-
-    return [self attributedStringBySettingWeight:weight forSubstring:subStr];
+    [self setWeight:weight forSubstring:subStr];
 }
 
-- (NSAttributedString *)attributedStringByAddingSemiBoldForSubstring:(NSString *)subStr {
+- (void)addSemiBoldForSubstring:(NSString *)subStr {
     double weight = 7; // 8;
-    return [self attributedStringBySettingWeight:weight forSubstring:subStr];
+    [self setWeight:weight forSubstring:subStr];
 }
 
 #pragma mark - Special usecases
 
-- (NSAttributedString *)attributedStringByAddingHintStyle {
+- (void)addHintStyle {
     
     /// Notes:
     /// - The is the style of the small grey 'hint' texts we see all over the the General Tab and other Tabs. However those are mostly defined inside Interface Builder.
     
-    NSAttributedString *ret = self.copy;
-    ret = [ret attributedStringBySettingFontSize:NSFont.smallSystemFontSize];
-    ret = [ret attributedStringByAddingColor:NSColor.secondaryLabelColor forRange:nil];
-    
-    return ret;
+    [self setFontSize:NSFont.smallSystemFontSize];
+    [self addColor:NSColor.secondaryLabelColor forRange:nil];
 }
 
-- (NSAttributedString *)attributedStringBySettingSemiBoldColorForSubstring:(NSString *)subStr {
+- (void)setSemiBoldColorForSubstring:(NSString *)subStr {
     
     /// I can't really get a semibold. It's too thick or too thin. So I'm trying to make it appear thicker by darkening the color.
     
-    NSMutableAttributedString *ret = self.mutableCopy;
     NSRange subRange = [self.string rangeOfString:subStr];
     
     NSColor *color;
@@ -955,10 +1446,26 @@ void assignAttributedStringKeepingBase(NSAttributedString *_Nonnull *_Nonnull as
 //    color = [NSColor.textColor colorWithAlphaComponent:1.0]; /// Custom colors disable the automatic color inversion when selecting a tableViewCell. See https://stackoverflow.com/a/29860102/10601702
     color = NSColor.controlTextColor; /// This is almost black and automatically inverts. See: http://sethwillits.com/temp/nscolor/
     
-    [ret addAttribute:NSForegroundColorAttributeName value:color range:subRange];
-    
-    return ret;
+    [self addAttribute:NSForegroundColorAttributeName value:color range:subRange];
 }
 
+#pragma mark - Compact attribute runs
+
+- (void)compactAttributeRuns {
+    
+    /// Notes:
+    /// - Chains of `modifyAttribute:` and `addAttributes:` calls leave runs whose dictionaries are equal but separate instances. We swap each one for the registered instance from `internedAttributes()`, so they share it.
+    /// - We don't merge runs. `NSAttributedStringEnumerationLongestEffectiveRange` already hands us maximal runs, and `setAttributes:` with the same dictionary on neighbouring ranges is up to the storage anyway.
+    /// - Changing attributes inside the run we're given is allowed during enumeration.
+    
+    [self beginEditing];
+    [self enumerateAttributesInRange:NSMakeRange(0, self.length) options:NSAttributedStringEnumerationLongestEffectiveRange usingBlock:^(NSDictionary<NSAttributedStringKey,id> * _Nonnull attrs, NSRange range, BOOL * _Nonnull stop) {
+        NSDictionary *interned = internedAttributes(attrs);
+        if (interned != attrs) {
+            [self setAttributes:interned range:range];
+        }
+    }];
+    [self endEditing];
+}
 
 @end
@@ -0,0 +1,71 @@
+//
+// --------------------------------------------------------------------------
+// NSAttributedString+Core.h
+// Created for Mac Mouse Fix (https://github.com/noah-nuebling/mac-mouse-fix)
+// Created by Noah Nuebling in 2026
+// Licensed under the MMF License (https://github.com/noah-nuebling/mac-mouse-fix/blob/master/License)
+// --------------------------------------------------------------------------
+//
+
+/// The part of the attributed string additions that's pure text: Capitalizing, trimming, appending, formatting, attachment descriptions and attribute run statistics.
+///     Only needs Foundation, so it also builds with GNUstep on Linux (See `libTextCore.a` in MarkdownParser/Tests/GNUmakefile).
+///     Fonts, colors and attachments are platform stuff. The core asks the `StyleResolver` for them. `NSAttributedString+Additions.m` installs the AppKit resolver at launch, everything else gets `PlainStyleResolver`.
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Style resolver
+
+@protocol StyleResolver <NSObject>
+
+@property (nonatomic, readonly) NSDictionary<NSAttributedStringKey, id> *baseAttributes;     /// What `fillOutBase` adds. Should return the same instance every time.
+@property (nonatomic, readonly) NSDictionary<NSAttributedStringKey, id> *hintBaseAttributes; /// What `fillOutBaseAsHint` adds
+@property (nonatomic, readonly) NSAttributedStringKey attachmentAttributeName;
+- (NSString *_Nullable)descriptionForAttachment:(id)attachment;
+
+@end
+
+@interface PlainStyleResolver : NSObject <StyleResolver> /// No fonts or colors, and attachments have no description
+@end
+
+id<StyleResolver> currentStyleResolver(void);
+void setStyleResolver(id<StyleResolver> resolver); /// Not synchronized – install the resolver at launch, before any strings are styled.
+
+/// Dictionary hash
+///     Hashes keys and values. Use it wherever a dictionary is part of a hash key: `-[NSDictionary hash]` is just the count, so all dictionaries with the same number of entries would land in the same bucket.
+
+NSUInteger dictionaryContentHash(NSDictionary *dict);
+
+@interface NSAttributedString (Core)
+
+- (NSAttributedString *)attributedStringByCapitalizingFirst;
+- (NSAttributedString *)attributedStringByTrimmingWhitespace;
+
+- (NSAttributedString *)attributedStringByAppending:(NSAttributedString *)string;
++ (NSAttributedString *)attributedStringWithFormat:(NSString *)format args:(NSArray<NSAttributedString *> *)args;
++ (NSAttributedString *)attributedStringWithAttributedFormat:(NSAttributedString *)format args:(NSArray<NSAttributedString *> *)args;
+
+- (NSString *)stringWithAttachmentDescriptions;
+
+@end
+
+/// Attribute runs
+
+typedef struct {
+    NSUInteger runCount;
+    NSUInteger dictionaryInstanceCount; /// Distinct dictionary objects (by pointer) used by the runs
+} AttributeRunStatistics;
+
+AttributeRunStatistics attributeRunStatistics(NSAttributedString *string);
+
+/// In-place versions of the methods above
+
+@interface NSMutableAttributedString (Core)
+
+- (void)capitalizeFirst;
+- (void)trimWhitespace;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,353 @@
+//
+// --------------------------------------------------------------------------
+// NSAttributedString+Core.m
+// Created for Mac Mouse Fix (https://github.com/noah-nuebling/mac-mouse-fix)
+// Created by Noah Nuebling in 2026
+// Licensed under the MMF License (https://github.com/noah-nuebling/mac-mouse-fix/blob/master/License)
+// --------------------------------------------------------------------------
+//
+
+/// Foundation only. Don't import AppKit here – fonts, colors and attachments go through the `StyleResolver`.
+
+#import "NSAttributedString+Core.h"
+#import "NSString+Additions.h"
+
+#pragma mark - Style resolver
+
+@implementation PlainStyleResolver
+
+- (NSDictionary<NSAttributedStringKey, id> *)baseAttributes {
+    return @{};
+}
+- (NSDictionary<NSAttributedStringKey, id> *)hintBaseAttributes {
+    return @{};
+}
+- (NSAttributedStringKey)attachmentAttributeName {
+    return @"NSAttachment"; /// The value of AppKit's `NSAttachmentAttributeName`
+}
+- (NSString *_Nullable)descriptionForAttachment:(id)attachment {
+    return nil;
+}
+
+@end
+
+static id<StyleResolver> _styleResolver;
+
+id<StyleResolver> currentStyleResolver(void) {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        if (_styleResolver == nil) {
+            _styleResolver = [[PlainStyleResolver alloc] init];
+        }
+    });
+    return _styleResolver;
+}
+
+void setStyleResolver(id<StyleResolver> resolver) {
+    _styleResolver = resolver;
+}
+
+#pragma mark - Dictionary hash
+
+NSUInteger dictionaryContentHash(NSDictionary *dict) {
+    NSUInteger hash = dict.count;
+    for (id key in dict) {
+        hash ^= [key hash] ^ ([dict[key] hash] * 31);
+    }
+    return hash;
+}
+
+@implementation NSAttributedString (Core)
+
+#pragma mark Trim whitespace
+
+- (NSAttributedString *)attributedStringByCapitalizingFirst {
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s capitalizeFirst];
+    return s;
+}
+
+- (NSAttributedString *)attributedStringByTrimmingWhitespace {
+    NSMutableAttributedString *s = self.mutableCopy;
+    [s trimWhitespace];
+    return s;
+}
+
+#pragma mark Append
+
+- (NSAttributedString *)attributedStringByAppending:(NSAttributedString *)string {
+    
+    /// This used to go through `attributedStringWithFormat:` with `@"%@%@"`. That's a detour – and it replaced any `%@` inside `self` with `string`.
+    
+    NSMutableAttributedString *result = self.mutableCopy;
+    [result appendAttributedString:string];
+    return result;
+}
+
+#pragma mark Replace substring
+
++ (NSAttributedString *)attributedStringWithFormat:(NSString *)format args:(NSArray<NSAttributedString *> *)args {
+    
+    /// Convert format to attributed
+    NSAttributedString *attributedFormat = [[NSAttributedString alloc] initWithString:format];
+    
+    /// Call core method
+    return [self attributedStringWithAttributedFormat:attributedFormat args:args];
+}
+
+typedef struct {
+    NSRange range;          /// Range of the placeholder in the format
+    NSUInteger argIndex;
+} FormatPlaceholder;
+
+static NSUInteger findFormatPlaceholders(NSString *format, NSUInteger argCount, FormatPlaceholder *outPlaceholders) {
+    
+    /// Finds `%@` and positional `%1$@` placeholders in one pass over the format. Returns how many it wrote to `outPlaceholders`, which needs room for `format.length / 2` entries.
+    ///     Placeholders whose arg doesn't exist are skipped, so they stay in the output as-is. (Same as before positional placeholders were supported: Once we ran out of args, the remaining `%@` were left alone.)
+    ///     There's no `%%` escaping. That's how this always worked, and our strings don't need it.
+    
+    NSUInteger length = format.length;
+    unichar *chars = malloc(MAX(length, 1) * sizeof(unichar));
+    [format getCharacters:chars range:NSMakeRange(0, length)];
+    
+    NSUInteger count = 0;
+    NSUInteger nextSequentialArg = 0;
+    
+    NSUInteger i = 0;
+    while (i + 1 < length) {
+        
+        if (chars[i] != '%') { i++; continue; }
+        
+        /// `%@`
+        if (chars[i+1] == '@') {
+            if (nextSequentialArg < argCount) {
+                outPlaceholders[count++] = (FormatPlaceholder){ NSMakeRange(i, 2), nextSequentialArg };
+            }
+            nextSequentialArg++;
+            i += 2;
+            continue;
+        }
+        
+        /// `%n$@`
+        NSUInteger j = i + 1;
+        NSUInteger position = 0;
+        while (j < length && chars[j] >= '0' && chars[j] <= '9' && position <= argCount) {
+            position = position * 10 + (chars[j] - '0');
+            j++;
+        }
+        if (j > i + 1 && j + 1 < length && chars[j] == '$' && chars[j+1] == '@') {
+            if (position >= 1 && position <= argCount) {
+                outPlaceholders[count++] = (FormatPlaceholder){ NSMakeRange(i, j + 2 - i), position - 1 };
+            }
+            i = j + 2;
+            continue;
+        }
+        
+        i++;
+    }
+    
+    free(chars);
+    return count;
+}
+
+static void copyAttributes(NSAttributedString *source, NSRange sourceRange, NSMutableAttributedString *destination, NSUInteger destinationLocation) {
+    [source enumerateAttributesInRange:sourceRange options:0 usingBlock:^(NSDictionary<NSAttributedStringKey,id> * _Nonnull attrs, NSRange range, BOOL * _Nonnull stop) {
+        if (attrs.count == 0) return;
+        [destination setAttributes:attrs range:NSMakeRange(destinationLocation + (range.location - sourceRange.location), range.length)];
+    }];
+}
+
++ (NSAttributedString *)attributedStringWithAttributedFormat:(NSAttributedString *)format args:(NSArray<NSAttributedString *> *)args {
+    
+    /// Replaces occurences of `%@` (and positional `%1$@`) in the attributedString with the args
+    ///     Also see lib function `initWithFormat:options:locale:`
+    ///
+    /// Notes:
+    /// - This used to call `localizedStandardRangeOfString:@"%@"` from the start of the string for every arg. That's O(length) per placeholder, and it also found `%@` inside args we had already inserted.
+    ///     Now we find all placeholders up front with one plain scan, build the plain text in one pre-sized string, and then copy the attribute runs over.
+    /// - The args replace the placeholders together with their attributes, like `replaceCharactersInRange:withAttributedString:` did.
+    
+    /// Early return
+    if (args.count == 0) return format;
+    if ([format.string isEqual:@""]) return format;
+    
+    /// Find placeholders
+    NSString *formatString = format.string;
+    FormatPlaceholder *placeholders = malloc((formatString.length / 2 + 1) * sizeof(FormatPlaceholder));
+    NSUInteger placeholderCount = findFormatPlaceholders(formatString, args.count, placeholders);
+    if (placeholderCount == 0) {
+        free(placeholders);
+        return format;
+    }
+    
+    /// Build the plain text
+    NSUInteger resultLength = formatString.length;
+    for (NSUInteger p = 0; p < placeholderCount; p++) {
+        resultLength = resultLength - placeholders[p].range.length + args[placeholders[p].argIndex].length;
+    }
+    NSMutableString *resultString = [NSMutableString stringWithCapacity:resultLength];
+    NSUInteger formatIndex = 0;
+    for (NSUInteger p = 0; p < placeholderCount; p++) {
+        NSRange r = placeholders[p].range;
+        [resultString appendString:[formatString substringWithRange:NSMakeRange(formatIndex, r.location - formatIndex)]];
+        [resultString appendString:args[placeholders[p].argIndex].string];
+        formatIndex = NSMaxRange(r);
+    }
+    [resultString appendString:[formatString substringFromIndex:formatIndex]];
+    assert(resultString.length == resultLength);
+    
+    /// Copy the attributes
+    NSMutableAttributedString *result = [[NSMutableAttributedString alloc] initWithString:resultString];
+    [result beginEditing];
+    formatIndex = 0;
+    NSUInteger resultIndex = 0;
+    for (NSUInteger p = 0; p < placeholderCount; p++) {
+        NSRange r = placeholders[p].range;
+        NSAttributedString *arg = args[placeholders[p].argIndex];
+        
+        NSRange literal = NSMakeRange(formatIndex, r.location - formatIndex);
+        copyAttributes(format, literal, result, resultIndex);
+        resultIndex += literal.length;
+        
+        copyAttributes(arg, NSMakeRange(0, arg.length), result, resultIndex);
+        resultIndex += arg.length;
+        
+        formatIndex = NSMaxRange(r);
+    }
+    copyAttributes(format, NSMakeRange(formatIndex, format.length - formatIndex), result, resultIndex);
+    [result endEditing];
+    
+    free(placeholders);
+    return result;
+}
+
+#pragma mark Attribute runs
+
+AttributeRunStatistics attributeRunStatistics(NSAttributedString *string) {
+    
+    /// Counts the runs and how many separate dictionary instances they use. Equal dictionaries that are separate instances each take up memory, so comparing the counts before and after `compactAttributeRuns` shows what interning saves.
+    
+    AttributeRunStatistics stats = {0};
+    NSHashTable *instances = [NSHashTable hashTableWithOptions:NSPointerFunctionsObjectPointerPersonality | NSPointerFunctionsStrongMemory];
+    [string enumerateAttributesInRange:NSMakeRange(0, string.length) options:0 usingBlock:^(NSDictionary<NSAttributedStringKey,id> * _Nonnull attrs, NSRange range, BOOL * _Nonnull stop) {
+        stats.runCount += 1;
+        [instances addObject:attrs];
+    }];
+    stats.dictionaryInstanceCount = instances.count;
+    return stats;
+}
+
+#pragma mark Attachment fallback
+
+- (NSString *)stringWithAttachmentDescriptions {
+    /// NSStrings can't display attachments. This method inserts a description of the attachment where the attachment would be in the attributedString.
+    ///     Can't override `- string` for some reason. Probably bc `- string` is already declared in another category or sth
+    ///
+    /// Notes:
+    /// - We use this for accessibility and search indexing, so it needs to be fast on large documents. We enumerate only the attachment attribute and copy the text between attachments straight from the backing string into one buffer, instead of creating an attributed substring per run.
+    /// - The buffer starts out at the length of the string, which is enough unless descriptions are longer than the attachment characters they replace.
+    /// - Which attribute holds attachments and how to describe them is up to the `StyleResolver`. (With AppKit, it's the accessibility description of the attachment's image.)
+    
+    NSString *string = self.string;
+    NSUInteger length = string.length;
+    
+    __block unichar *buffer = NULL;
+    __block NSUInteger capacity = length;
+    __block NSUInteger count = 0;
+    
+    id<StyleResolver> resolver = currentStyleResolver();
+    [self enumerateAttribute:resolver.attachmentAttributeName inRange:NSMakeRange(0, length) options:0 usingBlock:^(id _Nullable value, NSRange range, BOOL * _Nonnull stop) {
+        
+        id attachment = value;
+        
+        /// Fast path: No attachments at all
+        if (attachment == nil && range.length == length) {
+            *stop = YES;
+            return;
+        }
+        if (buffer == NULL) {
+            buffer = malloc(MAX(capacity, 1) * sizeof(unichar));
+        }
+        
+        NSString *description = nil;
+        NSRange sourceRange = range;
+        if (attachment != nil) {
+            description = [resolver descriptionForAttachment:attachment];
+            sourceRange = NSMakeRange(0, description.length);
+        }
+        if (count + sourceRange.length > capacity) {
+            capacity = MAX(capacity * 2, count + sourceRange.length);
+            buffer = realloc(buffer, capacity * sizeof(unichar));
+        }
+        [(description ?: string) getCharacters:buffer + count range:sourceRange];
+        count += sourceRange.length;
+    }];
+    
+    if (buffer == NULL) {
+        return string.copy;
+    }
+    return [[NSString alloc] initWithCharactersNoCopy:buffer length:count freeWhenDone:YES];
+}
+
+@end
+
+@implementation NSMutableAttributedString (Core)
+
+/// In-place versions of the `NSAttributedString (Core)` methods
+
+#pragma mark Trim whitespace
+
+- (void)capitalizeFirst {
+    
+    if (self.length == 0) return;
+    [self replaceCharactersInRange:NSMakeRange(0, 1) withString:[[self.string substringToIndex:1] localizedUppercaseString]];
+}
+
+- (void)trimWhitespace {
+    
+    /// Deletes leading, trailing, and duplicate whitespace from a string.
+    ///     "Trimming" should maybe be "stripping"? Trimming usually only refers to cutting off the leading and trailing.
+    ///
+    /// Notes:
+    /// - This used to delete the whitespace one char at a time with `rangeOfCharacterFromSet:` + `deleteCharactersInRange:`. Every delete shifts the rest of the string and its attribute runs, so that was quadratic for strings with lots of whitespace.
+    ///     Now we find the ranges to keep in one scan (See `whitespaceTrimmingKeptRanges()`), then build the result and copy the attribute runs over once. The result is the same – within a run of whitespace, we keep the last char, along with its attributes.
+    
+    NSString *string = self.string;
+    NSUInteger length = string.length;
+    if (length == 0) return;
+    
+    unichar *chars = malloc(length * sizeof(unichar));
+    [string getCharacters:chars range:NSMakeRange(0, length)];
+    NSRange *keptRanges = malloc((length / 2 + 1) * sizeof(NSRange));
+    NSUInteger rangeCount = whitespaceTrimmingKeptRanges(chars, length, keptRanges);
+    
+    /// Nothing to do
+    if (rangeCount == 1 && keptRanges[0].length == length) {
+        free(chars);
+        free(keptRanges);
+        return;
+    }
+    
+    /// Build plain text
+    NSUInteger resultLength = 0;
+    for (NSUInteger i = 0; i < rangeCount; i++) {
+        memmove(chars + resultLength, chars + keptRanges[i].location, keptRanges[i].length * sizeof(unichar));
+        resultLength += keptRanges[i].length;
+    }
+    NSString *resultString = [[NSString alloc] initWithCharactersNoCopy:chars length:resultLength freeWhenDone:YES];
+    
+    /// Copy attributes
+    NSMutableAttributedString *result = [[NSMutableAttributedString alloc] initWithString:resultString];
+    [result beginEditing];
+    NSUInteger resultIndex = 0;
+    for (NSUInteger i = 0; i < rangeCount; i++) {
+        copyAttributes(self, keptRanges[i], result, resultIndex);
+        resultIndex += keptRanges[i].length;
+    }
+    [result endEditing];
+    free(keptRanges);
+    
+    [self setAttributedString:result];
+}
+
+@end
@@ -14,7 +14,9 @@ NS_ASSUME_NONNULL_BEGIN
 @interface NSString (Additions)
 
 
+#ifndef MF_SWIFT_UNBRIDGED /// NSString+Steganography.h defines this, too
 #define MF_SWIFT_UNBRIDGED(__type) __type
+#endif
 #define stringf(format, ...) [NSString stringWithFormat:(format), ##__VA_ARGS__]
 
 - (MF_SWIFT_UNBRIDGED(NSString *))substringWithRegex:(MF_SWIFT_UNBRIDGED(NSString *))regex NS_REFINED_FOR_SWIFT;
@@ -27,4 +29,22 @@ NS_ASSUME_NONNULL_BEGIN
 
 @end
 
+/// Whitespace trimming core
+///     Writes the ranges of `chars` that `stringByTrimmingWhiteSpace` keeps to `outRanges` and returns how many. `outRanges` needs room for `length / 2 + 1` ranges.
+NSUInteger whitespaceTrimmingKeptRanges(const unichar *chars, NSUInteger length, NSRange *outRanges);
+
+/// Regex cache
+///     Compiled `NSRegularExpression`s keyed by pattern and options. Compiling is much slower than matching, and we match the same few patterns in tight loops.
+///     Thread safe. Returns nil if the pattern doesn't compile. (Those aren't cached.)
+NSRegularExpression *_Nullable cachedRegularExpression(NSString *pattern, NSRegularExpressionOptions options);
+
+typedef struct {
+    NSUInteger hits;
+    NSUInteger misses;
+    NSUInteger count;
+} RegexCacheStatistics;
+
+RegexCacheStatistics regexCacheStatistics(void);
+void clearRegexCache(void);
+
 NS_ASSUME_NONNULL_END
@@ -8,13 +8,123 @@
 //
 
 #import "NSString+Additions.h"
-#import "NSAttributedString+Additions.h"
+
+NSUInteger whitespaceTrimmingKeptRanges(const unichar *chars, NSUInteger length, NSRange *outRanges) {
+    
+    /// Backs `stringByTrimmingWhiteSpace` and `trimWhitespace`. Finds the ranges to keep in one pass:
+    ///     Leading and trailing whitespace goes away, and runs of whitespace inside the string shrink to their last char.
+    ///     Linebreaks aren't in `whitespaceCharacterSet`, so they aren't touched and they split runs.
+    
+    NSCharacterSet *whitespaceChars = NSCharacterSet.whitespaceCharacterSet;
+    
+    /// Skip leading
+    NSUInteger i = 0;
+    while (i < length && [whitespaceChars characterIsMember:chars[i]]) i++;
+    if (i == length) return 0;
+    
+    NSUInteger count = 0;
+    NSUInteger rangeStart = i;
+    NSUInteger rangeEnd = length;
+    
+    while (i < length) {
+        
+        if (![whitespaceChars characterIsMember:chars[i]]) { i++; continue; }
+        
+        /// Find end of whitespace run
+        NSUInteger runStart = i;
+        while (i < length && [whitespaceChars characterIsMember:chars[i]]) i++;
+        
+        /// Trailing
+        if (i == length) {
+            rangeEnd = runStart;
+            break;
+        }
+        
+        /// Keep only the last char of the run
+        if (i - runStart > 1) {
+            outRanges[count++] = NSMakeRange(rangeStart, runStart - rangeStart);
+            rangeStart = i - 1;
+        }
+    }
+    
+    outRanges[count++] = NSMakeRange(rangeStart, rangeEnd - rangeStart);
+    return count;
+}
+
+///
+/// Regex cache
+///
+
+/// Notes:
+/// - `rangeOfString:options:NSRegularExpressionSearch` and `regularExpressionWithPattern:` compile the pattern every time. NSRegularExpression is immutable and safe to use from several threads, so we compile each (pattern, options) once and share it.
+/// - The cache is keyed by options + pattern and guarded with `@synchronized`. Patterns are compiled outside the lock. Patterns that don't compile aren't cached.
+/// - Our patterns are a small fixed set, so we don't bother with eviction. If the cache ever gets past `kRegexCacheCapacity` patterns, we empty it and start over.
+
+static const NSUInteger kRegexCacheCapacity = 256;
+
+static NSMutableDictionary<NSString *, NSRegularExpression *> *_regexCache;
+static RegexCacheStatistics _regexCacheStats;
+
+static NSMutableDictionary<NSString *, NSRegularExpression *> *regexCache(void) {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _regexCache = [NSMutableDictionary dictionary];
+    });
+    return _regexCache;
+}
+
+NSRegularExpression *_Nullable cachedRegularExpression(NSString *pattern, NSRegularExpressionOptions options) {
+    
+    NSMutableDictionary<NSString *, NSRegularExpression *> *cache = regexCache();
+    NSString *key = stringf(@"%lu:%@", (unsigned long)options, pattern);
+    
+    @synchronized (cache) {
+        NSRegularExpression *hit = cache[key];
+        if (hit != nil) {
+            _regexCacheStats.hits += 1;
+            return hit;
+        }
+    }
+    
+    /// Compile outside the lock so other threads don't have to wait for us.
+    NSRegularExpression *result = [NSRegularExpression regularExpressionWithPattern:pattern options:options error:nil];
+    if (result == nil) return nil;
+    
+    @synchronized (cache) {
+        _regexCacheStats.misses += 1;
+        if (cache.count >= kRegexCacheCapacity) {
+            [cache removeAllObjects];
+        }
+        cache[key] = result;
+    }
+    return result;
+}
+
+RegexCacheStatistics regexCacheStatistics(void) {
+    NSMutableDictionary *cache = regexCache();
+    @synchronized (cache) {
+        RegexCacheStatistics stats = _regexCacheStats;
+        stats.count = cache.count;
+        return stats;
+    }
+}
+
+void clearRegexCache(void) {
+    NSMutableDictionary *cache = regexCache();
+    @synchronized (cache) {
+        [cache removeAllObjects];
+        _regexCacheStats = (RegexCacheStatistics){0};
+    }
+}
 
 @implementation NSString (Additions)
 
 - (NSString *)substringWithRegex:(NSString *)regex {
     
-    NSRange range = [self rangeOfString:regex options:NSRegularExpressionSearch];
+    /// Same matching as `rangeOfString:options:NSRegularExpressionSearch`, but with the compiled pattern from the regex cache
+    
+    NSRegularExpression *expression = cachedRegularExpression(regex, 0);
+    NSRange range = expression ? [expression rangeOfFirstMatchInString:self options:0 range:NSMakeRange(0, self.length)] : NSMakeRange(NSNotFound, 0);
     
     NSString *result;
     if (range.location == NSNotFound) {
@@ -38,36 +148,107 @@
 }
 
 - (NSString *)stringByTrimmingWhiteSpace {
-    return [[[self attributed] attributedStringByTrimmingWhitespace] string];
+    
+    /// Same result as `attributedStringByTrimmingWhitespace`, but without the detour through NSAttributedString
+    
+    NSUInteger length = self.length;
+    unichar *chars = malloc(MAX(length, 1) * sizeof(unichar));
+    [self getCharacters:chars range:NSMakeRange(0, length)];
+    
+    NSRange *keptRanges = malloc((length / 2 + 1) * sizeof(NSRange));
+    NSUInteger rangeCount = whitespaceTrimmingKeptRanges(chars, length, keptRanges);
+    
+    /// Compact in place
+    ///     Kept ranges are sorted and don't overlap, so we never overwrite chars we haven't copied yet
+    NSUInteger resultLength = 0;
+    for (NSUInteger i = 0; i < rangeCount; i++) {
+        memmove(chars + resultLength, chars + keptRanges[i].location, keptRanges[i].length * sizeof(unichar));
+        resultLength += keptRanges[i].length;
+    }
+    free(keptRanges);
+    
+    return [[NSString alloc] initWithCharactersNoCopy:chars length:resultLength freeWhenDone:YES];
 }
 
 - (NSString *)stringByAddingIndent:(NSInteger)indent {
     return [self stringByAddingIndent:indent withCharacter:@" "];
 }
 
+static void writePadding(unichar *dst, NSUInteger count, NSString *character) {
+    
+    /// Same chars as `[@"" stringByPaddingToLength:count withString:character startingAtIndex:0]`: `character` repeated, cut off at `count`.
+    ///     We copy `character` once and then repeat what we've already written, so this doesn't need a buffer of its own.
+    
+    NSUInteger characterLength = character.length;
+    NSUInteger head = MIN(characterLength, count);
+    [character getCharacters:dst range:NSMakeRange(0, head)];
+    for (NSUInteger i = head; i < count; i++) {
+        dst[i] = dst[i - characterLength];
+    }
+}
+
 - (NSString *)stringByAddingIndent:(NSInteger)indent withCharacter:(NSString *)indentCharacter {
     
-    /// Split self
-    NSArray *lines = [self componentsSeparatedByString:@"\n"];
+    /// Prepends `indent` copies of `indentCharacter` to every line. (Including an empty line after a trailing linebreak.)
+    ///
+    /// Notes:
+    /// - We indent multi-megabyte log dumps with this. So instead of splitting into lines and joining padded copies, we work in one buffer:
+    ///     Copy self into the end of the buffer, count the linebreaks, then write indent + line from the front. Each line moves forward by the indent of the lines that are still left, so we never overwrite chars we haven't moved yet.
+    /// - The indent chars are written once, at the start of the first line. Every later line copies them from there.
+    
+    NSUInteger length = self.length;
+    if (indent <= 0 || indentCharacter.length == 0) return self.copy;
+    NSUInteger indentLength = (NSUInteger)indent;
+    
+    /// Get chars
+    unichar *chars = malloc(MAX(length, 1) * sizeof(unichar));
+    [self getCharacters:chars range:NSMakeRange(0, length)];
     
-    /// Build padded lines
-    NSMutableArray *paddedLines = [NSMutableArray arrayWithCapacity:[lines count]];
-    for (NSString *line in lines) {
-        NSString *paddedLine = [line stringByPrependingCharacter:indentCharacter count:indent];
-        [paddedLines addObject:paddedLine];
+    /// Count lines
+    NSUInteger lineCount = 1;
+    for (NSUInteger i = 0; i < length; i++) {
+        if (chars[i] == '\n') lineCount++;
     }
-    /// Join result
-    NSString *result = [paddedLines componentsJoinedByString:@"\n"];
     
-    /// Return
-    return result;
+    /// Move the source to the end
+    NSUInteger resultLength = length + lineCount * indentLength;
+    chars = realloc(chars, resultLength * sizeof(unichar));
+    NSUInteger read = resultLength - length;
+    memmove(chars + read, chars, length * sizeof(unichar));
+    
+    /// Write indent + line
+    writePadding(chars, indentLength, indentCharacter);
+    NSUInteger write = indentLength;
+    while (true) {
+        NSUInteger lineEnd = read;
+        while (lineEnd < resultLength && chars[lineEnd] != '\n') lineEnd++;
+        Boolean hasLinebreak = lineEnd < resultLength;
+        NSUInteger lineLength = lineEnd - read + (hasLinebreak ? 1 : 0);
+        memmove(chars + write, chars + read, lineLength * sizeof(unichar));
+        write += lineLength;
+        read += lineLength;
+        if (!hasLinebreak) break;
+        memcpy(chars + write, chars, indentLength * sizeof(unichar));
+        write += indentLength;
+    }
+    assert(write == resultLength && read == resultLength);
+    
+    return [[NSString alloc] initWithCharactersNoCopy:chars length:resultLength freeWhenDone:YES];
 }
 
 - (NSString *)stringByPrependingCharacter:(NSString *)prependedCharacter count:(NSInteger)count {
-    /// Create padding string
-    NSString *padding = [@"" stringByPaddingToLength:count withString:prependedCharacter startingAtIndex:0];
-    NSString *result = [padding stringByAppendingString:self];
-    return result;
+    
+    /// Writes the padding and self into one buffer instead of creating a padding string and appending
+    
+    NSUInteger length = self.length;
+    if (count <= 0 || prependedCharacter.length == 0) return self.copy;
+    NSUInteger paddingLength = (NSUInteger)count;
+    
+    unichar *chars = malloc((paddingLength + length) * sizeof(unichar));
+    writePadding(chars, paddingLength, prependedCharacter);
+    [self getCharacters:chars + paddingLength range:NSMakeRange(0, length)];
+    
+    return [[NSString alloc] initWithCharactersNoCopy:chars length:paddingLength + length freeWhenDone:YES];
 }
 
 @end
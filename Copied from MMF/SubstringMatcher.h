@@ -0,0 +1,33 @@
+//
+// --------------------------------------------------------------------------
+// SubstringMatcher.h
+// Created for Mac Mouse Fix (https://github.com/noah-nuebling/mac-mouse-fix)
+// Created by Noah Nuebling in 2026
+// Licensed under the MMF License (https://github.com/noah-nuebling/mac-mouse-fix/blob/master/License)
+// --------------------------------------------------------------------------
+//
+
+/// Finds all occurrences of a set of substrings in one pass (Aho-Corasick over UTF-16 code units).
+///     Build it once for a set of substrings, then search as many strings as you like. Searching is O(length + matches), regardless of how many substrings there are.
+///     Matching is literal, code unit by code unit. (`rangeOfString:` without options also matches canonically equivalent strings.)
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SubstringMatcher : NSObject
+
+- (instancetype)initWithSubstrings:(NSArray<NSString *> *)substrings; /// Empty substrings never match
+- (instancetype)init NS_UNAVAILABLE;
+
+@property (nonatomic, readonly) NSArray<NSString *> *substrings;
+
+/// Calls `block` for every occurrence of every substring, including overlapping ones. Matches are reported in order of where they end.
+- (void)enumerateMatchesInString:(NSString *)string usingBlock:(void (^)(NSUInteger substringIndex, NSRange range, BOOL *stop))block;
+
+/// Writes the first occurrence of each substring (like `rangeOfString:`) to `outRanges`, or {NSNotFound, 0}. `outRanges` needs room for `substrings.count` ranges.
+- (void)firstMatchesInString:(NSString *)string outRanges:(NSRange *)outRanges;
+
+@end
+
+NS_ASSUME_NONNULL_END
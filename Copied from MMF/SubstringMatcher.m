@@ -0,0 +1,190 @@
+//
+// --------------------------------------------------------------------------
+// SubstringMatcher.m
+// Created for Mac Mouse Fix (https://github.com/noah-nuebling/mac-mouse-fix)
+// Created by Noah Nuebling in 2026
+// Licensed under the MMF License (https://github.com/noah-nuebling/mac-mouse-fix/blob/master/License)
+// --------------------------------------------------------------------------
+//
+
+#import "SubstringMatcher.h"
+
+/// Notes:
+/// - The trie nodes live in one C array. Children are a linked list of siblings, since the alphabet (UTF-16) is huge but each node only has a few children. The root has a direct table for ASCII, because that's where most lookups happen.
+/// - `fail` is the usual Aho-Corasick failure link: The node for the longest proper suffix of this node's string that's also in the trie.
+///     `dictLink` is the nearest node on the fail chain that ends a substring. So reporting matches only visits nodes that actually match.
+/// - Duplicate substrings share a trie node. We keep a list of which substrings end at each node via `nextSameSubstring`.
+
+typedef struct {
+    int32_t firstChild;
+    int32_t nextSibling;
+    int32_t fail;
+    int32_t dictLink;       /// -1 if none
+    int32_t substring;      /// Index of a substring ending here, -1 if none
+    unichar label;
+} SMNode;
+
+enum { kSMRootTableSize = 128 }; /// enum so we can use it as an ivar array size
+
+@implementation SubstringMatcher {
+    SMNode *_nodes;
+    int32_t _nodeCount;
+    int32_t _nodeCapacity;
+    int32_t _rootTable[kSMRootTableSize];   /// 0 means no child
+    NSUInteger *_lengths;                   /// Length of each substring
+    int32_t *_nextSameSubstring;            /// Next substring that ends at the same node, -1 if none
+}
+
+#pragma mark - Building
+
+static int32_t findChild(SubstringMatcher *matcher, int32_t node, unichar c) {
+    if (node == 0 && c < kSMRootTableSize) {
+        int32_t child = matcher->_rootTable[c];
+        return child ? child : -1;
+    }
+    for (int32_t child = matcher->_nodes[node].firstChild; child != -1; child = matcher->_nodes[child].nextSibling) {
+        if (matcher->_nodes[child].label == c) return child;
+    }
+    return -1;
+}
+
+static int32_t addNode(SubstringMatcher *matcher, int32_t parent, unichar c) {
+    if (matcher->_nodeCount == matcher->_nodeCapacity) {
+        matcher->_nodeCapacity *= 2;
+        matcher->_nodes = realloc(matcher->_nodes, matcher->_nodeCapacity * sizeof(SMNode));
+    }
+    int32_t node = matcher->_nodeCount++;
+    matcher->_nodes[node] = (SMNode){ .firstChild = -1, .nextSibling = matcher->_nodes[parent].firstChild, .fail = 0, .dictLink = -1, .substring = -1, .label = c };
+    matcher->_nodes[parent].firstChild = node;
+    if (parent == 0 && c < kSMRootTableSize) matcher->_rootTable[c] = node;
+    return node;
+}
+
+- (instancetype)initWithSubstrings:(NSArray<NSString *> *)substrings {
+
+    self = [super init];
+    if (!self) return nil;
+
+    _substrings = substrings.copy;
+    NSUInteger count = _substrings.count;
+
+    _nodeCapacity = 64;
+    _nodes = malloc(_nodeCapacity * sizeof(SMNode));
+    _nodes[0] = (SMNode){ .firstChild = -1, .nextSibling = -1, .fail = 0, .dictLink = -1, .substring = -1, .label = 0 };
+    _nodeCount = 1;
+    memset(_rootTable, 0, sizeof(_rootTable));
+    _lengths = malloc(MAX(count, 1) * sizeof(NSUInteger));
+    _nextSameSubstring = malloc(MAX(count, 1) * sizeof(int32_t));
+
+    /// Trie
+    unichar *buffer = NULL;
+    NSUInteger bufferSize = 0;
+    for (NSUInteger i = 0; i < count; i++) {
+        NSString *substring = _substrings[i];
+        NSUInteger length = substring.length;
+        _lengths[i] = length;
+        _nextSameSubstring[i] = -1;
+        if (length == 0) continue;
+
+        if (length > bufferSize) {
+            bufferSize = length;
+            buffer = realloc(buffer, bufferSize * sizeof(unichar));
+        }
+        [substring getCharacters:buffer range:NSMakeRange(0, length)];
+
+        int32_t node = 0;
+        for (NSUInteger j = 0; j < length; j++) {
+            int32_t child = findChild(self, node, buffer[j]);
+            node = (child != -1) ? child : addNode(self, node, buffer[j]);
+        }
+        _nextSameSubstring[i] = _nodes[node].substring;
+        _nodes[node].substring = (int32_t)i;
+    }
+    free(buffer);
+
+    /// Failure links (breadth first, so the fail target is always done before the node)
+    int32_t *queue = malloc(_nodeCount * sizeof(int32_t));
+    int32_t head = 0, tail = 0;
+    for (int32_t child = _nodes[0].firstChild; child != -1; child = _nodes[child].nextSibling) {
+        _nodes[child].fail = 0;
+        queue[tail++] = child;
+    }
+    while (head < tail) {
+        int32_t node = queue[head++];
+        for (int32_t child = _nodes[node].firstChild; child != -1; child = _nodes[child].nextSibling) {
+            unichar c = _nodes[child].label;
+            int32_t f = _nodes[node].fail;
+            int32_t next;
+            while ((next = findChild(self, f, c)) == -1 && f != 0) f = _nodes[f].fail;
+            int32_t fail = (next != -1) ? next : 0;
+            _nodes[child].fail = fail;
+            _nodes[child].dictLink = (_nodes[fail].substring != -1) ? fail : _nodes[fail].dictLink;
+            queue[tail++] = child;
+        }
+    }
+    free(queue);
+
+    return self;
+}
+
+- (void)dealloc {
+    free(_nodes);
+    free(_lengths);
+    free(_nextSameSubstring);
+}
+
+#pragma mark - Matching
+
+- (void)enumerateMatchesInString:(NSString *)string usingBlock:(void (^)(NSUInteger substringIndex, NSRange range, BOOL *stop))block {
+
+    NSUInteger length = string.length;
+    if (length == 0 || _nodeCount == 1) return;
+
+    unichar *chars = malloc(length * sizeof(unichar));
+    [string getCharacters:chars range:NSMakeRange(0, length)];
+
+    BOOL stop = NO;
+    int32_t state = 0;
+    for (NSUInteger i = 0; i < length && !stop; i++) {
+
+        /// Step
+        unichar c = chars[i];
+        int32_t next;
+        while ((next = findChild(self, state, c)) == -1 && state != 0) state = _nodes[state].fail;
+        state = (next != -1) ? next : 0;
+
+        /// Report
+        int32_t node = (_nodes[state].substring != -1) ? state : _nodes[state].dictLink;
+        while (node != -1 && !stop) {
+            for (int32_t s = _nodes[node].substring; s != -1 && !stop; s = _nextSameSubstring[s]) {
+                NSUInteger len = _lengths[s];
+                block((NSUInteger)s, NSMakeRange(i + 1 - len, len), &stop);
+            }
+            node = _nodes[node].dictLink;
+        }
+    }
+
+    free(chars);
+}
+
+- (void)firstMatchesInString:(NSString *)string outRanges:(NSRange *)outRanges {
+
+    /// Each substring has a fixed length, so its matches are reported in order of where they start, too. That means the first report is the first occurrence, and we can stop once we've seen every substring.
+
+    NSUInteger count = _substrings.count;
+    __block NSUInteger remaining = 0;
+    for (NSUInteger i = 0; i < count; i++) {
+        outRanges[i] = NSMakeRange(NSNotFound, 0);
+        if (_lengths[i] > 0) remaining++;
+    }
+    if (remaining == 0) return;
+
+    [self enumerateMatchesInString:string usingBlock:^(NSUInteger substringIndex, NSRange range, BOOL *stop) {
+        if (outRanges[substringIndex].location != NSNotFound) return;
+        outRanges[substringIndex] = range;
+        remaining--;
+        if (remaining == 0) *stop = YES;
+    }];
+}
+
+@end
@@ -0,0 +1,18 @@
+//
+//  StringAdditionsBenchmarks.h
+//  objc-test-july-13-2024
+//
+//  Created by Noah Nübling on 18.10.26.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface StringAdditionsBenchmarks : NSObject
+
+void runStringAdditionsBenchmarks(void);
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,977 @@
+//
+//  StringAdditionsBenchmarks.m
+//  objc-test-july-13-2024
+//
+//  Created by Noah Nübling on 18.10.26.
+//
+
+#import "StringAdditionsBenchmarks.h"
+#import "NSAttributedString+Additions.h"
+#import "AttributedStringBuilder.h"
+#import "NSString+Additions.h"
+#import "QuartzCore/QuartzCore.h"
+#import "AppKit/AppKit.h"
+#import <malloc/malloc.h>
+
+@implementation StringAdditionsBenchmarks
+
+static NSAttributedString *chainTestString(NSUInteger length) {
+
+    /// Some words, so the substring lookups have something to find
+
+    NSMutableString *s = [NSMutableString string];
+    while (s.length < length) [s appendString:@"Lorem ipsum dolor sit amet, consectetur adipiscing elit. "];
+    [s appendString:@"Learn more"];
+    return [[NSAttributedString alloc] initWithString:s];
+}
+
+static void runStylingChainBenchmark(NSUInteger length, NSInteger iterations) {
+
+    /// The typical chain we build UI strings with: Fill out base, add weight, add color, add a link, add paragraph spacing.
+    ///     The immutable API copies the whole string at every step. The in-place API copies once.
+
+    NSAttributedString *string = chainTestString(length);
+    NSURL *url = [NSURL URLWithString:@"https://macmousefix.com"];
+
+    /// Immutable
+    NSAttributedString *immutableResult = nil;
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            NSAttributedString *s = string;
+            s = [s attributedStringByFillingOutBase];
+            s = [s attributedStringByAddingWeight:NSFontWeightSemibold forRange:NULL];
+            s = [s attributedStringByAddingColor:NSColor.secondaryLabelColor forSubstring:@"ipsum"];
+            s = [s attributedStringByAddingHyperlink:url forSubstring:@"Learn more"];
+            s = [s attributedStringByAddingParagraphSpacing:4 forRange:NULL];
+            immutableResult = s;
+        }
+    }
+    CFTimeInterval immutableTime = CACurrentMediaTime() - startTime;
+
+    /// In-place
+    NSAttributedString *inPlaceResult = nil;
+    startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            NSMutableAttributedString *s = string.mutableCopy;
+            [s fillOutBase];
+            [s addWeight:NSFontWeightSemibold forRange:NULL];
+            [s addColor:NSColor.secondaryLabelColor forSubstring:@"ipsum"];
+            [s addHyperlink:url forSubstring:@"Learn more"];
+            [s addParagraphSpacing:4 forRange:NULL];
+            inPlaceResult = s;
+        }
+    }
+    CFTimeInterval inPlaceTime = CACurrentMediaTime() - startTime;
+
+    NSLog(@"Chain (%lu chars) - immutable: %f ms, in-place: %f ms per string (%.2fx)",
+          (unsigned long)string.length, immutableTime / iterations * 1000, inPlaceTime / iterations * 1000, immutableTime / inPlaceTime);
+}
+
+static void runBuilderBenchmark(NSUInteger length, NSUInteger editCount, NSInteger iterations) {
+
+    /// Many substring edits on one string. The in-place chain runs `rangeOfString:` and enumerates the attributes once per edit, the builder scans once and walks the runs once.
+
+    NSMutableString *plain = chainTestString(length).string.mutableCopy;
+    NSMutableArray<NSString *> *phrases = [NSMutableArray array];
+    for (NSUInteger i = 0; i < editCount; i++) {
+        NSString *phrase = [NSString stringWithFormat:@"[phrase %lu]", (unsigned long)i];
+        [plain insertString:phrase atIndex:(plain.length * i) / editCount];
+        [phrases addObject:phrase];
+    }
+    NSAttributedString *string = [[NSAttributedString alloc] initWithString:plain];
+    NSURL *url = [NSURL URLWithString:@"https://macmousefix.com"];
+
+    /// In-place chain
+    NSAttributedString *chainResult = nil;
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            NSMutableAttributedString *s = string.mutableCopy;
+            [s fillOutBase];
+            for (NSUInteger j = 0; j < editCount; j++) {
+                if (j % 3 == 0)      [s addWeight:NSFontWeightBold forSubstring:phrases[j]];
+                else if (j % 3 == 1) [s addColor:NSColor.secondaryLabelColor forSubstring:phrases[j]];
+                else                 [s addHyperlink:url forSubstring:phrases[j]];
+            }
+            [s addParagraphSpacing:4 forRange:NULL];
+            chainResult = s;
+        }
+    }
+    CFTimeInterval chainTime = CACurrentMediaTime() - startTime;
+
+    /// Builder
+    NSAttributedString *builderResult = nil;
+    startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            AttributedStringBuilder *b = [AttributedStringBuilder builderWithAttributedString:string];
+            [b fillOutBase];
+            for (NSUInteger j = 0; j < editCount; j++) {
+                if (j % 3 == 0)      [b addWeight:NSFontWeightBold forSubstring:phrases[j]];
+                else if (j % 3 == 1) [b addColor:NSColor.secondaryLabelColor forSubstring:phrases[j]];
+                else                 [b addHyperlink:url forSubstring:phrases[j]];
+            }
+            [b addParagraphSpacing:4 forRange:NULL];
+            builderResult = [b build];
+        }
+    }
+    CFTimeInterval builderTime = CACurrentMediaTime() - startTime;
+
+    NSLog(@"Builder (%lu chars, %lu edits) - in-place chain: %f ms, builder: %f ms per string (%.2fx)",
+          (unsigned long)string.length, (unsigned long)editCount, chainTime / iterations * 1000, builderTime / iterations * 1000, chainTime / builderTime);
+}
+
+static NSAttributedString *legacyAttributedStringWithAttributedFormat(NSAttributedString *format, NSArray<NSAttributedString *> *args) {
+
+    /// The old implementation of `attributedStringWithAttributedFormat:args:`, for comparison
+
+    if (args.count == 0) return format;
+    if ([format.string isEqual:@""]) return format;
+
+    NSMutableAttributedString *mutableFormat = format.mutableCopy;
+    int i = 0;
+    while (true) {
+        NSRange replaceRange = [mutableFormat.string localizedStandardRangeOfString:@"%@"];
+        if (replaceRange.location == NSNotFound) break;
+        [mutableFormat replaceCharactersInRange:replaceRange withAttributedString:args[i]];
+        i++;
+        if (args.count <= i) break;
+    }
+    return mutableFormat;
+}
+
+static void runFormatBenchmark(NSUInteger placeholderCount, NSUInteger literalLength, NSInteger iterations) {
+
+    /// Builds a format with `placeholderCount` `%@`s separated by `literalLength` chars of text and fills it with bold args.
+
+    NSString *literal = [chainTestString(literalLength).string substringToIndex:literalLength];
+    NSMutableString *formatString = [NSMutableString stringWithString:literal];
+    NSMutableArray<NSAttributedString *> *args = [NSMutableArray array];
+    for (NSUInteger i = 0; i < placeholderCount; i++) {
+        [formatString appendString:@"%@"];
+        [formatString appendString:literal];
+        NSAttributedString *arg = [[NSAttributedString alloc] initWithString:[NSString stringWithFormat:@"<arg %lu>", (unsigned long)i]];
+        [args addObject:[arg attributedStringByAddingBoldForRange:NULL]];
+    }
+    NSAttributedString *format = [[NSAttributedString alloc] initWithString:formatString attributes:@{ NSForegroundColorAttributeName: NSColor.secondaryLabelColor }];
+
+    /// Old
+    NSAttributedString *legacyResult = nil;
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            legacyResult = legacyAttributedStringWithAttributedFormat(format, args);
+        }
+    }
+    CFTimeInterval legacyTime = CACurrentMediaTime() - startTime;
+
+    /// New
+    NSAttributedString *result = nil;
+    startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            result = [NSAttributedString attributedStringWithAttributedFormat:format args:args];
+        }
+    }
+    CFTimeInterval time = CACurrentMediaTime() - startTime;
+
+    NSLog(@"Format (%lu placeholders, %lu chars) - old: %f ms, new: %f ms per string (%.2fx)",
+          (unsigned long)placeholderCount, (unsigned long)format.length, legacyTime / iterations * 1000, time / iterations * 1000, legacyTime / time);
+}
+
+static void runFontCacheBenchmark(NSUInteger runCount, NSInteger iterations) {
+
+    /// Applies weight, bold and size to a string with `runCount` runs in a few different fonts. Once clearing the font cache before every iteration (so every font is resolved, like before the cache existed), once with a warm cache.
+
+    NSArray<NSFont *> *fonts = @[
+        [NSFont systemFontOfSize:NSFont.systemFontSize],
+        [NSFont systemFontOfSize:NSFont.smallSystemFontSize],
+        [NSFont monospacedSystemFontOfSize:NSFont.systemFontSize weight:NSFontWeightRegular],
+    ];
+    NSMutableAttributedString *string = [[NSMutableAttributedString alloc] init];
+    for (NSUInteger i = 0; i < runCount; i++) {
+        [string appendAttributedString:[[NSAttributedString alloc] initWithString:@"Some words " attributes:@{
+            NSFontAttributeName: fonts[i % fonts.count],
+            NSToolTipAttributeName: @(i), /// Keeps the runs separate
+        }]];
+    }
+
+    NSAttributedString *(^style)(void) = ^NSAttributedString *{
+        NSMutableAttributedString *s = string.mutableCopy;
+        [s addWeight:NSFontWeightSemibold forRange:NULL];
+        [s addBoldForRange:NULL];
+        [s setFontSize:12];
+        return s;
+    };
+
+    /// Cold
+    clearFontCache();
+    NSAttributedString *coldResult = nil;
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            clearFontCache();
+            coldResult = style();
+        }
+    }
+    CFTimeInterval coldTime = CACurrentMediaTime() - startTime;
+
+    /// Warm
+    clearFontCache();
+    NSAttributedString *warmResult = nil;
+    startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            warmResult = style();
+        }
+    }
+    CFTimeInterval warmTime = CACurrentMediaTime() - startTime;
+    FontCacheStatistics stats = fontCacheStatistics();
+
+    double hitRate = (double)stats.hits / MAX(stats.hits + stats.misses, 1);
+    double savedSeconds = (stats.misses > 0) ? stats.missSeconds / stats.misses * stats.hits : 0;
+    NSLog(@"Font cache (%lu runs) - uncached: %f ms, cached: %f ms per string (%.2fx). Hit rate: %.1f%% (%lu hits, %lu misses, %lu fonts). Est. time saved: %f ms",
+          (unsigned long)runCount, coldTime / iterations * 1000, warmTime / iterations * 1000, coldTime / warmTime,
+          hitRate * 100, (unsigned long)stats.hits, (unsigned long)stats.misses, (unsigned long)stats.count, savedSeconds * 1000);
+}
+
+static NSSize legacySizeAtMaxWidth(NSAttributedString *string, CGFloat maxWidth) {
+
+    /// The old `sizeAtMaxWidth:`, which set up a new layout stack for every call, for comparison
+
+    NSTextContainer *textContainer = [[NSTextContainer alloc] initWithSize:CGSizeMake(maxWidth, CGFLOAT_MAX)];
+    NSLayoutManager *layoutManager = [[NSLayoutManager alloc] init];
+    [layoutManager addTextContainer:textContainer];
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithAttributedString:string];
+    [textStorage addLayoutManager:layoutManager];
+    [layoutManager glyphRangeForTextContainer:textContainer];
+    return [layoutManager usedRectForTextContainer:textContainer].size;
+}
+
+static void runTableReloadBenchmark(NSUInteger rowCount, NSInteger reloads) {
+
+    /// Emulates reloading a table whose cells measure their text: Every row asks for `sizeAtMaxWidth:` and `heightAtWidth:` at the column width.
+    ///     'old' sets up a new layout stack per measurement. 'pooled' reuses the per-thread stack but clears the cache before every reload. 'cached' is what we actually do.
+
+    NSMutableArray<NSAttributedString *> *rows = [NSMutableArray array];
+    for (NSUInteger i = 0; i < rowCount; i++) {
+        NSString *text = [NSString stringWithFormat:@"Row %lu – %@", (unsigned long)i, [chainTestString(40 + (i % 7) * 30).string substringToIndex:40 + (i % 7) * 30]];
+        NSMutableAttributedString *row = [[NSMutableAttributedString alloc] initWithString:text];
+        [row fillOutBase];
+        [row addWeight:NSFontWeightSemibold forSubstring:@"Row"];
+        [rows addObject:row];
+    }
+    CGFloat width = 240;
+
+    /// Old
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSInteger r = 0; r < reloads; r++) {
+        @autoreleasepool {
+            for (NSAttributedString *row in rows) {
+                legacySizeAtMaxWidth(row, width);
+                [row uncachedHeightAtWidth:width];
+            }
+        }
+    }
+    CFTimeInterval oldTime = CACurrentMediaTime() - startTime;
+
+    /// Pooled
+    startTime = CACurrentMediaTime();
+    for (NSInteger r = 0; r < reloads; r++) {
+        @autoreleasepool {
+            clearTextMeasurementCache();
+            for (NSAttributedString *row in rows) {
+                [row sizeAtMaxWidth:width];
+                [row heightAtWidth:width];
+            }
+        }
+    }
+    CFTimeInterval pooledTime = CACurrentMediaTime() - startTime;
+
+    /// Cached
+    clearTextMeasurementCache();
+    startTime = CACurrentMediaTime();
+    for (NSInteger r = 0; r < reloads; r++) {
+        @autoreleasepool {
+            for (NSAttributedString *row in rows) {
+                [row sizeAtMaxWidth:width];
+                [row heightAtWidth:width];
+            }
+        }
+    }
+    CFTimeInterval cachedTime = CACurrentMediaTime() - startTime;
+    TextMeasurementCacheStatistics stats = textMeasurementCacheStatistics();
+
+    NSLog(@"Table reload (%lu rows) - old: %f ms, pooled: %f ms, cached: %f ms per reload. Hit rate: %.1f%%",
+          (unsigned long)rowCount, oldTime / reloads * 1000, pooledTime / reloads * 1000, cachedTime / reloads * 1000,
+          100.0 * stats.hits / MAX(stats.hits + stats.misses, 1));
+}
+
+static NSAttributedString *legacyTrimmingWhitespace(NSAttributedString *string) {
+
+    /// The old `attributedStringByTrimmingWhitespace`, which deleted one char at a time, for comparison
+
+    NSMutableAttributedString *s = string.mutableCopy;
+    NSCharacterSet *whitespaceChars = NSCharacterSet.whitespaceCharacterSet;
+
+    while (true) {
+        NSRange whitespace = [s.string rangeOfCharacterFromSet:whitespaceChars];
+        if (whitespace.location == 0) [s deleteCharactersInRange:whitespace];
+        else break;
+    }
+
+    NSRange lastWhitespace = NSMakeRange(NSNotFound, 0);
+    NSRange searchRange = NSMakeRange(0, s.length);
+    while (true) {
+        NSRange whitespace = [s.string rangeOfCharacterFromSet:whitespaceChars options:NSBackwardsSearch range:searchRange];
+        if (whitespace.location == NSNotFound) break;
+        BOOL deletedWhitespace = YES;
+        if (NSMaxRange(whitespace) - 1 == s.length - 1)             [s deleteCharactersInRange:whitespace];
+        else if (NSMaxRange(whitespace) == lastWhitespace.location) [s deleteCharactersInRange:whitespace];
+        else                                                        deletedWhitespace = NO;
+        searchRange = NSMakeRange(searchRange.location, whitespace.location);
+        if (!deletedWhitespace) lastWhitespace = whitespace;
+        else                    lastWhitespace.location -= 1;
+    }
+    return s;
+}
+
+static void runTrimmingBenchmark(NSUInteger wordCount, NSUInteger spacesPerGap, NSInteger iterations) {
+
+    /// Words separated by `spacesPerGap` spaces and tabs, with padding at both ends. Alternating colors so there are lots of attribute runs.
+
+    NSMutableAttributedString *string = [[NSMutableAttributedString alloc] init];
+    NSString *gap = [@"" stringByPaddingToLength:spacesPerGap withString:@" \t" startingAtIndex:0];
+    [string appendAttributedString:[[NSAttributedString alloc] initWithString:gap]];
+    for (NSUInteger i = 0; i < wordCount; i++) {
+        NSColor *color = (i % 2) ? NSColor.labelColor : NSColor.secondaryLabelColor;
+        [string appendAttributedString:[[NSAttributedString alloc] initWithString:@"word" attributes:@{ NSForegroundColorAttributeName: color }]];
+        [string appendAttributedString:[[NSAttributedString alloc] initWithString:gap]];
+    }
+
+    /// Old
+    NSAttributedString *legacyResult = nil;
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            legacyResult = legacyTrimmingWhitespace(string);
+        }
+    }
+    CFTimeInterval legacyTime = CACurrentMediaTime() - startTime;
+
+    /// New
+    NSAttributedString *result = nil;
+    startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            result = [string attributedStringByTrimmingWhitespace];
+        }
+    }
+    CFTimeInterval time = CACurrentMediaTime() - startTime;
+
+    /// Plain NSString
+    NSString *plainResult = nil;
+    startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            plainResult = [string.string stringByTrimmingWhiteSpace];
+        }
+    }
+    CFTimeInterval plainTime = CACurrentMediaTime() - startTime;
+
+    NSLog(@"Trim (%lu chars) - old: %f ms, new: %f ms (%.2fx), plain NSString: %f ms",
+          (unsigned long)string.length, legacyTime / iterations * 1000, time / iterations * 1000, legacyTime / time, plainTime / iterations * 1000);
+}
+
+static void runKeywordStylingBenchmark(NSUInteger keywordCount, NSUInteger length, NSInteger iterations) {
+
+    /// Styles every occurrence of `keywordCount` keywords in a long help text. Once with a `rangeOfString:` loop per keyword and the in-place methods, once with the builder.
+
+    NSMutableArray<NSString *> *keywords = [NSMutableArray array];
+    for (NSUInteger i = 0; i < keywordCount; i++) [keywords addObject:stringf(@"Keyword%03lu", (unsigned long)i)]; /// Zero-padded so no keyword contains another
+    NSMutableString *text = [NSMutableString string];
+    NSUInteger k = 0;
+    while (text.length < length) {
+        [text appendString:@"Lorem ipsum dolor sit amet, "];
+        [text appendString:keywords[k++ % keywordCount]];
+        [text appendString:@" consectetur adipiscing elit. "];
+    }
+    NSAttributedString *string = [[NSAttributedString alloc] initWithString:text];
+
+    /// Per keyword
+    NSAttributedString *loopResult = nil;
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            NSMutableAttributedString *s = string.mutableCopy;
+            for (NSUInteger j = 0; j < keywordCount; j++) {
+                NSRange searchRange = NSMakeRange(0, s.length);
+                while (true) {
+                    NSRange r = [s.string rangeOfString:keywords[j] options:NSLiteralSearch range:searchRange];
+                    if (r.location == NSNotFound) break;
+                    if (j % 2) [s addBoldForRange:&r];
+                    else       [s addColor:NSColor.systemBlueColor forRange:&r];
+                    searchRange = NSMakeRange(NSMaxRange(r), s.length - NSMaxRange(r));
+                }
+            }
+            loopResult = s;
+        }
+    }
+    CFTimeInterval loopTime = CACurrentMediaTime() - startTime;
+
+    /// Builder
+    NSAttributedString *builderResult = nil;
+    startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            AttributedStringBuilder *b = [AttributedStringBuilder builderWithAttributedString:string];
+            for (NSUInteger j = 0; j < keywordCount; j++) {
+                if (j % 2) [b addBoldForAllOccurrencesOfSubstring:keywords[j]];
+                else       [b addColor:NSColor.systemBlueColor forAllOccurrencesOfSubstring:keywords[j]];
+            }
+            builderResult = [b build];
+        }
+    }
+    CFTimeInterval builderTime = CACurrentMediaTime() - startTime;
+
+    NSLog(@"Keywords (%lu keywords, %lu chars) - per keyword: %f ms, builder: %f ms per string (%.2fx)",
+          (unsigned long)keywordCount, (unsigned long)string.length, loopTime / iterations * 1000, builderTime / iterations * 1000, loopTime / builderTime);
+}
+
+static void runRunCompactionBenchmark(NSInteger iterations) {
+
+    /// Renders a few UI strings like the ones in the app, then styles them the way our code does: Word by word and in overlapping ranges. Reports the runs and dictionary instances before and after `compactAttributeRuns`, and whether compacting makes enumerating and measuring the strings faster.
+    ///     The distinct dictionaries are the floor for the instance count. If the instances are already at that floor before compacting, the storage shares equal dictionaries by itself.
+
+    NSArray<NSString *> *markdowns = @[
+        @"**Mac Mouse Fix** lets you use your mouse buttons to **switch between Spaces**, **open Mission Control** and more.\n\nLearn more on the [website](https://macmousefix.com).",
+        @"Hold the **Primary Button** and move the mouse to *drag* things. This works in all apps, even when *Smooth Scrolling* is turned off.",
+        @"The **Middle Button** can't be used with the *Click and Drag* action while **Scroll Wheel** scrolling is active. [Why?](https://github.com/noah-nuebling/mac-mouse-fix/issues)",
+        @"Your **free days** are over. To keep using Mac Mouse Fix, please **buy a license**.\n\n- Pay once, use forever\n- Supports development\n- *No subscription*",
+    ];
+
+    NSMutableArray<NSAttributedString *> *strings = [NSMutableArray array];
+    for (NSString *md in markdowns) {
+        NSMutableAttributedString *s = [NSAttributedString attributedStringWithCoolMarkdown:md].mutableCopy;
+        NSString *plain = s.string;
+        /// Word by word, like per-substring styling does
+        [plain enumerateSubstringsInRange:NSMakeRange(0, plain.length) options:NSStringEnumerationByWords usingBlock:^(NSString * _Nullable word, NSRange wordRange, NSRange enclosingRange, BOOL * _Nonnull stop) {
+            [s addColor:NSColor.labelColor forRange:&enclosingRange];
+        }];
+        /// Overlapping modifier passes
+        for (NSUInteger start = 0; start + 10 < s.length; start += 7) {
+            NSRange r = NSMakeRange(start, 10);
+            [s addBaseLineOffset:0 forRange:&r];
+        }
+        [strings addObject:s];
+    }
+
+    /// Compact
+    NSMutableArray<NSAttributedString *> *compacted = [NSMutableArray array];
+    AttributeRunStatistics before = {0}, after = {0};
+    NSUInteger distinctCount = 0;
+    for (NSAttributedString *s in strings) {
+        NSAttributedString *c = [s attributedStringByCompactingAttributeRuns];
+        [compacted addObject:c];
+        AttributeRunStatistics b = attributeRunStatistics(s), a = attributeRunStatistics(c);
+        before.runCount += b.runCount; before.dictionaryInstanceCount += b.dictionaryInstanceCount;
+        after.runCount += a.runCount;  after.dictionaryInstanceCount += a.dictionaryInstanceCount;
+        NSMutableArray<NSDictionary *> *distinct = [NSMutableArray array]; /// By content, not by instance
+        [s enumerateAttributesInRange:NSMakeRange(0, s.length) options:0 usingBlock:^(NSDictionary<NSAttributedStringKey,id> * _Nonnull attrs, NSRange range, BOOL * _Nonnull stop) {
+            if (![distinct containsObject:attrs]) [distinct addObject:attrs];
+        }];
+        distinctCount += distinct.count;
+    }
+
+    /// Enumerate + measure
+    CFTimeInterval (^time)(NSArray<NSAttributedString *> *) = ^CFTimeInterval(NSArray<NSAttributedString *> *input) {
+        CFTimeInterval startTime = CACurrentMediaTime();
+        for (NSInteger i = 0; i < iterations; i++) {
+            @autoreleasepool {
+                for (NSAttributedString *s in input) {
+                    [s enumerateAttributesInRange:NSMakeRange(0, s.length) options:0 usingBlock:^(NSDictionary<NSAttributedStringKey,id> * _Nonnull attrs, NSRange range, BOOL * _Nonnull stop) {}];
+                    [s uncachedHeightAtWidth:300];
+                }
+            }
+        }
+        return CACurrentMediaTime() - startTime;
+    };
+    CFTimeInterval fragmentedTime = time(strings);
+    CFTimeInterval compactedTime = time(compacted);
+
+    NSLog(@"Run compaction (%lu UI strings) - runs: %lu -> %lu, dictionary instances: %lu -> %lu (distinct dictionaries: %lu). Enumerate + measure: %f ms -> %f ms per pass",
+          (unsigned long)strings.count, (unsigned long)before.runCount, (unsigned long)after.runCount,
+          (unsigned long)before.dictionaryInstanceCount, (unsigned long)after.dictionaryInstanceCount, (unsigned long)distinctCount,
+          fragmentedTime / iterations * 1000, compactedTime / iterations * 1000);
+}
+
+static void legacyFillOutBase(NSMutableAttributedString *s) {
+    
+    /// What `fillOutBase` did before the style registry: A fresh dictionary and a system font lookup on every call
+    
+    NSDictionary *base = @{
+        NSFontAttributeName: [NSFont systemFontOfSize:NSFont.systemFontSize],
+        NSForegroundColorAttributeName: NSColor.labelColor,
+        NSFontWeightTrait: @(NSFontWeightMedium),
+    };
+    NSAttributedString *original = s.copy;
+    [s addAttributes:base range:NSMakeRange(0, s.length)];
+    [original enumerateAttributesInRange:NSMakeRange(0, original.length) options:0 usingBlock:^(NSDictionary<NSAttributedStringKey,id> * _Nonnull attrs, NSRange range, BOOL * _Nonnull stop) {
+        [s addAttributes:attrs range:range];
+    }];
+}
+
+static void runLabelRenderBenchmark(NSUInteger labelCount) {
+    
+    /// Renders `labelCount` plain labels and keeps them alive, like a table full of rows. Reports time, bytes and malloc blocks per label, and how many distinct attribute dictionaries the labels hold on to.
+    
+    NSMutableArray<NSString *> *texts = [NSMutableArray array];
+    for (NSUInteger i = 0; i < labelCount; i++) {
+        [texts addObject:[NSString stringWithFormat:@"Button %lu + Click and Drag", (unsigned long)i]];
+    }
+    
+    void (^measure)(NSString *, void (^)(NSMutableAttributedString *)) = ^(NSString *name, void (^fill)(NSMutableAttributedString *)) {
+        
+        NSMutableArray<NSAttributedString *> *labels = [NSMutableArray arrayWithCapacity:labelCount];
+        malloc_statistics_t before, after;
+        
+        @autoreleasepool {
+            malloc_zone_statistics(NULL, &before);
+            CFTimeInterval startTime = CACurrentMediaTime();
+            for (NSString *text in texts) {
+                NSMutableAttributedString *s = [[NSMutableAttributedString alloc] initWithString:text];
+                fill(s);
+                [labels addObject:s];
+            }
+            CFTimeInterval time = CACurrentMediaTime() - startTime;
+            
+            /// Drain before counting, so only what the labels keep is left
+            NSHashTable *dictionaries = [NSHashTable hashTableWithOptions:NSPointerFunctionsObjectPointerPersonality];
+            for (NSAttributedString *label in labels) {
+                [label enumerateAttributesInRange:NSMakeRange(0, label.length) options:0 usingBlock:^(NSDictionary<NSAttributedStringKey,id> * _Nonnull attrs, NSRange range, BOOL * _Nonnull stop) {
+                    [dictionaries addObject:attrs];
+                }];
+            }
+            NSLog(@"%@: %f us per label, %lu distinct attribute dictionaries", name, time / labelCount * 1e6, (unsigned long)dictionaries.count);
+        }
+        malloc_zone_statistics(NULL, &after);
+        
+        NSLog(@"%@: %.1f bytes, %.2f malloc blocks retained per label", name,
+              ((double)after.size_in_use - (double)before.size_in_use) / labelCount,
+              ((double)after.blocks_in_use - (double)before.blocks_in_use) / labelCount);
+        
+        [labels removeAllObjects];
+    };
+    
+    measure(@"Fresh dictionary per label", ^(NSMutableAttributedString *s) { legacyFillOutBase(s); });
+    measure(@"Style registry", ^(NSMutableAttributedString *s) { [s fillOutBase]; });
+}
+
+static NSAttributedString *legacyAttributedStringByAddingStringAttributesAsBase(NSAttributedString *string, NSDictionary *baseAttributes) {
+    
+    /// The old implementation: Add the base over everything, then re-add every original run on top, then copy.
+    
+    NSMutableAttributedString *s = string.mutableCopy;
+    NSAttributedString *original = s.copy;
+    [s addAttributes:baseAttributes range:NSMakeRange(0, s.length)];
+    [original enumerateAttributesInRange:NSMakeRange(0, original.length) options:0 usingBlock:^(NSDictionary<NSAttributedStringKey,id> * _Nonnull attrs, NSRange range, BOOL * _Nonnull stop) {
+        [s addAttributes:attrs range:range];
+    }];
+    return s.copy;
+}
+
+static void runAddingBaseBenchmark(NSUInteger runCount, NSInteger iterations) {
+    
+    /// A string with `runCount` runs that have some, all, or none of the base keys
+    
+    NSURL *url = [NSURL URLWithString:@"https://macmousefix.com"];
+    NSFont *boldFont = [NSFont boldSystemFontOfSize:NSFont.systemFontSize];
+    NSMutableAttributedString *string = [[NSMutableAttributedString alloc] init];
+    for (NSUInteger i = 0; i < runCount; i++) {
+        NSString *word = [NSString stringWithFormat:@"word%lu ", (unsigned long)i];
+        NSDictionary *attributes;
+        switch (i % 4) {
+            case 0: attributes = @{}; break;
+            case 1: attributes = @{ NSForegroundColorAttributeName: NSColor.secondaryLabelColor }; break;
+            case 2: attributes = @{ NSFontAttributeName: boldFont }; break;
+            default: attributes = @{ NSFontAttributeName: boldFont, NSForegroundColorAttributeName: NSColor.linkColor, NSLinkAttributeName: url }; break;
+        }
+        [string appendAttributedString:[[NSAttributedString alloc] initWithString:word attributes:attributes]];
+    }
+    NSDictionary *base = fillOutBaseAttributes();
+    
+    /// Old
+    NSAttributedString *legacyResult = nil;
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            legacyResult = legacyAttributedStringByAddingStringAttributesAsBase(string, base);
+        }
+    }
+    CFTimeInterval legacyTime = CACurrentMediaTime() - startTime;
+    
+    /// New
+    NSAttributedString *result = nil;
+    startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            result = [string attributedStringByAddingStringAttributesAsBase:base];
+        }
+    }
+    CFTimeInterval time = CACurrentMediaTime() - startTime;
+    
+    NSLog(@"Adding base (%lu runs) - old: %f ms, new: %f ms per string (%.2fx)",
+          (unsigned long)runCount, legacyTime / iterations * 1000, time / iterations * 1000, legacyTime / time);
+}
+
+static void legacySetWeightAndSize(NSMutableAttributedString *s, NSInteger weight, CGFloat size) {
+    
+    /// What `setWeight:forRange:` and `setFontSize:` did before the font helpers: Resolve the font again for every run.
+    
+    [s enumerateAttribute:NSFontAttributeName inRange:NSMakeRange(0, s.length) options:0 usingBlock:^(id _Nullable value, NSRange range, BOOL * _Nonnull stop) {
+        NSFont *font = value ?: [NSFont systemFontOfSize:NSFont.systemFontSize];
+        NSFontTraitMask traits = [NSFontManager.sharedFontManager traitsOfFont:font];
+        font = [NSFontManager.sharedFontManager fontWithFamily:font.familyName traits:traits weight:weight size:font.pointSize];
+        [s addAttribute:NSFontAttributeName value:font range:range];
+    }];
+    [s enumerateAttribute:NSFontAttributeName inRange:NSMakeRange(0, s.length) options:0 usingBlock:^(id _Nullable value, NSRange range, BOOL * _Nonnull stop) {
+        NSFont *font = value;
+        [s addAttribute:NSFontAttributeName value:[NSFont fontWithDescriptor:font.fontDescriptor size:size] range:range];
+    }];
+}
+
+static void runSetWeightBenchmark(NSUInteger runCount, NSInteger iterations) {
+    
+    /// `setWeight:` + `setFontSize:` on a string with `runCount` runs that alternate between two fonts. Per-run NSFontManager lookups vs the font helpers.
+    
+    NSArray<NSFont *> *fonts = @[
+        [NSFont systemFontOfSize:NSFont.systemFontSize],
+        [NSFont boldSystemFontOfSize:NSFont.systemFontSize],
+    ];
+    NSMutableAttributedString *string = [[NSMutableAttributedString alloc] init];
+    for (NSUInteger i = 0; i < runCount; i++) {
+        [string appendAttributedString:[[NSAttributedString alloc] initWithString:@"Some words " attributes:@{
+            NSFontAttributeName: fonts[(i / 3) % fonts.count],  /// A few neighbouring runs share a font, like in real strings
+            NSToolTipAttributeName: @(i),                       /// Keeps the runs separate
+        }]];
+    }
+    
+    /// Old
+    NSAttributedString *legacyResult = nil;
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            NSMutableAttributedString *s = string.mutableCopy;
+            legacySetWeightAndSize(s, 7, 12);
+            legacyResult = s;
+        }
+    }
+    CFTimeInterval legacyTime = CACurrentMediaTime() - startTime;
+    
+    /// New
+    NSAttributedString *result = nil;
+    startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            NSMutableAttributedString *s = string.mutableCopy;
+            [s setWeight:7 forRange:NULL];
+            [s setFontSize:12];
+            result = s;
+        }
+    }
+    CFTimeInterval time = CACurrentMediaTime() - startTime;
+    
+    NSLog(@"Set weight + size (%lu runs) - per-run lookups: %f ms, font helpers: %f ms per string (%.2fx)",
+          (unsigned long)runCount, legacyTime / iterations * 1000, time / iterations * 1000, legacyTime / time);
+}
+
+static NSString *legacyStringWithAttachmentDescriptions(NSAttributedString *string) {
+    
+    /// The old implementation: An attributed substring per run
+    
+    NSMutableString *result = [NSMutableString string];
+    NSUInteger i = 0;
+    while (i < string.length) {
+        NSRange range;
+        NSDictionary<NSAttributedStringKey, id> *attributes = [string attributesAtIndex:i effectiveRange:&range];
+        NSTextAttachment *attachment = attributes[NSAttachmentAttributeName];
+        if (attachment != nil) {
+            NSString *description = attachment.image.accessibilityDescription;
+            if (description != nil) [result appendString:description];
+        } else {
+            [result appendString:[string attributedSubstringFromRange:range].string];
+        }
+        i = NSMaxRange(range);
+    }
+    return result;
+}
+
+static void runAttachmentDescriptionsBenchmark(NSUInteger paragraphCount, NSInteger iterations) {
+    
+    /// A document with `paragraphCount` paragraphs. Each has a few styled runs and a symbol attachment.
+    
+    NSImage *image = [NSImage imageWithSystemSymbolName:@"computermouse" accessibilityDescription:@"Mouse"];
+    NSTextAttachment *attachment = [[NSTextAttachment alloc] init];
+    attachment.image = image;
+    
+    NSMutableAttributedString *document = [[NSMutableAttributedString alloc] init];
+    for (NSUInteger i = 0; i < paragraphCount; i++) {
+        NSMutableAttributedString *paragraph = [[NSMutableAttributedString alloc] initWithString:@"Click the "];
+        [paragraph appendAttributedString:[NSAttributedString attributedStringWithAttachment:attachment]];
+        [paragraph appendAttributedString:[[NSAttributedString alloc] initWithString:@" button to open " attributes:@{ NSForegroundColorAttributeName: NSColor.secondaryLabelColor }]];
+        [paragraph appendAttributedString:[[NSAttributedString alloc] initWithString:@"Mission Control" attributes:@{ NSFontAttributeName: [NSFont boldSystemFontOfSize:NSFont.systemFontSize] }]];
+        [paragraph appendAttributedString:[[NSAttributedString alloc] initWithString:@".\n"]];
+        [document appendAttributedString:paragraph];
+    }
+    
+    /// Old
+    NSString *legacyResult = nil;
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            legacyResult = legacyStringWithAttachmentDescriptions(document);
+        }
+    }
+    CFTimeInterval legacyTime = CACurrentMediaTime() - startTime;
+    
+    /// New
+    NSString *result = nil;
+    startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            result = [document stringWithAttachmentDescriptions];
+        }
+    }
+    CFTimeInterval time = CACurrentMediaTime() - startTime;
+    
+    NSLog(@"Attachment descriptions (%lu chars) - old: %f ms, new: %f ms per string (%.2fx)",
+          (unsigned long)document.length, legacyTime / iterations * 1000, time / iterations * 1000, legacyTime / time);
+}
+
+static NSString *legacyStringByAddingIndent(NSString *string, NSInteger indent, NSString *indentCharacter) {
+    
+    /// The old implementation: Split, pad every line, join
+    
+    NSArray *lines = [string componentsSeparatedByString:@"\n"];
+    NSMutableArray *paddedLines = [NSMutableArray arrayWithCapacity:lines.count];
+    for (NSString *line in lines) {
+        NSString *padding = [@"" stringByPaddingToLength:indent withString:indentCharacter startingAtIndex:0];
+        [paddedLines addObject:[padding stringByAppendingString:line]];
+    }
+    return [paddedLines componentsJoinedByString:@"\n"];
+}
+
+static void runIndentBenchmark(NSUInteger lineCount, NSInteger iterations) {
+    
+    /// A log dump with `lineCount` lines
+    
+    NSMutableString *log = [NSMutableString string];
+    for (NSUInteger i = 0; i < lineCount; i++) {
+        [log appendFormat:@"2026-10-18 12:00:%02lu.%03lu [Scroll] Smooth scroll tick %lu, delta: %lu\n", (unsigned long)(i % 60), (unsigned long)(i % 1000), (unsigned long)i, (unsigned long)(i * 7 % 120)];
+    }
+    
+    /// Old
+    NSString *legacyResult = nil;
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            legacyResult = legacyStringByAddingIndent(log, 4, @" ");
+        }
+    }
+    CFTimeInterval legacyTime = CACurrentMediaTime() - startTime;
+    
+    /// New
+    NSString *result = nil;
+    startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            result = [log stringByAddingIndent:4];
+        }
+    }
+    CFTimeInterval time = CACurrentMediaTime() - startTime;
+    
+    NSLog(@"Indent (%lu lines, %lu chars) - old: %f ms, new: %f ms per string (%.2fx)",
+          (unsigned long)lineCount, (unsigned long)log.length, legacyTime / iterations * 1000, time / iterations * 1000, legacyTime / time);
+}
+
+static void runRegexCacheBenchmark(NSInteger iterations) {
+    
+    /// Repeated calls with the same patterns, like in our loops. `substringWithRegex:` vs `rangeOfString:options:NSRegularExpressionSearch`, and the secret message pattern from NSString+Steganography compiled per call vs cached.
+    
+    NSArray<NSString *> *strings = @[
+        @"Mac Mouse Fix 3.0.3 (22736)",
+        @"Version 2.2.5 Beta 4 - build 2025-01-15",
+        @"No version number in here",
+    ];
+    NSString *versionPattern = @"[0-9]+(\\.[0-9]+)+";
+    
+    /// Old
+    CFTimeInterval startTime = CACurrentMediaTime();
+    NSMutableArray *legacyResults = [NSMutableArray array];
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            [legacyResults removeAllObjects];
+            for (NSString *string in strings) {
+                NSRange range = [string rangeOfString:versionPattern options:NSRegularExpressionSearch];
+                [legacyResults addObject:(range.location == NSNotFound) ? NSNull.null : [string substringWithRange:range]];
+            }
+        }
+    }
+    CFTimeInterval legacyTime = CACurrentMediaTime() - startTime;
+    
+    /// New
+    clearRegexCache();
+    startTime = CACurrentMediaTime();
+    NSMutableArray *results = [NSMutableArray array];
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            [results removeAllObjects];
+            for (NSString *string in strings) {
+                [results addObject:[string substringWithRegex:versionPattern] ?: NSNull.null];
+            }
+        }
+    }
+    CFTimeInterval time = CACurrentMediaTime() - startTime;
+    
+    NSLog(@"substringWithRegex (%lu strings) - compiled per call: %f us, cached: %f us per string (%.2fx)",
+          (unsigned long)strings.count, legacyTime / iterations / strings.count * 1e6, time / iterations / strings.count * 1e6, legacyTime / time);
+    
+    /// Secret messages
+    NSString *secretPattern = @"\u200B\u200C\u200B\u200D\u200B(?:(?:[\u200C\u200D\u2060\u2062]{4})*)\u200B\u200D\u200B\u200C\u200B";
+    NSString *uiString = @"Click and Drag\u200B\u200C\u200B\u200D\u200B\u200C\u200D\u2060\u2062\u200B\u200D\u200B\u200C\u200B";
+    NSRange all = NSMakeRange(0, uiString.length);
+    
+    NSUInteger legacyCount = 0;
+    startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            NSRegularExpression *expression = [NSRegularExpression regularExpressionWithPattern:secretPattern options:0 error:nil];
+            legacyCount = [expression matchesInString:uiString options:0 range:all].count;
+        }
+    }
+    legacyTime = CACurrentMediaTime() - startTime;
+    
+    NSUInteger count = 0;
+    startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            count = [cachedRegularExpression(secretPattern, 0) matchesInString:uiString options:0 range:all].count;
+        }
+    }
+    time = CACurrentMediaTime() - startTime;
+    
+    RegexCacheStatistics stats = regexCacheStatistics();
+    NSLog(@"Secret message pattern - compiled per call: %f us, cached: %f us per call (%.2fx). Regex cache: %lu hits, %lu misses, %lu patterns",
+          legacyTime / iterations * 1e6, time / iterations * 1e6, legacyTime / time,
+          (unsigned long)stats.hits, (unsigned long)stats.misses, (unsigned long)stats.count);
+}
+
+void runStringAdditionsBenchmarks(void) {
+
+    @autoreleasepool {
+
+        NSLog(@"------------------");
+        NSLog(@"5-step styling chain (immutable vs in-place):");
+        NSLog(@"------------------");
+
+        runStylingChainBenchmark(100, 10000);
+        runStylingChainBenchmark(10000, 1000);
+        runStylingChainBenchmark(100000, 100);
+
+        NSLog(@"------------------");
+        NSLog(@"Batched edits (in-place chain vs AttributedStringBuilder):");
+        NSLog(@"------------------");
+
+        runBuilderBenchmark(1000, 10, 1000);
+        runBuilderBenchmark(10000, 50, 100);
+        runBuilderBenchmark(100000, 200, 10);
+
+        NSLog(@"------------------");
+        NSLog(@"attributedStringWithAttributedFormat: (old vs new):");
+        NSLog(@"------------------");
+
+        runFormatBenchmark(1, 100, 10000);
+        runFormatBenchmark(50, 100, 1000);
+        runFormatBenchmark(50, 2000, 100);
+
+        NSLog(@"------------------");
+        NSLog(@"Font resolution cache:");
+        NSLog(@"------------------");
+
+        runFontCacheBenchmark(10, 1000);
+        runFontCacheBenchmark(1000, 20);
+
+        NSLog(@"------------------");
+        NSLog(@"Text measurement (sizeAtMaxWidth: + heightAtWidth:):");
+        NSLog(@"------------------");
+
+        runTableReloadBenchmark(50, 50);
+        runTableReloadBenchmark(500, 10);
+
+        NSLog(@"------------------");
+        NSLog(@"Whitespace trimming:");
+        NSLog(@"------------------");
+
+        runTrimmingBenchmark(10, 1, 1000);
+        runTrimmingBenchmark(100, 10, 100);
+        runTrimmingBenchmark(1000, 50, 5);
+
+        NSLog(@"------------------");
+        NSLog(@"Styling keywords (rangeOfString: per keyword vs SubstringMatcher):");
+        NSLog(@"------------------");
+
+        runKeywordStylingBenchmark(10, 5000, 50);
+        runKeywordStylingBenchmark(50, 50000, 5);
+
+        NSLog(@"------------------");
+        NSLog(@"Attribute run compaction:");
+        NSLog(@"------------------");
+
+        runRunCompactionBenchmark(200);
+
+        NSLog(@"------------------");
+        NSLog(@"Style registry:");
+        NSLog(@"------------------");
+
+        runLabelRenderBenchmark(10000);
+
+        NSLog(@"------------------");
+        NSLog(@"Adding attributes as base:");
+        NSLog(@"------------------");
+
+        runAddingBaseBenchmark(1, 10000);
+        runAddingBaseBenchmark(100, 1000);
+        runAddingBaseBenchmark(1000, 100);
+
+        NSLog(@"------------------");
+        NSLog(@"Setting weight and size:");
+        NSLog(@"------------------");
+
+        runSetWeightBenchmark(10, 1000);
+        runSetWeightBenchmark(100, 100);
+
+        NSLog(@"------------------");
+        NSLog(@"String with attachment descriptions:");
+        NSLog(@"------------------");
+
+        runAttachmentDescriptionsBenchmark(10, 1000);
+        runAttachmentDescriptionsBenchmark(1000, 50);
+
+        NSLog(@"------------------");
+        NSLog(@"Indent:");
+        NSLog(@"------------------");
+
+        runIndentBenchmark(100, 1000);
+        runIndentBenchmark(50000, 5);
+
+        NSLog(@"------------------");
+        NSLog(@"Regex cache:");
+        NSLog(@"------------------");
+
+        runRegexCacheBenchmark(10000);
+    }
+}
+
+@end
@@ -0,0 +1,28 @@
+//
+//  StringAdditionsTests.h
+//  objc-test-july-13-2024
+//
+//  Created by Noah Nübling on 18.10.26.
+//
+
+#import <Foundation/Foundation.h>
+
+@interface StringAdditionsTests : NSObject
+
+void stringadditions_inplace_tests(void);
+void stringadditions_builder_tests(void);
+void stringadditions_format_tests(void);
+void stringadditions_fontcache_tests(void);
+void stringadditions_measurement_tests(void);
+void stringadditions_trimming_tests(void);
+void stringadditions_substringmatcher_tests(void);
+void stringadditions_runstatistics_tests(void);
+void stringadditions_compaction_tests(void);
+void stringadditions_styleregistry_tests(void);
+void stringadditions_addingbase_tests(void);
+void stringadditions_setweight_tests(void);
+void stringadditions_attachment_tests(void);
+void stringadditions_indent_tests(void);
+void stringadditions_regex_tests(void);
+
+@end
@@ -0,0 +1,928 @@
+//
+//  StringAdditionsTests.m
+//  objc-test-july-13-2024
+//
+//  Created by Noah Nübling on 18.10.26.
+//
+
+#import "StringAdditionsTests.h"
+#import "NSAttributedString+Additions.h"
+#import "AttributedStringBuilder.h"
+#import "NSString+Additions.h"
+#import "SubstringMatcher.h"
+#import "AppKit/AppKit.h"
+
+@implementation StringAdditionsTests
+
+void stringadditions_inplace_tests(void) {
+
+    /// The immutable API and the in-place API should give the same result for the same chain of edits.
+    ///     `forSubstring:` throws if the substring isn't there, so strings without the substrings only get the range edits.
+
+    #define mflog(msg...) NSLog(@"StringAdditions: InPlaceTests: " msg)
+
+    NSURL *url = [NSURL URLWithString:@"https://macmousefix.com"];
+    NSArray<NSString *> *strings = @[
+        @"Lorem ipsum dolor sit amet. Learn more",
+        @"ipsumLearn more",                         /// Substrings back to back
+        @"Learn more ipsum, Learn more ipsum",      /// Only the first occurrence is styled
+        @"No substrings in here",
+        @"",
+    ];
+
+    NSInteger failures = 0;
+    for (NSString *string in strings) {
+
+        Boolean hasSubstrings = [string containsString:@"ipsum"] && [string containsString:@"Learn more"];
+
+        NSAttributedString *immutable = string.attributed;
+        immutable = [immutable attributedStringByFillingOutBase];
+        immutable = [immutable attributedStringByAddingWeight:NSFontWeightSemibold forRange:NULL];
+        if (hasSubstrings) immutable = [immutable attributedStringByAddingColor:NSColor.secondaryLabelColor forSubstring:@"ipsum"];
+        if (hasSubstrings) immutable = [immutable attributedStringByAddingHyperlink:url forSubstring:@"Learn more"];
+        immutable = [immutable attributedStringByAddingParagraphSpacing:4 forRange:NULL];
+
+        NSMutableAttributedString *inPlace = string.attributed.mutableCopy;
+        [inPlace fillOutBase];
+        [inPlace addWeight:NSFontWeightSemibold forRange:NULL];
+        if (hasSubstrings) [inPlace addColor:NSColor.secondaryLabelColor forSubstring:@"ipsum"];
+        if (hasSubstrings) [inPlace addHyperlink:url forSubstring:@"Learn more"];
+        [inPlace addParagraphSpacing:4 forRange:NULL];
+
+        if (![immutable isEqual:inPlace]) {
+            mflog("Immutable and in-place differ for '%@'", string);
+            failures += 1;
+        }
+    }
+
+    mflog("%lu strings, %ld failures", (unsigned long)strings.count, (long)failures);
+    assert(failures == 0);
+
+    #undef mflog
+}
+
+static NSArray<NSValue *> *literalRanges(NSString *string, NSString *substring, Boolean all) {
+
+    /// The first or every (overlapping) literal occurrence – what the builder's `forSubstring:` and `forAllOccurrencesOfSubstring:` should find.
+
+    NSMutableArray<NSValue *> *ranges = [NSMutableArray array];
+    if (substring.length == 0) return ranges;
+    for (NSUInteger loc = 0; loc + substring.length <= string.length; loc++) {
+        NSRange range = [string rangeOfString:substring options:NSLiteralSearch | NSAnchoredSearch range:NSMakeRange(loc, string.length - loc)];
+        if (range.location == NSNotFound) continue;
+        [ranges addObject:[NSValue valueWithRange:range]];
+        if (!all) break;
+    }
+    return ranges;
+}
+
+void stringadditions_builder_tests(void) {
+
+    /// Builder edits vs the same edits made with the in-place methods on the ranges we expect the builder to find.
+    ///     Substrings that don't occur should be ignored, not throw.
+
+    #define mflog(msg...) NSLog(@"StringAdditions: BuilderTests: " msg)
+
+    NSArray<NSArray *> *cases = @[ /// String, substring, all occurrences
+        @[@"Learn more or Learn more",  @"Learn more",  @NO],
+        @[@"Learn more or Learn more",  @"Learn more",  @YES],
+        @[@"aaaa",                      @"aa",          @YES],  /// Overlapping occurrences
+        @[@"Lorem ipsum",               @"missing",     @NO],   /// Doesn't occur
+        @[@"Lorem ipsum",               @"missing",     @YES],
+        @[@"Lorem ipsum",               @"",            @YES],  /// Empty substrings never match
+        @[@"",                          @"x",           @NO],
+        @[@"",                          @"x",           @YES],
+        @[@"ipsum",                     @"ipsum",       @NO],   /// Whole string
+        @[@"a👍b👍",                    @"👍",          @YES],  /// Surrogate pairs
+        @[@"Cafe\u0301",               @"Caf\u00e9",    @NO],   /// Canonically equivalent but not literally equal, so not found
+    ];
+
+    NSInteger failures = 0;
+    for (NSArray *c in cases) {
+
+        NSString *string = c[0];
+        NSString *substring = c[1];
+        Boolean all = [c[2] boolValue];
+
+        AttributedStringBuilder *b = [AttributedStringBuilder builderWithString:string];
+        [b fillOutBase];
+        if (all) [b addColor:NSColor.systemBlueColor forAllOccurrencesOfSubstring:substring];
+        else     [b addColor:NSColor.systemBlueColor forSubstring:substring];
+        [b addParagraphSpacing:4 forRange:NULL];
+        NSAttributedString *result = [b build];
+
+        NSMutableAttributedString *expected = string.attributed.mutableCopy;
+        [expected fillOutBase];
+        for (NSValue *value in literalRanges(string, substring, all)) {
+            NSRange range = value.rangeValue;
+            [expected addColor:NSColor.systemBlueColor forRange:&range];
+        }
+        [expected addParagraphSpacing:4 forRange:NULL];
+
+        if (![result isEqual:expected]) {
+            mflog("Mismatch for '%@' in '%@' (all: %d)", substring, string, all);
+            failures += 1;
+        }
+    }
+
+    mflog("%lu cases, %ld failures", (unsigned long)cases.count, (long)failures);
+    assert(failures == 0);
+
+    #undef mflog
+}
+
+void stringadditions_format_tests(void) {
+
+    /// Positional placeholders and edge cases of `attributedStringWithFormat:args:`, then whether the attributes of the format and the args survive.
+
+    #define mflog(msg...) NSLog(@"StringAdditions: FormatTests: " msg)
+
+    NSAttributedString *a = @"A".attributed;
+    NSAttributedString *b = @"B".attributed;
+    NSAttributedString *placeholderArg = @"%@".attributed;
+
+    NSArray<NSArray *> *cases = @[ /// Format, args, expected
+        @[@"%@ and %@",         @[a, b],            @"A and B"],
+        @[@"%2$@ and %1$@",     @[a, b],            @"B and A"],
+        @[@"%1$@%1$@",          @[a],               @"AA"],
+        @[@"%@ %@ %@",          @[a, b],            @"A B %@"],     /// Extra placeholders are left alone
+        @[@"%3$@ %@",           @[a],               @"%3$@ A"],     /// Out-of-range positions too
+        @[@"100% %@",           @[a],               @"100% A"],
+        @[@"%@%",               @[a],               @"A%"],         /// Lone % at the end
+        @[@"%@",                @[placeholderArg],  @"%@"],         /// Args aren't rescanned
+        @[@"%@",                @[],                @"%@"],
+        @[@"",                  @[a],               @""],
+    ];
+
+    NSInteger failures = 0;
+    for (NSArray *c in cases) {
+        NSString *result = [NSAttributedString attributedStringWithFormat:c[0] args:c[1]].string;
+        if (![result isEqual:c[2]]) {
+            mflog("'%@' gave '%@', expected '%@'", c[0], result, c[2]);
+            failures += 1;
+        }
+    }
+
+    /// Appending doesn't treat `%@` as a placeholder
+    if (![[a attributedStringByAppending:placeholderArg].string isEqual:@"A%@"]) {
+        mflog("Appending replaced a placeholder");
+        failures += 1;
+    }
+
+    /// Attributes
+    NSAttributedString *boldArg = [@"bold".attributed attributedStringByAddingBoldForRange:NULL];
+    NSAttributedString *format = [[NSAttributedString alloc] initWithString:@"x %@ y" attributes:@{ NSForegroundColorAttributeName: NSColor.secondaryLabelColor }];
+    NSAttributedString *result = [NSAttributedString attributedStringWithAttributedFormat:format args:@[boldArg]];
+    if (![[result attributesAtIndex:0 effectiveRange:NULL] isEqual:[format attributesAtIndex:0 effectiveRange:NULL]] ||
+        ![[result attributesAtIndex:2 effectiveRange:NULL] isEqual:[boldArg attributesAtIndex:0 effectiveRange:NULL]] ||
+        ![[result attributesAtIndex:result.length - 1 effectiveRange:NULL] isEqual:[format attributesAtIndex:0 effectiveRange:NULL]]) {
+        mflog("Attributes of the format or the arg got lost: %@", result);
+        failures += 1;
+    }
+
+    mflog("%lu cases, %ld failures", (unsigned long)cases.count, (long)failures);
+    assert(failures == 0);
+
+    #undef mflog
+}
+
+void stringadditions_fontcache_tests(void) {
+
+    /// Every font helper on a few base fonts: The second call should come from the cache, and a result resolved after clearing the cache should be equal.
+    ///     nil means the default font. Trait dictionaries with the same count but different values must not share an entry. No helper should ever return nil.
+
+    #define mflog(msg...) NSLog(@"StringAdditions: FontCacheTests: " msg)
+
+    NSArray<NSFont *> *fonts = @[
+        [NSFont systemFontOfSize:NSFont.systemFontSize],
+        [NSFont systemFontOfSize:NSFont.smallSystemFontSize],
+        [NSFont monospacedSystemFontOfSize:NSFont.systemFontSize weight:NSFontWeightRegular],
+    ];
+    NSArray<NSFont *(^)(NSFont *)> *operations = @[
+        ^NSFont *(NSFont *font) { return fontByAddingFontTraits(font, @{ NSFontWeightTrait: @(NSFontWeightBold) }); },
+        ^NSFont *(NSFont *font) { return fontByAddingSymbolicFontTraits(font, NSFontDescriptorTraitItalic); },
+        ^NSFont *(NSFont *font) { return fontBySettingSize(font, 17); },
+        ^NSFont *(NSFont *font) { return fontBySettingManagerWeight(font, 9); },
+        ^NSFont *(NSFont *font) { return fontByAddingFontAttributes(font, @{ NSFontFixedAdvanceAttribute: @(10) }); },
+    ];
+
+    NSInteger failures = 0;
+    for (NSFont *font in fonts) {
+        for (NSUInteger i = 0; i < operations.count; i++) {
+
+            clearFontCache();
+            NSFont *first = operations[i](font);
+            NSFont *second = operations[i](font);
+            clearFontCache();
+            NSFont *resolvedAgain = operations[i](font);
+
+            if (first != second) {
+                mflog("Operation %lu on %@ wasn't served from the cache", (unsigned long)i, font);
+                failures += 1;
+            }
+            if (first != resolvedAgain && ![first isEqual:resolvedAgain]) {
+                mflog("Operation %lu on %@ gave %@ cold and %@ warm", (unsigned long)i, font, resolvedAgain, first);
+                failures += 1;
+            }
+        }
+    }
+
+    /// nil font
+    NSFont *systemFont = [NSFont systemFontOfSize:NSFont.systemFontSize];
+    for (NSUInteger i = 0; i < operations.count; i++) {
+        NSFont *fromNil = operations[i](nil);
+        NSFont *fromSystem = operations[i](systemFont);
+        if (fromNil != fromSystem && ![fromNil isEqual:fromSystem]) {
+            mflog("Operation %lu on nil doesn't start from the system font", (unsigned long)i);
+            failures += 1;
+        }
+    }
+
+    /// Fonts that might not resolve
+    ///     The helpers should fall back to the font they started from instead of returning nil.
+    NSArray<NSFont *(^)(NSFont *)> *unlikelyOperations = @[
+        ^NSFont *(NSFont *font) { return fontBySettingManagerWeight(font, 99); },
+        ^NSFont *(NSFont *font) { return fontBySettingManagerWeight(font, -1); },
+        ^NSFont *(NSFont *font) { return fontByAddingFontAttributes(font, @{ NSFontFamilyAttribute: @"No Such Font Family" }); },
+        ^NSFont *(NSFont *font) { return fontBySettingSize(font, 0); },
+    ];
+    for (NSFont *font in fonts) {
+        for (NSUInteger i = 0; i < unlikelyOperations.count; i++) {
+            if (unlikelyOperations[i](font) == nil) {
+                mflog("Unlikely operation %lu on %@ returned nil", (unsigned long)i, font);
+                failures += 1;
+            }
+        }
+    }
+
+    /// Same size
+    if (fontBySettingSize(systemFont, systemFont.pointSize) != systemFont) {
+        mflog("Setting the same size didn't return the font itself");
+        failures += 1;
+    }
+
+    /// Same count, different values
+    NSFont *bold = fontByAddingFontTraits(systemFont, @{ NSFontWeightTrait: @(NSFontWeightBold) });
+    NSFont *light = fontByAddingFontTraits(systemFont, @{ NSFontWeightTrait: @(NSFontWeightLight) });
+    if ([bold isEqual:light]) {
+        mflog("Different weights gave the same font");
+        failures += 1;
+    }
+
+    /// Statistics
+    clearFontCache();
+    operations[0](systemFont);
+    operations[0](systemFont);
+    FontCacheStatistics stats = fontCacheStatistics();
+    if (stats.misses != 1 || stats.hits != 1 || stats.count != 1) {
+        mflog("Unexpected statistics: %lu hits, %lu misses, %lu fonts", (unsigned long)stats.hits, (unsigned long)stats.misses, (unsigned long)stats.count);
+        failures += 1;
+    }
+
+    mflog("%lu fonts, %lu operations, %ld failures", (unsigned long)fonts.count, (unsigned long)operations.count, (long)failures);
+    assert(failures == 0);
+
+    #undef mflog
+}
+
+static NSSize freshStackSize(NSAttributedString *string, CGFloat maxWidth) {
+
+    /// Measures with a new layout stack, so nothing is left over from earlier measurements
+
+    NSTextContainer *textContainer = [[NSTextContainer alloc] initWithSize:CGSizeMake(maxWidth, CGFLOAT_MAX)];
+    NSLayoutManager *layoutManager = [[NSLayoutManager alloc] init];
+    [layoutManager addTextContainer:textContainer];
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithAttributedString:string];
+    [textStorage addLayoutManager:layoutManager];
+    [layoutManager glyphRangeForTextContainer:textContainer];
+    return [layoutManager usedRectForTextContainer:textContainer].size;
+}
+
+void stringadditions_measurement_tests(void) {
+
+    /// Cached measurements vs a fresh layout stack and the uncached height, cold and warm, at several widths.
+    ///     A mutable string that changes after it was measured must not get the old result.
+
+    #define mflog(msg...) NSLog(@"StringAdditions: MeasurementTests: " msg)
+
+    NSArray<NSString *> *texts = @[
+        @"",
+        @"a",
+        @"Click and Drag",
+        @"Lorem ipsum dolor sit amet, consectetur adipiscing elit. Sed do eiusmod tempor incididunt ut labore et dolore magna aliqua.",
+        @"First paragraph\n\nSecond paragraph\n",
+    ];
+    CGFloat widths[] = { 1, 100, 240, 10000 };
+
+    NSInteger failures = 0;
+    NSInteger checks = 0;
+    for (NSString *text in texts) {
+        NSAttributedString *string = [text.attributed attributedStringByFillingOutBase];
+        for (size_t i = 0; i < sizeof(widths) / sizeof(widths[0]); i++) {
+
+            CGFloat width = widths[i];
+            clearTextMeasurementCache();
+            NSSize cold = [string sizeAtMaxWidth:width];
+            NSSize warm = [string sizeAtMaxWidth:width];
+            CGFloat coldHeight = [string heightAtWidth:width];
+            CGFloat warmHeight = [string heightAtWidth:width];
+            checks++;
+
+            if (!NSEqualSizes(cold, freshStackSize(string, width)) || !NSEqualSizes(cold, warm)) {
+                mflog("Size of '%@' at %f: cold %@, warm %@", text, width, NSStringFromSize(cold), NSStringFromSize(warm));
+                failures += 1;
+            }
+            if (coldHeight != [string uncachedHeightAtWidth:width] || coldHeight != warmHeight) {
+                mflog("Height of '%@' at %f: cold %f, warm %f", text, width, coldHeight, warmHeight);
+                failures += 1;
+            }
+        }
+    }
+
+    /// Mutated after measuring
+    NSMutableAttributedString *mutable = [@"Short".attributed attributedStringByFillingOutBase].mutableCopy;
+    [mutable sizeAtMaxWidth:100];
+    [mutable heightAtWidth:100];
+    [mutable appendAttributedString:[texts[3].attributed attributedStringByFillingOutBase]];
+    if (!NSEqualSizes([mutable sizeAtMaxWidth:100], freshStackSize(mutable, 100)) || [mutable heightAtWidth:100] != [mutable uncachedHeightAtWidth:100]) {
+        mflog("Got a stale measurement after mutating the string");
+        failures += 1;
+    }
+
+    mflog("%ld checks, %ld failures", (long)checks, (long)failures);
+    assert(failures == 0);
+
+    #undef mflog
+}
+
+void stringadditions_trimming_tests(void) {
+
+    /// Leading and trailing whitespace goes away, runs inside shrink to their last char, linebreaks stay. The attributed and the NSString path should agree.
+
+    #define mflog(msg...) NSLog(@"StringAdditions: TrimmingTests: " msg)
+
+    NSArray<NSArray<NSString *> *> *cases = @[ /// Input, expected
+        @[@"",                          @""],
+        @[@"   ",                       @""],
+        @[@"a",                         @"a"],
+        @[@" a ",                       @"a"],
+        @[@"a  b",                      @"a b"],
+        @[@"a \t\tb",                   @"a\tb"],
+        @[@"  \t a \t\t b \t ",         @"a b"],
+        @[@"a\n  b",                    @"a\n b"],      /// Linebreaks aren't whitespace, so they split runs
+        @[@"\n a \n",                   @"\n a \n"],
+    ];
+
+    NSInteger failures = 0;
+    for (NSArray<NSString *> *c in cases) {
+        NSString *attributedResult = [c[0].attributed attributedStringByTrimmingWhitespace].string;
+        NSString *plainResult = [c[0] stringByTrimmingWhiteSpace];
+        if (![attributedResult isEqual:c[1]] || ![plainResult isEqual:c[1]]) {
+            mflog("'%@' gave '%@' (attributed) and '%@' (plain), expected '%@'", c[0], attributedResult, plainResult, c[1]);
+            failures += 1;
+        }
+    }
+
+    /// Attributes stay with their chars
+    NSMutableAttributedString *colored = [[NSMutableAttributedString alloc] initWithString:@"  "];
+    [colored appendAttributedString:[[NSAttributedString alloc] initWithString:@"red" attributes:@{ NSForegroundColorAttributeName: NSColor.systemRedColor }]];
+    [colored appendAttributedString:@"  ".attributed];
+    [colored appendAttributedString:[[NSAttributedString alloc] initWithString:@"blue" attributes:@{ NSForegroundColorAttributeName: NSColor.systemBlueColor }]];
+    [colored appendAttributedString:@"  ".attributed];
+    NSAttributedString *trimmed = [colored attributedStringByTrimmingWhitespace];
+    if (![trimmed.string isEqual:@"red blue"] ||
+        ![[trimmed attribute:NSForegroundColorAttributeName atIndex:0 effectiveRange:NULL] isEqual:NSColor.systemRedColor] ||
+        [trimmed attribute:NSForegroundColorAttributeName atIndex:3 effectiveRange:NULL] != nil ||
+        ![[trimmed attribute:NSForegroundColorAttributeName atIndex:4 effectiveRange:NULL] isEqual:NSColor.systemBlueColor]) {
+        mflog("Attributes moved while trimming: %@", trimmed);
+        failures += 1;
+    }
+
+    mflog("%lu cases, %ld failures", (unsigned long)cases.count, (long)failures);
+    assert(failures == 0);
+
+    #undef mflog
+}
+
+static Boolean checkSubstringMatcher(NSString *string, NSArray<NSString *> *substrings, NSSet<NSString *> *expectedMatches) {
+
+    /// Compares all matches and the first matches with `rangeOfString:`. If `expectedMatches` is given, the matches also have to be exactly those. (Formatted as "<substring index> <range>".)
+
+    SubstringMatcher *matcher = [[SubstringMatcher alloc] initWithSubstrings:substrings];
+
+    /// All matches
+    NSMutableSet<NSString *> *found = [NSMutableSet set];
+    [matcher enumerateMatchesInString:string usingBlock:^(NSUInteger substringIndex, NSRange range, BOOL *stop) {
+        [found addObject:stringf(@"%lu %@", (unsigned long)substringIndex, NSStringFromRange(range))];
+    }];
+    NSMutableSet<NSString *> *expected = [NSMutableSet set];
+    for (NSUInteger i = 0; i < substrings.count; i++) {
+        for (NSValue *range in literalRanges(string, substrings[i], true)) {
+            [expected addObject:stringf(@"%lu %@", (unsigned long)i, NSStringFromRange(range.rangeValue))];
+        }
+    }
+    if (![found isEqual:expected]) return false;
+    if (expectedMatches != nil && ![found isEqual:expectedMatches]) return false;
+
+    /// First matches
+    NSUInteger rangeCount = MAX(substrings.count, 1);
+    NSRange firstRanges[rangeCount];
+    [matcher firstMatchesInString:string outRanges:firstRanges];
+    for (NSUInteger i = 0; i < substrings.count; i++) {
+        NSRange r = (substrings[i].length == 0) ? NSMakeRange(NSNotFound, 0) : [string rangeOfString:substrings[i] options:NSLiteralSearch];
+        if (r.location != firstRanges[i].location) return false;
+        if (r.location != NSNotFound && r.length != firstRanges[i].length) return false;
+    }
+    return true;
+}
+
+void stringadditions_substringmatcher_tests(void) {
+
+    /// `SubstringMatcher` vs `rangeOfString:` – first on edge cases with known matches, then on random strings over a tiny alphabet, so there are lots of (overlapping) matches.
+
+    #define mflog(msg...) NSLog(@"StringAdditions: SubstringMatcherTests: " msg)
+
+    NSArray<NSArray *> *cases = @[ /// String, substrings, expected matches
+        @[@"aaaa",  @[@"aa"],                       @[@"0 {0, 2}", @"0 {1, 2}", @"0 {2, 2}"]],
+        @[@"abc",   @[@"ab", @"abc", @"b", @"c"],   @[@"0 {0, 2}", @"1 {0, 3}", @"2 {1, 1}", @"3 {2, 1}"]],   /// Substrings that end inside each other
+        @[@"abc",   @[@"x", @""],                   @[]],                                                   /// Missing and empty substrings
+        @[@"abc",   @[],                            @[]],
+        @[@"",      @[@"a"],                        @[]],
+        @[@"a👍b",  @[@"👍", @"b"],                 @[@"0 {1, 2}", @"1 {3, 1}"]],                           /// Surrogate pairs
+    ];
+
+    NSInteger failures = 0;
+    for (NSArray *c in cases) {
+        if (!checkSubstringMatcher(c[0], c[1], [NSSet setWithArray:c[2]])) {
+            mflog("Wrong matches for %@ in '%@'", c[1], c[0]);
+            failures += 1;
+        }
+    }
+
+    /// Random
+    NSArray<NSString *> *alphabet = @[@"a", @"b", @"ä", @"👍"];
+    __block uint32_t seed = 1;
+    NSString *(^randomString)(NSUInteger) = ^NSString *(NSUInteger maxLength) {
+        NSMutableString *s = [NSMutableString string];
+        seed = seed * 1103515245 + 12345;
+        NSUInteger length = (seed >> 16) % (maxLength + 1);
+        for (NSUInteger i = 0; i < length; i++) {
+            seed = seed * 1103515245 + 12345;
+            [s appendString:alphabet[(seed >> 16) % alphabet.count]];
+        }
+        return s;
+    };
+    NSInteger rounds = 500;
+    for (NSInteger round = 0; round < rounds; round++) {
+        NSString *string = randomString(40);
+        NSMutableArray<NSString *> *substrings = [NSMutableArray array];
+        for (NSInteger i = 0; i < 5; i++) [substrings addObject:randomString(4)];
+        if (!checkSubstringMatcher(string, substrings, nil)) {
+            mflog("Wrong matches for %@ in '%@'", substrings, string);
+            failures += 1;
+        }
+    }
+
+    mflog("%lu cases, %ld random rounds, %ld failures", (unsigned long)cases.count, (long)rounds, (long)failures);
+    assert(failures == 0);
+
+    #undef mflog
+}
+
+static NSUInteger distinctDictionaryCount(NSAttributedString *string) {
+
+    /// Distinct by content, not by instance
+
+    NSMutableArray<NSDictionary *> *distinct = [NSMutableArray array];
+    [string enumerateAttributesInRange:NSMakeRange(0, string.length) options:0 usingBlock:^(NSDictionary<NSAttributedStringKey,id> * _Nonnull attrs, NSRange range, BOOL * _Nonnull stop) {
+        if (![distinct containsObject:attrs]) [distinct addObject:attrs];
+    }];
+    return distinct.count;
+}
+
+static NSAttributedString *fragmentedString(NSArray<NSString *> *texts, NSArray<NSColor *> *colors) {
+
+    /// A separate but equal dictionary for every fragment
+
+    NSMutableAttributedString *s = [[NSMutableAttributedString alloc] init];
+    for (NSUInteger i = 0; i < texts.count; i++) {
+        NSMutableDictionary *attributes = [NSMutableDictionary dictionary];
+        attributes[NSForegroundColorAttributeName] = colors[i % colors.count];
+        [s appendAttributedString:[[NSAttributedString alloc] initWithString:texts[i] attributes:attributes.copy]];
+    }
+    return s;
+}
+
+void stringadditions_runstatistics_tests(void) {
+
+    /// `attributeRunStatistics()` should count every run, and the instances should lie between the distinct dictionaries and the runs.
+    ///     Whether equal dictionaries end up as one instance is up to the storage, so we don't check that.
+
+    #define mflog(msg...) NSLog(@"StringAdditions: RunStatisticsTests: " msg)
+
+    NSArray<NSArray *> *cases = @[
+        @[@"".attributed,                                                                                  @0],
+        @[@"single run".attributed,                                                                        @1],
+        @[fragmentedString(@[@"a", @"b", @"c", @"d"], @[NSColor.systemRedColor, NSColor.systemBlueColor]), @4], /// Equal dictionaries that aren't adjacent
+    ];
+
+    NSInteger failures = 0;
+    for (NSArray *c in cases) {
+        NSAttributedString *string = c[0];
+        NSUInteger expectedRuns = [c[1] unsignedIntegerValue];
+        AttributeRunStatistics stats = attributeRunStatistics(string);
+        if (stats.runCount != expectedRuns) {
+            mflog("'%@' has %lu runs, expected %lu", string.string, (unsigned long)stats.runCount, (unsigned long)expectedRuns);
+            failures += 1;
+        }
+        NSUInteger distinct = distinctDictionaryCount(string);
+        if (stats.dictionaryInstanceCount < distinct || stats.dictionaryInstanceCount > stats.runCount) {
+            mflog("'%@' has %lu instances for %lu distinct dictionaries and %lu runs", string.string,
+                  (unsigned long)stats.dictionaryInstanceCount, (unsigned long)distinct, (unsigned long)stats.runCount);
+            failures += 1;
+        }
+    }
+
+    mflog("%lu cases, %ld failures", (unsigned long)cases.count, (long)failures);
+    assert(failures == 0);
+
+    #undef mflog
+}
+
+void stringadditions_compaction_tests(void) {
+
+    /// Compacting mustn't change the string. Afterwards, equal dictionaries should be one instance, and there shouldn't be more runs or instances than before.
+
+    #define mflog(msg...) NSLog(@"StringAdditions: CompactionTests: " msg)
+
+    NSMutableAttributedString *overlapping = [fragmentedString(@[@"Some words to style"], @[NSColor.labelColor]) mutableCopy];
+    for (NSUInteger start = 0; start + 5 < overlapping.length; start += 3) {
+        NSRange r = NSMakeRange(start, 5);
+        [overlapping addBaseLineOffset:0 forRange:&r];
+    }
+
+    NSArray<NSAttributedString *> *strings = @[
+        @"".attributed,
+        @"single run".attributed,
+        fragmentedString(@[@"a", @"b", @"c"], @[NSColor.systemRedColor]),                                /// Adjacent equal dictionaries
+        fragmentedString(@[@"a", @"b", @"c", @"d"], @[NSColor.systemRedColor, NSColor.systemBlueColor]), /// Equal dictionaries that aren't adjacent
+        overlapping,                                                                                     /// Overlapping modifier passes
+        [NSAttributedString attributedStringWithCoolMarkdown:@"**Bold** and *italic* and **bold** again, [link](https://macmousefix.com)"],
+    ];
+
+    NSInteger failures = 0;
+    for (NSAttributedString *string in strings) {
+        NSAttributedString *compacted = [string attributedStringByCompactingAttributeRuns];
+        AttributeRunStatistics before = attributeRunStatistics(string);
+        AttributeRunStatistics after = attributeRunStatistics(compacted);
+        if (![compacted isEqual:string]) {
+            mflog("Compacting changed '%@'", string.string);
+            failures += 1;
+        }
+        if (after.runCount > before.runCount || after.dictionaryInstanceCount > before.dictionaryInstanceCount) {
+            mflog("'%@' got more runs or instances: %lu -> %lu runs, %lu -> %lu instances", string.string,
+                  (unsigned long)before.runCount, (unsigned long)after.runCount, (unsigned long)before.dictionaryInstanceCount, (unsigned long)after.dictionaryInstanceCount);
+            failures += 1;
+        }
+        if (after.dictionaryInstanceCount != distinctDictionaryCount(compacted)) {
+            mflog("'%@' still has separate instances of equal dictionaries", string.string);
+            failures += 1;
+        }
+    }
+
+    mflog("%lu strings, %ld failures", (unsigned long)strings.count, (long)failures);
+    assert(failures == 0);
+
+    #undef mflog
+}
+
+void stringadditions_styleregistry_tests(void) {
+
+    /// Equal content -> one shared instance, different content -> separate instances (even with the same number of keys). Paragraph styles inside a dictionary are interned too.
+
+    #define mflog(msg...) NSLog(@"StringAdditions: StyleRegistryTests: " msg)
+
+    NSMutableParagraphStyle *style1 = [[NSMutableParagraphStyle alloc] init];
+    style1.paragraphSpacing = 4;
+    NSMutableParagraphStyle *style2 = style1.mutableCopy;
+    NSMutableParagraphStyle *style3 = style1.mutableCopy;
+    style3.paragraphSpacing = 8;
+
+    NSArray<NSArray *> *cases = @[ /// Dictionary, dictionary, should share
+        @[@{ NSForegroundColorAttributeName: NSColor.systemRedColor },  [@{ NSForegroundColorAttributeName: NSColor.systemRedColor } mutableCopy],   @YES],
+        @[@{ NSForegroundColorAttributeName: NSColor.systemRedColor },  @{ NSForegroundColorAttributeName: NSColor.systemBlueColor },              @NO],   /// Same count
+        @[@{ NSForegroundColorAttributeName: NSColor.systemRedColor },  @{ NSBaselineOffsetAttributeName: @(0) },                                  @NO],
+        @[@{ NSParagraphStyleAttributeName: style1 },                   @{ NSParagraphStyleAttributeName: style2 },                                @YES],
+        @[@{ NSParagraphStyleAttributeName: style1 },                   @{ NSParagraphStyleAttributeName: style3 },                                @NO],
+        @[@{},                                                          @{},                                                                        @YES],
+    ];
+
+    NSInteger failures = 0;
+    for (NSArray *c in cases) {
+        NSDictionary *first = internedAttributes(c[0]);
+        NSDictionary *second = internedAttributes(c[1]);
+        Boolean shared = first == second;
+        if (![first isEqual:c[0]] || ![second isEqual:c[1]] || shared != [c[2] boolValue]) {
+            mflog("%@ and %@: shared: %d, expected %@", c[0], c[1], shared, c[2]);
+            failures += 1;
+        }
+    }
+
+    /// Paragraph style inside
+    NSDictionary *withStyle = internedAttributes(@{ NSParagraphStyleAttributeName: style2, NSBaselineOffsetAttributeName: @(1) });
+    if (withStyle[NSParagraphStyleAttributeName] != internedParagraphStyle(style1)) {
+        mflog("Paragraph style inside the dictionary isn't the interned one");
+        failures += 1;
+    }
+
+    /// Mutating the argument afterwards
+    NSMutableDictionary *mutable = @{ NSForegroundColorAttributeName: NSColor.systemGreenColor }.mutableCopy;
+    NSDictionary *interned = internedAttributes(mutable);
+    mutable[NSForegroundColorAttributeName] = NSColor.systemPurpleColor;
+    if (![interned[NSForegroundColorAttributeName] isEqual:NSColor.systemGreenColor]) {
+        mflog("The registry kept the caller's mutable dictionary");
+        failures += 1;
+    }
+
+    /// Filled out labels share the base
+    NSMutableAttributedString *a = @"Label".attributed.mutableCopy;
+    NSMutableAttributedString *b = @"Other label".attributed.mutableCopy;
+    [a fillOutBase];
+    [b fillOutBase];
+    if ([a attributesAtIndex:0 effectiveRange:NULL] != [b attributesAtIndex:0 effectiveRange:NULL]) {
+        mflog("Filled out labels don't share their attributes");
+        failures += 1;
+    }
+
+    mflog("%lu cases, %ld failures", (unsigned long)cases.count, (long)failures);
+    assert(failures == 0);
+
+    #undef mflog
+}
+
+void stringadditions_addingbase_tests(void) {
+
+    /// `attributedStringByAddingStringAttributesAsBase:` vs the base overlaid with each run's own attributes.
+    ///     Runs with none, some or all of the base keys, an empty string and an empty base.
+
+    #define mflog(msg...) NSLog(@"StringAdditions: AddingBaseTests: " msg)
+
+    NSFont *boldFont = [NSFont boldSystemFontOfSize:NSFont.systemFontSize];
+    NSDictionary *base = fillOutBaseAttributes();
+
+    NSMutableAttributedString *mixed = [[NSMutableAttributedString alloc] init];
+    [mixed appendAttributedString:@"none ".attributed];
+    [mixed appendAttributedString:[[NSAttributedString alloc] initWithString:@"some " attributes:@{ NSForegroundColorAttributeName: NSColor.secondaryLabelColor }]];
+    [mixed appendAttributedString:[[NSAttributedString alloc] initWithString:@"font " attributes:@{ NSFontAttributeName: boldFont, NSLinkAttributeName: @"https://macmousefix.com" }]];
+    [mixed appendAttributedString:[[NSAttributedString alloc] initWithString:@"all" attributes:@{ NSFontAttributeName: boldFont, NSForegroundColorAttributeName: NSColor.linkColor, NSFontWeightTrait: @(NSFontWeightBold) }]];
+
+    NSArray<NSArray *> *cases = @[ /// String, base
+        @[@"".attributed,       base],
+        @[@"plain".attributed,  base],
+        @[mixed,                base],
+        @[mixed,                @{}],
+        @[mixed,                @{ NSParagraphStyleAttributeName: [[NSParagraphStyle alloc] init] }],
+    ];
+
+    NSInteger failures = 0;
+    for (NSArray *c in cases) {
+        NSAttributedString *string = c[0];
+        NSDictionary *baseAttributes = c[1];
+
+        NSMutableAttributedString *expected = string.mutableCopy;
+        [string enumerateAttributesInRange:NSMakeRange(0, string.length) options:0 usingBlock:^(NSDictionary<NSAttributedStringKey,id> * _Nonnull attrs, NSRange range, BOOL * _Nonnull stop) {
+            NSMutableDictionary *merged = baseAttributes.mutableCopy;
+            [merged addEntriesFromDictionary:attrs];
+            [expected setAttributes:merged range:range];
+        }];
+
+        NSAttributedString *result = [string attributedStringByAddingStringAttributesAsBase:baseAttributes];
+        if (![result isEqual:expected]) {
+            mflog("Mismatch for '%@' with base %@", string.string, baseAttributes);
+            failures += 1;
+        }
+    }
+
+    mflog("%lu cases, %ld failures", (unsigned long)cases.count, (long)failures);
+    assert(failures == 0);
+
+    #undef mflog
+}
+
+void stringadditions_setweight_tests(void) {
+
+    /// `setWeight:` + `setFontSize:` should give every run the font the helpers derive from that run's own font (or the default font if it has none).
+    ///     Neighbouring runs with different fonts check that the "same font as the last run" shortcut doesn't leak.
+
+    #define mflog(msg...) NSLog(@"StringAdditions: SetWeightTests: " msg)
+
+    NSFont *regular = [NSFont systemFontOfSize:NSFont.systemFontSize];
+    NSFont *bold = [NSFont boldSystemFontOfSize:NSFont.systemFontSize];
+    NSFont *small = [NSFont systemFontOfSize:NSFont.smallSystemFontSize];
+
+    NSAttributedString *(^runs)(NSArray *) = ^NSAttributedString *(NSArray *fonts) {
+        /// NSNull means no font
+        NSMutableAttributedString *s = [[NSMutableAttributedString alloc] init];
+        for (NSUInteger i = 0; i < fonts.count; i++) {
+            NSMutableDictionary *attributes = [NSMutableDictionary dictionaryWithObject:@(i) forKey:NSToolTipAttributeName]; /// Keeps the runs separate
+            if (fonts[i] != NSNull.null) attributes[NSFontAttributeName] = fonts[i];
+            [s appendAttributedString:[[NSAttributedString alloc] initWithString:@"word " attributes:attributes]];
+        }
+        return s;
+    };
+
+    NSArray<NSAttributedString *> *strings = @[
+        @"".attributed,
+        @"no font".attributed,
+        runs(@[regular, regular, bold, regular]),
+        runs(@[NSNull.null, small, NSNull.null, bold]),
+    ];
+
+    NSInteger failures = 0;
+    for (NSAttributedString *string in strings) {
+
+        NSMutableAttributedString *result = string.mutableCopy;
+        [result setWeight:7 forRange:NULL];
+        [result setFontSize:12];
+
+        for (NSUInteger i = 0; i < string.length; i++) {
+            NSFont *original = [string attribute:NSFontAttributeName atIndex:i effectiveRange:NULL] ?: regular;
+            NSFont *expected = fontBySettingSize(fontBySettingManagerWeight(original, 7), 12);
+            NSFont *actual = [result attribute:NSFontAttributeName atIndex:i effectiveRange:NULL];
+            if (![actual isEqual:expected]) {
+                mflog("'%@' at %lu: %@, expected %@", string.string, (unsigned long)i, actual, expected);
+                failures += 1;
+                break;
+            }
+        }
+    }
+
+    mflog("%lu strings, %ld failures", (unsigned long)strings.count, (long)failures);
+    assert(failures == 0);
+
+    #undef mflog
+}
+
+static NSAttributedString *attachmentString(NSImage *image) {
+    NSTextAttachment *attachment = [[NSTextAttachment alloc] init];
+    attachment.image = image;
+    return [NSAttributedString attributedStringWithAttachment:attachment];
+}
+
+void stringadditions_attachment_tests(void) {
+
+    /// Attachments are replaced by their description. Attachments without one (no image, or an image without an accessibility description) just go away.
+
+    #define mflog(msg...) NSLog(@"StringAdditions: AttachmentTests: " msg)
+
+    NSImage *mouse = [NSImage imageWithSystemSymbolName:@"computermouse" accessibilityDescription:@"Mouse"];
+    NSImage *undescribed = [[NSImage alloc] initWithSize:NSMakeSize(10, 10)];
+    NSString *longDescription = [@"" stringByPaddingToLength:100 withString:@"Long description " startingAtIndex:0];
+    NSImage *longDescribed = [[NSImage alloc] initWithSize:NSMakeSize(10, 10)];
+    longDescribed.accessibilityDescription = longDescription;
+
+    NSAttributedString *(^concat)(NSArray<NSAttributedString *> *) = ^NSAttributedString *(NSArray<NSAttributedString *> *parts) {
+        NSMutableAttributedString *s = [[NSMutableAttributedString alloc] init];
+        for (NSAttributedString *part in parts) [s appendAttributedString:part];
+        return s;
+    };
+
+    NSArray<NSArray *> *cases = @[ /// String, expected
+        @[@"".attributed,                                                               @""],
+        @[@"No attachments".attributed,                                                 @"No attachments"],
+        @[attachmentString(mouse),                                                      @"Mouse"],
+        @[concat(@[@"Click ".attributed, attachmentString(mouse), @" here".attributed]), @"Click Mouse here"],
+        @[concat(@[attachmentString(mouse), attachmentString(mouse)]),                  @"MouseMouse"],             /// Separate attachments next to each other
+        @[concat(@[@"a".attributed, attachmentString(undescribed), @"b".attributed]),   @"ab"],                     /// No accessibility description
+        @[attachmentString(nil),                                                        @""],                       /// No image
+        @[concat(@[@"x".attributed, attachmentString(longDescribed)]),                  [@"x" stringByAppendingString:longDescription]], /// Longer than the string, so the buffer has to grow
+    ];
+
+    NSInteger failures = 0;
+    for (NSArray *c in cases) {
+        NSString *result = [(NSAttributedString *)c[0] stringWithAttachmentDescriptions];
+        if (![result isEqual:c[1]]) {
+            mflog("Got '%@', expected '%@'", result, c[1]);
+            failures += 1;
+        }
+    }
+
+    mflog("%lu cases, %ld failures", (unsigned long)cases.count, (long)failures);
+    assert(failures == 0);
+
+    #undef mflog
+}
+
+void stringadditions_indent_tests(void) {
+
+    /// Every line gets the indent, including an empty line after a trailing linebreak. An indent of zero or less, or an empty indent character, leaves the string alone.
+
+    #define mflog(msg...) NSLog(@"StringAdditions: IndentTests: " msg)
+
+    NSArray<NSArray *> *indentCases = @[ /// String, indent, character, expected
+        @[@"",          @0,     @" ",   @""],
+        @[@"",          @-2,    @" ",   @""],
+        @[@"",          @2,     @" ",   @"  "],
+        @[@"a\nb",      @0,     @" ",   @"a\nb"],
+        @[@"a\nb",      @-1,    @" ",   @"a\nb"],
+        @[@"a\nb",      @2,     @" ",   @"  a\n  b"],
+        @[@"a\n",       @2,     @"\t",  @"\t\ta\n\t\t"],
+        @[@"\n\n",      @1,     @"-",   @"-\n-\n-"],
+        @[@"ä😀\nx",    @1,     @">",   @">ä😀\n>x"],
+        @[@"x",         @3,     @"ab",  @"abax"],       /// Multi-char indent characters are cut off at `indent`
+        @[@"x",         @2,     @"",    @"x"],
+    ];
+    NSArray<NSArray *> *prependCases = @[ /// String, count, character, expected
+        @[@"x",         @3,     @"ab",  @"abax"],
+        @[@"",          @2,     @"-",   @"--"],
+        @[@"x",         @0,     @"-",   @"x"],
+        @[@"x",         @-1,    @"-",   @"x"],
+        @[@"x",         @2,     @"",    @"x"],
+    ];
+
+    NSInteger failures = 0;
+    for (NSArray *c in indentCases) {
+        NSString *result = [c[0] stringByAddingIndent:[c[1] integerValue] withCharacter:c[2]];
+        if (![result isEqual:c[3]]) {
+            mflog("Indenting '%@' by %@ '%@' gave '%@', expected '%@'", c[0], c[1], c[2], result, c[3]);
+            failures += 1;
+        }
+    }
+    for (NSArray *c in prependCases) {
+        NSString *result = [c[0] stringByPrependingCharacter:c[2] count:[c[1] integerValue]];
+        if (![result isEqual:c[3]]) {
+            mflog("Prepending %@ '%@' to '%@' gave '%@', expected '%@'", c[1], c[2], c[0], result, c[3]);
+            failures += 1;
+        }
+    }
+
+    mflog("%lu cases, %ld failures", (unsigned long)(indentCases.count + prependCases.count), (long)failures);
+    assert(failures == 0);
+
+    #undef mflog
+}
+
+void stringadditions_regex_tests(void) {
+
+    /// `substringWithRegex:` on matches, non-matches and a pattern that doesn't compile. Then the cache: Hits, options as part of the key, invalid patterns not being cached, and starting over when it's full.
+
+    #define mflog(msg...) NSLog(@"StringAdditions: RegexTests: " msg)
+
+    NSString *versionPattern = @"[0-9]+(\\.[0-9]+)+";
+
+    NSArray<NSArray *> *cases = @[ /// String, pattern, expected (NSNull for nil)
+        @[@"Mac Mouse Fix 3.0.3 (22736)",   versionPattern,     @"3.0.3"],
+        @[@"2.2.5 Beta 4 and 3.0",          versionPattern,     @"2.2.5"],      /// First match
+        @[@"No version number in here",     versionPattern,     NSNull.null],
+        @[@"",                              versionPattern,     NSNull.null],
+        @[@"abc",                           @"(",               NSNull.null],   /// Doesn't compile
+    ];
+
+    NSInteger failures = 0;
+    for (NSArray *c in cases) {
+        id result = [c[0] substringWithRegex:c[1]] ?: NSNull.null;
+        if (![result isEqual:c[2]]) {
+            mflog("'%@' in '%@' gave '%@', expected '%@'", c[1], c[0], result, c[2]);
+            failures += 1;
+        }
+    }
+
+    /// Hits
+    clearRegexCache();
+    NSRegularExpression *first = cachedRegularExpression(versionPattern, 0);
+    NSRegularExpression *second = cachedRegularExpression(versionPattern, 0);
+    NSRegularExpression *caseInsensitive = cachedRegularExpression(versionPattern, NSRegularExpressionCaseInsensitive);
+    cachedRegularExpression(@"(", 0);
+    cachedRegularExpression(@"(", 0);
+    RegexCacheStatistics stats = regexCacheStatistics();
+    if (first != second || first == caseInsensitive) {
+        mflog("Same pattern and options should share an instance, different options shouldn't");
+        failures += 1;
+    }
+    if (stats.hits != 1 || stats.misses != 2 || stats.count != 2) {
+        mflog("Unexpected statistics: %lu hits, %lu misses, %lu patterns", (unsigned long)stats.hits, (unsigned long)stats.misses, (unsigned long)stats.count);
+        failures += 1;
+    }
+
+    /// Full
+    for (NSUInteger i = 0; i < 300; i++) {
+        NSString *pattern = stringf(@"x{%lu}", (unsigned long)i);
+        NSRegularExpression *expression = cachedRegularExpression(pattern, 0);
+        if (![expression.pattern isEqual:pattern]) {
+            mflog("Got the wrong expression for '%@' while filling the cache", pattern);
+            failures += 1;
+            break;
+        }
+    }
+    if (regexCacheStatistics().count > 256) {
+        mflog("The cache grew past its capacity");
+        failures += 1;
+    }
+
+    mflog("%lu cases, %ld failures", (unsigned long)cases.count, (long)failures);
+    assert(failures == 0);
+
+    #undef mflog
+}
+
+@end
@@ -0,0 +1,71 @@
+//
+// --------------------------------------------------------------------------
+// MarkdownParse.h
+// Created for Mac Mouse Fix (https://github.com/noah-nuebling/mac-mouse-fix)
+// Created by Noah Nuebling in 2026
+// Licensed under Licensed under the MMF License (https://github.com/noah-nuebling/mac-mouse-fix/blob/master/License)
+// --------------------------------------------------------------------------
+//
+
+/// The parse stage of `MarkdownParser`: markdown -> `MarkdownRenderOps`.
+///     Only needs Foundation and cmark – no AppKit. So it's part of the Foundation-only text core that we build on Linux. (See `libTextCore.a` in Tests/GNUmakefile.)
+///     Internal. Use `+[MarkdownParser renderOpsWithMarkdown:]`, which caches the result.
+
+#import <Foundation/Foundation.h>
+#import "MarkdownRenderOps.h"
+#import "cmark/branch-cjk/headers/src/cmark.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef struct MDBlockRecord {
+    
+    /// Where a top-level block (a direct child of the document node) ended up.
+    ///     `dst_start` is taken before we append the double linebreak that separates the block from its previous sibling. That way the dst ranges of all top-level blocks tile the whole dst string.
+    
+    cmark_node_type type;
+    NSUInteger dst_start;
+    NSUInteger dst_end;
+    int start_line;
+    int end_line;
+    
+} MDBlockRecord;
+
+/// If you pass in `mapSource`, we emit ops that map the text back to `src`. (Used for carrying over attributes from attributed markdown)
+/// If you pass in `outBlocks`, we record where each top-level block came from in `src` and where it ended up in the result. The caller has to `free()` the returned array. (Used by `MarkdownIncrementalParser`)
+MarkdownRenderOps *parseRenderOps(NSString *src, Boolean mapSource, MDBlockRecord *_Nullable *_Nullable outBlocks, size_t *_Nullable outBlockCount);
+
+/// Character buffer
+///     Reads a string in chunks with `-getCharacters:range:`, so a loop over all the characters doesn't send a message per character.
+///     Stand-in for `CFStringInlineBuffer`, since GNUstep's Foundation doesn't come with CoreFoundation.
+
+#define kMDCharacterBufferSize 256
+
+typedef struct {
+    __unsafe_unretained NSString *string;
+    NSUInteger length;
+    NSUInteger start;       /// Index in `string` of `chars[0]`
+    NSUInteger count;
+    unichar chars[kMDCharacterBufferSize];
+} MDCharacterBuffer;
+
+static inline void initCharacterBuffer(MDCharacterBuffer *buffer, NSString *string) {
+    buffer->string = string;
+    buffer->length = string.length;
+    buffer->start = 0;
+    buffer->count = 0;
+}
+
+static inline unichar characterFromBuffer(MDCharacterBuffer *buffer, NSUInteger index) {
+    /// `index` has to be less than the length of the string
+    if (index < buffer->start || index >= buffer->start + buffer->count) {
+        buffer->start = index;
+        buffer->count = MIN(kMDCharacterBufferSize, buffer->length - index);
+        [buffer->string getCharacters:buffer->chars range:NSMakeRange(index, buffer->count)];
+    }
+    return buffer->chars[index - buffer->start];
+}
+
+static inline Boolean isHighSurrogate(unichar c) { return c >= 0xD800 && c <= 0xDBFF; }
+static inline Boolean isLowSurrogate(unichar c)  { return c >= 0xDC00 && c <= 0xDFFF; }
+
+NS_ASSUME_NONNULL_END
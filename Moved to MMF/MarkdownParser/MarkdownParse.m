@@ -0,0 +1,761 @@
+//
+// --------------------------------------------------------------------------
+// MarkdownParse.m
+// Created for Mac Mouse Fix (https://github.com/noah-nuebling/mac-mouse-fix)
+// Created by Noah Nuebling in 2026
+// Licensed under Licensed under the MMF License (https://github.com/noah-nuebling/mac-mouse-fix/blob/master/License)
+// --------------------------------------------------------------------------
+//
+
+/// The styling stage (fonts, colors) is in MarkdownParser.m. Keep this file Foundation-only.
+
+#import "MarkdownParse.h"
+#import "NSString+Additions.h"
+
+///
+/// Walker state
+///
+
+/// Notes:
+/// - This holds all the state we need while walking the md tree. It lives on the stack of `parseRenderOps()` and we pass a pointer to it into `handleNode()` for every node event.
+/// - We used to capture this state as `__block` variables inside an `NSDictionary` of ~20 blocks (the `command_map`), which we rebuilt for every single node event – and then we boxed the `node_type` to look up the block. That was dozens of heap allocations per node. Now we just `switch` over the `node_type`.
+
+typedef struct {
+
+    /// Input
+    NSString *src;
+    Boolean mapSource;      /// Emit `MDRenderOpKindSourceText` ops, so attributes from attributed markdown can be carried over.
+
+    /// Output
+    ///     Note: This used to be an immutable `NSAttributedString` which we copied on every modification. Now we only build up the plain text and a list of ops. See `MarkdownRenderOps`.
+    NSMutableString *dst;
+    MDRenderOp *ops;
+    size_t op_count;
+    size_t op_capacity;
+    NSMutableArray<NSString *> *links;
+
+    /// Search range for src string
+    NSRange src_search_range;
+
+    /// Counter for md lists
+    ///     When we enter a nested list, we save the counter of the outer list on `list_index_stack` and restore it when we exit.
+    int md_list_index;
+    int *list_index_stack;
+    size_t list_depth;
+    size_t list_index_capacity;
+
+    /// Nesting depth of block quotes
+    int quote_depth;
+
+    /// Stack
+    ///     Stores the start index in `dst` of each node we're currently inside of.
+    ///     Note: Used to be an `NSMutableArray` of `NSDictionary`s.
+    NSUInteger *stack;
+    size_t stack_count;
+    size_t stack_capacity;
+
+    /// Source map
+    ///     Lets us map the cmark source positions of text nodes directly to UTF-16 ranges in `src`. Only used when `mapSource` is true. See `buildSourceMap()`.
+    const char *md;
+    size_t md_len;
+    size_t *line_starts;            /// Byte offset in `md` of the start of each line. (cmark lines are 1-based, this array is 0-based.)
+    size_t line_count;
+    uint32_t *utf16_index_of_byte;  /// UTF-16 index in `src` of the character containing each byte of `md`. Has `md_len + 1` entries.
+
+    /// Top-level block records
+    ///     Only used by `MarkdownIncrementalParser`. See `parseRenderOps()`.
+    Boolean record_blocks;
+    MDBlockRecord *blocks;
+    size_t block_count;
+    size_t block_capacity;
+
+} MDWalkState;
+
+static void stack_push(MDWalkState *st, NSUInteger value) {
+    if (st->stack_count == st->stack_capacity) {
+        st->stack_capacity = (st->stack_capacity == 0) ? 16 : st->stack_capacity * 2;
+        st->stack = realloc(st->stack, st->stack_capacity * sizeof(NSUInteger));
+    }
+    st->stack[st->stack_count] = value;
+    st->stack_count += 1;
+}
+
+static NSUInteger stack_pop(MDWalkState *st) {
+    assert(st->stack_count > 0);
+    st->stack_count -= 1;
+    return st->stack[st->stack_count];
+}
+
+static NSString *stringWithCmarkString(const char *_Nullable cstr) {
+    /// cmark hands out UTF-8. (`stringf(@"%s", ...)` would decode it in the system encoding.)
+    if (cstr == NULL) return @"";
+    return [NSString stringWithUTF8String:cstr] ?: @"";
+}
+
+static NSRange appendLiteral(MDWalkState *st, cmark_node *node, Boolean trimTrailingNewline) {
+    
+    /// Appends the literal of a leaf node verbatim and returns its range in `dst`.
+    
+    NSString *literal = stringWithCmarkString(cmark_node_get_literal(node));
+    if (trimTrailingNewline && [literal hasSuffix:@"\n"]) {
+        literal = [literal substringToIndex:literal.length - 1];
+    }
+    NSRange range = NSMakeRange(st->dst.length, literal.length);
+    [st->dst appendString:literal];
+    return range;
+}
+
+static void addOp(MDWalkState *st, MDRenderOpKind kind, NSRange range, NSUInteger argument) {
+    if (st->op_count == st->op_capacity) {
+        st->op_capacity = (st->op_capacity == 0) ? 16 : st->op_capacity * 2;
+        st->ops = realloc(st->ops, st->op_capacity * sizeof(MDRenderOp));
+    }
+    st->ops[st->op_count] = (MDRenderOp){
+        .location = (uint32_t)range.location,
+        .length = (uint32_t)range.length,
+        .argument = (uint32_t)argument,
+        .kind = kind,
+    };
+    st->op_count += 1;
+}
+
+///
+/// Helper functions
+///     To help with repetitve code for adding double linebreaks between block-elements.
+///     Note: These used to be macros. `cmark_node_get_type(NULL)` returns `CMARK_NODE_NONE`, so it's safe to pass in `cmark_node_previous()` of a first child.
+///
+
+static Boolean nodeIsBlockElement(cmark_node *node) {
+    cmark_node_type type = cmark_node_get_type(node);
+    return CMARK_NODE_FIRST_BLOCK <= type && type <= CMARK_NODE_LAST_BLOCK;
+}
+
+static Boolean nodeHasLeafType(cmark_node *node) {
+
+    /// Leaf node types as documented in the cmark headers.
+    ///     Note: The cmark iterator decides whether to send an exit event based on the node type, not based on whether the node actually has children. (E.g. an empty link `[](url)` gets enter and exit events.)
+    switch (cmark_node_get_type(node)) {
+        case CMARK_NODE_HTML_BLOCK:
+        case CMARK_NODE_THEMATIC_BREAK:
+        case CMARK_NODE_CODE_BLOCK:
+        case CMARK_NODE_TEXT:
+        case CMARK_NODE_SOFTBREAK:
+        case CMARK_NODE_LINEBREAK:
+        case CMARK_NODE_CODE:
+        case CMARK_NODE_HTML_INLINE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void addDoubleLinebreaksForBlockElementToDst(MDWalkState *st, cmark_node *node, Boolean did_enter) {
+    if (did_enter) {
+        Boolean is_block = nodeIsBlockElement(node);
+        Boolean previous_sibling_is_also_block = nodeIsBlockElement(cmark_node_previous(node));
+        if (is_block && previous_sibling_is_also_block) {
+            [st->dst appendString:@"\n\n"];
+            /// The node's start was pushed before the separator. Move it past the separator, so ops for the node (e.g. a heading's font) don't also cover the blank line before it.
+            if (!nodeHasLeafType(node)) {
+                assert(st->stack_count > 0);
+                st->stack[st->stack_count - 1] = st->dst.length;
+            }
+        }
+    }
+}
+
+///
+/// Source map
+///
+
+static void buildSourceMap(MDWalkState *st, const char *md, size_t md_len) {
+
+    /// Precomputes the tables that `srcRangeOfTextNode()` uses to map cmark source positions (line + byte column) to UTF-16 ranges in `src`.
+    ///     Both tables are built in a single pass, so this is O(n) – after that, locating a text node in `src` is O(1) (plus verifying the node's literal, which is proportional to its length).
+
+    st->md = md;
+    st->md_len = md_len;
+
+    /// Line starts
+    ///     Note: cmark treats `\n`, `\r` and `\r\n` as line endings.
+    size_t line_capacity = 64;
+    st->line_starts = malloc(line_capacity * sizeof(size_t));
+    st->line_starts[0] = 0;
+    st->line_count = 1;
+    for (size_t i = 0; i < md_len; i++) {
+        Boolean is_line_end = md[i] == '\n' || (md[i] == '\r' && (i + 1 >= md_len || md[i + 1] != '\n'));
+        if (!is_line_end) continue;
+        if (st->line_count == line_capacity) {
+            line_capacity *= 2;
+            st->line_starts = realloc(st->line_starts, line_capacity * sizeof(size_t));
+        }
+        st->line_starts[st->line_count] = i + 1;
+        st->line_count += 1;
+    }
+
+    /// Byte -> UTF-16 index table
+    ///     We derive the UTF-8 length of each character from the UTF-16 string, so we don't have to decode `md`.
+    NSUInteger str_len = st->src.length;
+    MDCharacterBuffer buffer;
+    initCharacterBuffer(&buffer, st->src);
+
+    st->utf16_index_of_byte = malloc((md_len + 1) * sizeof(uint32_t));
+    size_t byte_idx = 0;
+    for (NSUInteger i = 0; i < str_len; ) {
+
+        unichar c = characterFromBuffer(&buffer, i);
+
+        NSUInteger utf16_len = 1;
+        size_t utf8_len;
+        if (c < 0x80)           utf8_len = 1;
+        else if (c < 0x800)     utf8_len = 2;
+        else if (isHighSurrogate(c) && i + 1 < str_len && isLowSurrogate(characterFromBuffer(&buffer, i + 1))) {
+            utf8_len = 4;
+            utf16_len = 2;
+        }
+        else                    utf8_len = 3;
+
+        if (byte_idx + utf8_len > md_len) break; /// Validated below
+        for (size_t j = 0; j < utf8_len; j++) {
+            st->utf16_index_of_byte[byte_idx + j] = (uint32_t)i;
+        }
+        byte_idx += utf8_len;
+        i += utf16_len;
+    }
+
+    /// Validate
+    ///     If our UTF-8 lengths don't add up to the length of `md`, don't use the table. `srcRangeOfTextNode()` will then fall back to searching.
+    ///     This is expected for valid strings, too: We count a lone surrogate as 3 bytes, but the lossy encoding in `parseMarkdown()` substitutes something of a different length.
+    if (byte_idx != md_len) {
+        free(st->utf16_index_of_byte);
+        st->utf16_index_of_byte = NULL;
+        return;
+    }
+    st->utf16_index_of_byte[md_len] = (uint32_t)str_len;
+}
+
+static void freeSourceMap(MDWalkState *st) {
+    free(st->line_starts);
+    free(st->utf16_index_of_byte);
+    st->line_starts = NULL;
+    st->utf16_index_of_byte = NULL;
+}
+
+static NSRange srcRangeOfTextNode(MDWalkState *st, cmark_node *node, const char *literal) {
+
+    /// Returns the range of the text node in `src`, or `NSNotFound` if we can't map it directly.
+    ///     Notes:
+    ///     - cmark's source positions are 1-based lines and 1-based byte columns (Only available with `CMARK_OPT_SOURCEPOS`)
+    ///     - The literal of a text node doesn't always appear verbatim in the source (e.g. backslash escapes or entities like `&amp;`) and cmark's inline source positions aren't always accurate. So we verify that the source bytes match the literal before trusting the position.
+
+    if (st->utf16_index_of_byte == NULL) return NSMakeRange(NSNotFound, 0);
+
+    int line = cmark_node_get_start_line(node);
+    int column = cmark_node_get_start_column(node);
+    if (line < 1 || (size_t)line > st->line_count || column < 1) return NSMakeRange(NSNotFound, 0);
+
+    size_t literal_len = strlen(literal);
+    size_t byte_start = st->line_starts[line - 1] + (column - 1);
+    size_t byte_end = byte_start + literal_len;
+    if (byte_end > st->md_len) return NSMakeRange(NSNotFound, 0);
+    if (memcmp(st->md + byte_start, literal, literal_len) != 0) return NSMakeRange(NSNotFound, 0);
+
+    uint32_t utf16_start = st->utf16_index_of_byte[byte_start];
+    uint32_t utf16_end = st->utf16_index_of_byte[byte_end];
+    return NSMakeRange(utf16_start, utf16_end - utf16_start);
+}
+
+///
+/// Feeding cmark
+///
+
+/// Notes:
+/// - We used to get the UTF-8 via `cStringUsingEncoding:` + `strlen()`. That creates an autoreleased copy of the whole string on every call, scans it a second time, and silently truncates the input at embedded NUL characters.
+/// - Now we use the string's internal buffer if it's already UTF-8 compatible (`CFStringGetCStringPtr()`, only on Apple platforms). Otherwise we encode into a buffer that's reused across calls on the same thread. We always pass an explicit length.
+/// - For very large inputs where we don't need the UTF-8 afterwards (no source map), we encode chunk-by-chunk and stream the chunks into `cmark_parser_feed()`, so we never hold a full UTF-8 copy next to cmark's own copy.
+
+#define kMDStreamingThreshold           (1 << 20)   /// UTF-16 length above which we stream into cmark
+#define kMDStreamingChunkSize           (1 << 16)
+#define kMDMaxRetainedBufferCapacity    (1 << 20)   /// Don't hold on to bigger buffers between calls
+
+static _Thread_local char *_utf8Buffer = NULL;
+static _Thread_local size_t _utf8BufferCapacity = 0;
+
+static char *utf8Buffer(size_t capacity) {
+    if (_utf8BufferCapacity < capacity) {
+        free(_utf8Buffer);
+        _utf8Buffer = malloc(capacity);
+        _utf8BufferCapacity = capacity;
+    }
+    return _utf8Buffer;
+}
+
+static void trimUTF8Buffer(void) {
+    if (_utf8BufferCapacity > kMDMaxRetainedBufferCapacity) {
+        free(_utf8Buffer);
+        _utf8Buffer = NULL;
+        _utf8BufferCapacity = 0;
+    }
+}
+
+static cmark_node *parseMarkdown(NSString *string, int options, Boolean needsBytes, const char *_Nullable *_Nonnull outMd, size_t *outMdLen) {
+    
+    /// Parses `string` with cmark.
+    ///     If `needsBytes` is true, `outMd` will point to the UTF-8 that was parsed. It stays valid until `trimUTF8Buffer()` or the next call to `parseMarkdown()` on the same thread. (Or as long as `string` lives, in case we used its internal buffer.)
+    
+    *outMd = NULL;
+    *outMdLen = 0;
+    
+    NSUInteger str_len = string.length;
+    
+    /// Fast path: Use the internal buffer
+    ///     CF only hands out its internal buffer for UTF-8 if the contents are ASCII. So the byte length is the UTF-16 length.
+    ///     Apple's Foundation brings CoreFoundation along. GNUstep's doesn't, so there we always encode.
+    #ifdef __APPLE__
+    const char *ptr = CFStringGetCStringPtr((__bridge CFStringRef)string, kCFStringEncodingUTF8);
+    if (ptr != NULL) {
+        *outMd = ptr;
+        *outMdLen = str_len;
+        return cmark_parse_document(ptr, str_len, options);
+    }
+    #endif
+    
+    /// Stream
+    if (!needsBytes && str_len > kMDStreamingThreshold) {
+        
+        char *chunk = utf8Buffer(kMDStreamingChunkSize);
+        cmark_parser *parser = cmark_parser_new(options);
+        
+        NSRange remaining = NSMakeRange(0, str_len);
+        while (remaining.length > 0) {
+            NSUInteger used_len = 0;
+            BOOL success = [string getBytes:chunk maxLength:kMDStreamingChunkSize usedLength:&used_len encoding:NSUTF8StringEncoding options:NSStringEncodingConversionAllowLossy range:remaining remainingRange:&remaining]; /// Only converts whole characters, so chunks never split a UTF-8 sequence.
+            if (!success || used_len == 0) { assert(false); break; }
+            cmark_parser_feed(parser, chunk, used_len);
+        }
+        
+        cmark_node *root = cmark_parser_finish(parser);
+        cmark_parser_free(parser);
+        return root;
+    }
+    
+    /// Encode into the reusable buffer
+    NSUInteger max_len = [string maximumLengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    char *buffer = utf8Buffer(max_len + 1);
+    NSUInteger used_len = 0;
+    [string getBytes:buffer maxLength:max_len usedLength:&used_len encoding:NSUTF8StringEncoding options:NSStringEncodingConversionAllowLossy range:NSMakeRange(0, str_len) remainingRange:NULL];
+    buffer[used_len] = '\0';
+    
+    *outMd = buffer;
+    *outMdLen = used_len;
+    return cmark_parse_document(buffer, used_len, options);
+}
+
+///
+/// Main
+///
+
+static void handleNode(MDWalkState *st, cmark_node *node, cmark_event_type ev_type);
+
+MarkdownRenderOps *parseRenderOps(NSString *src, Boolean mapSource, MDBlockRecord *_Nullable *_Nullable outBlocks, size_t *_Nullable outBlockCount) {
+
+    /// Parse stage. Foundation-only, so this can run on any thread. See `MarkdownRenderOps`.
+    ///     If you pass in `mapSource`, we emit ops that map the text back to `src`. (Used for carrying over attributes from attributed markdown)
+    ///     If you pass in `outBlocks`, we record where each top-level block came from in `src` and where it ended up in the result. The caller has to `free()` the returned array.
+
+    /// Irrelevant sidenote:
+    /// - I started writing this using c-style variable names with lots of 'mnemonic' abbreviations and underscores - since that's what the cmark libary uses and I thought it was interesting to try.
+    ///     But then we ended up also using lots of Cocoa APIs and all the naming got mixed up.
+
+    /// Get markdown node iterator
+    int md_options = CMARK_OPT_HARDBREAKS;   /// Don't swallow single linebreaks. Not totally sure what this does.
+    if (mapSource || outBlocks != NULL) {
+        md_options |= CMARK_OPT_SOURCEPOS;   /// So we can map text nodes and blocks back to `src` in O(1). See `srcRangeOfTextNode()`.
+    }
+    const char *md;
+    size_t md_len;
+    cmark_node *root = parseMarkdown(src, md_options, mapSource, &md, &md_len);
+    cmark_iter *iter = cmark_iter_new(root);
+
+    /// Create walker state
+    MDWalkState st = {
+        .src = src,
+        .mapSource = mapSource,
+        .dst = [NSMutableString string],
+        .ops = NULL,
+        .op_count = 0,
+        .op_capacity = 0,
+        .links = [NSMutableArray array],
+        .src_search_range = NSMakeRange(0, src.length),
+        .md_list_index = -1,
+        .stack = NULL,
+        .stack_count = 0,
+        .stack_capacity = 0,
+        .record_blocks = outBlocks != NULL,
+    };
+    
+    /// Build source map
+    if (mapSource) {
+        buildSourceMap(&st, md, md_len);
+    }
+
+    /// Walk the md tree
+    while (true) {
+
+        /// Increment iter
+        cmark_event_type ev_type = cmark_iter_next(iter);
+
+        /// Process none event (assert false)
+        if (ev_type == CMARK_EVENT_NONE) assert(false);
+
+        /// Process done event (break loop)
+        if (ev_type == CMARK_EVENT_DONE) break;
+
+        /// Handle node
+        handleNode(&st, cmark_iter_get_node(iter), ev_type);
+
+    } /// End iterating nodes
+
+    /// Validate
+    assert(st.stack_count == 0);
+
+    /// Free iterator & and tree & stacks & source map
+    cmark_iter_free(iter);
+    cmark_node_free(root);
+    free(st.stack);
+    free(st.list_index_stack);
+    freeSourceMap(&st);
+    trimUTF8Buffer();
+    
+    /// Hand over block records
+    if (outBlocks != NULL) {
+        *outBlocks = st.blocks;
+        *outBlockCount = st.block_count;
+    }
+
+    /// Return ops
+    MarkdownRenderOps *result = [[MarkdownRenderOps alloc] initWithText:st.dst ops:st.ops count:st.op_count links:st.links];
+    free(st.ops);
+    return result;
+}
+
+static void handleNode(MDWalkState *st, cmark_node *node, cmark_event_type ev_type) {
+
+    /// Process enter / exit events
+    Boolean did_enter = ev_type == CMARK_EVENT_ENTER; /// Entered node
+    Boolean did_exit = ev_type == CMARK_EVENT_EXIT;
+    assert(did_enter || did_exit);
+
+    /// Get info from node
+    cmark_node_type node_type = cmark_node_get_type(node);
+    Boolean is_leaf = nodeHasLeafType(node);
+
+    /// Valdiate info from node
+
+#if DEBUG
+    if (cmark_node_get_literal(node) != NULL) {
+        assert(is_leaf); /// I think only leaf nodes can contain text. That would simplify our control flow
+    }
+#endif
+
+    /// Record top-level blocks
+    ///     See `MDBlockRecord`.
+    Boolean is_top_level = st->record_blocks && cmark_node_get_type(cmark_node_parent(node)) == CMARK_NODE_DOCUMENT;
+    if (is_top_level && did_enter) {
+        if (st->block_count == st->block_capacity) {
+            st->block_capacity = (st->block_capacity == 0) ? 16 : st->block_capacity * 2;
+            st->blocks = realloc(st->blocks, st->block_capacity * sizeof(MDBlockRecord));
+        }
+        st->blocks[st->block_count] = (MDBlockRecord){
+            .type = node_type,
+            .dst_start = st->dst.length,
+            .dst_end = st->dst.length,
+            .start_line = cmark_node_get_start_line(node),
+            .end_line = cmark_node_get_end_line(node),
+        };
+        st->block_count += 1;
+    }
+
+    /// Use stack to track node enter and exit
+
+    NSRange rangeOfExitedNodeInDst = NSMakeRange(NSNotFound, 0);
+
+    if (!is_leaf && did_enter) {
+        /// Stack push
+        stack_push(st, st->dst.length);
+    } else if (did_exit) {
+        /// Stack pop
+        NSInteger node_start_idx = stack_pop(st);
+        /// Locate the exited node in the dst string.
+        NSInteger node_end_idx = st->dst.length - 1;
+        rangeOfExitedNodeInDst = NSMakeRange(node_start_idx, node_end_idx - node_start_idx + 1);
+    }
+
+    /// Handle all types of nodes
+    ///     Notes:
+    ///     - Leaf nodes are marked with 🍁. They only have enter events, no exit events.
+
+    switch (node_type) {
+
+        case CMARK_NODE_NONE: {
+
+            assert(false); /// Something went wrong
+
+        } break;
+        case CMARK_NODE_DOCUMENT: {         /// == `CMARK_NODE_FIRST_BLOCK`
+
+            /// Root node
+
+        } break;
+        case CMARK_NODE_BLOCK_QUOTE: {
+
+            addDoubleLinebreaksForBlockElementToDst(st, node, did_enter);
+
+            if (did_enter) {
+                st->quote_depth += 1;
+            } else {
+                addOp(st, MDRenderOpKindBlockQuote, rangeOfExitedNodeInDst, st->quote_depth);
+                st->quote_depth -= 1;
+            }
+
+        } break;
+        case CMARK_NODE_LIST: {
+
+            addDoubleLinebreaksForBlockElementToDst(st, node, did_enter);
+
+            if (did_enter) {
+
+                /// Save counter of outer list
+                if (st->list_depth == st->list_index_capacity) {
+                    st->list_index_capacity = (st->list_index_capacity == 0) ? 8 : st->list_index_capacity * 2;
+                    st->list_index_stack = realloc(st->list_index_stack, st->list_index_capacity * sizeof(int));
+                }
+                st->list_index_stack[st->list_depth] = st->md_list_index;
+                st->list_depth += 1;
+
+                /// Initialize list item counter
+                st->md_list_index = cmark_node_get_list_start(node);
+            } else {
+
+                /// Restore counter of outer list
+                st->list_depth -= 1;
+                st->md_list_index = st->list_index_stack[st->list_depth];
+            }
+
+        } break;
+        case CMARK_NODE_ITEM: {
+
+            /// Note: Even though list items are blockElements, they don't have double linebreaks between them, so we don't use addDoubleLinebreaksForBlockElementToDst()
+
+            if (did_enter) {
+
+                /// Get parent node of item (the list node)
+                cmark_node *list_node = cmark_node_parent(node);
+
+                /// Validate
+                assert(cmark_node_get_type(list_node) == CMARK_NODE_LIST);
+
+                /// Get list tightness
+                ///     A markdown list can become non-tight when there are empty lines between the item lines.
+                Boolean is_tight = cmark_node_get_list_tight(list_node);
+
+                /// Check if this is the first `list_item`
+                Boolean is_first_item = st->md_list_index == cmark_node_get_list_start(list_node);
+
+                /// Get list prefix string
+                NSString *prefix;
+                cmark_list_type list_type = cmark_node_get_list_type(list_node);
+                if (list_type == CMARK_BULLET_LIST) {
+                    prefix = @"• ";
+                } else if (list_type == CMARK_ORDERED_LIST)  {
+                    if (cmark_node_get_list_delim(list_node) == CMARK_PAREN_DELIM) {
+                        prefix = stringf(@"%d) ", st->md_list_index);
+                    } else if (cmark_node_get_list_delim(list_node) == CMARK_PERIOD_DELIM) {
+                        prefix = stringf(@"%d. ", st->md_list_index);
+                    } else {
+                        assert(false);
+                    }
+                } else {
+                    assert(false);
+                }
+
+                /// Append newline
+                if (!is_first_item) {
+                    if (is_tight || !is_tight) { /// Turning off non-tight lists (which have a whole free line between items) bc I don't like them and accidentally produce them sometimes.
+                        [st->dst appendString:@"\n"];
+                    }
+                }
+
+                /// Append list-item-prefix to dst
+                ///     Note: The next nodes we'll iterate over will be the child nodes of this item node.
+                [st->dst appendString:prefix];
+
+                /// Advance list counter
+                st->md_list_index += 1;
+            }
+
+        } break;
+        case CMARK_NODE_CODE_BLOCK: {       /// 🍁
+
+            assert(did_enter); /// Leaf node
+            addDoubleLinebreaksForBlockElementToDst(st, node, did_enter);
+            NSRange range = appendLiteral(st, node, true);
+            addOp(st, MDRenderOpKindCodeBlock, range, 0);
+
+        } break;
+        case CMARK_NODE_HTML_BLOCK: {       /// 🍁
+
+            /// We don't interpret HTML. Just show it as-is.
+            assert(did_enter); /// Leaf node
+            addDoubleLinebreaksForBlockElementToDst(st, node, did_enter);
+            appendLiteral(st, node, true);
+
+        } break;
+        case CMARK_NODE_CUSTOM_BLOCK: {
+
+            /// Only created through the cmark API, never by the parser. We just render the children.
+            addDoubleLinebreaksForBlockElementToDst(st, node, did_enter);
+
+        } break;
+        case CMARK_NODE_PARAGRAPH: {
+
+            addDoubleLinebreaksForBlockElementToDst(st, node, did_enter);
+
+            /// Note: Why the isTopLevel restriction?
+            ///     Update: every list item seems to contain its own paragraph, they are all last paragraphs through, so the `is_top_level` check doesn't seem necessary.
+
+        } break;
+        case CMARK_NODE_HEADING: {
+
+            addDoubleLinebreaksForBlockElementToDst(st, node, did_enter);
+
+            if (did_exit) {
+                addOp(st, MDRenderOpKindHeading, rangeOfExitedNodeInDst, cmark_node_get_heading_level(node));
+            }
+
+        } break;
+        case CMARK_NODE_THEMATIC_BREAK: {   /// == `CMARK_NODE_LAST_BLOCK` || 🍁 || "thematic break" is the horizontal line aka hrule
+
+            assert(did_enter); /// Leaf node
+            addDoubleLinebreaksForBlockElementToDst(st, node, did_enter);
+            NSRange range = NSMakeRange(st->dst.length, 3);
+            [st->dst appendString:@"———"];
+            addOp(st, MDRenderOpKindThematicBreak, range, 0);
+
+        } break;
+        case CMARK_NODE_TEXT: {             /// == `CMARK_NODE_FIRST_INLINE` || 🍁
+
+            assert(did_enter); /// Leaf node
+
+            const char *node_literal = cmark_node_get_literal(node) ?: "";
+            NSString *node_text = stringWithCmarkString(node_literal);
+
+            if (st->mapSource) {
+                /// Find the range of src which contains the same text as `node_text`
+                ///     By recording where the text came from in src, the styling stage can carry over the string attributes from src into dst. (See `MDRenderOpKindSourceText`)
+                ///     We map the node's source position directly to its range in src. Only if that doesn't work, we fall back to searching for the text.
+                NSRange src_range = srcRangeOfTextNode(st, node, node_literal);
+                if (src_range.location == NSNotFound) {
+                    src_range = [st->src rangeOfString:node_text options:0 range:st->src_search_range];
+                }
+                if (src_range.location != NSNotFound) {
+                    /// `rangeOfString:` also matches canonically equivalent text (e.g. precomposed vs. decomposed "é"), which can have a different length. The op maps character by character, so we skip it then.
+                    if (src_range.length == node_text.length) {
+                        addOp(st, MDRenderOpKindSourceText, NSMakeRange(st->dst.length, node_text.length), src_range.location);
+                    }
+                    /// Remove the processed range from the search range
+                    ///     End of the search range should always be the end of the src string
+                    NSInteger new_search_range_start = src_range.location + src_range.length;
+                    st->src_search_range = NSMakeRange(new_search_range_start, st->src.length - new_search_range_start);
+                }
+                /// Note: If we can't find the text in src, we just don't carry over attributes for it.
+            }
+            [st->dst appendString:node_text];
+
+        } break;
+        case CMARK_NODE_SOFTBREAK: {        /// 🍁
+
+            assert(did_enter); /// Leaf node
+            [st->dst appendString:@"\n"];
+
+        } break;
+        case CMARK_NODE_LINEBREAK: {        /// 🍁
+
+            /// Notes:
+            /// - I've never seen this be called. `\n\n` will start a new paragraph, not insert a 'linebreak'.
+            /// - That's because even a siingle newline char starts a new paragraph (at least for NSParagraphStyle). We should be using the "Unicode Line Separator" for simple linebreaks in UI text.
+            ///   - See: https://stackoverflow.com/questions/4404286/how-is-a-paragraph-defined-in-an-nsattributedstring
+
+            assert(did_enter); /// Leaf node
+            [st->dst appendString:@"\n"];
+
+        } break;
+        case CMARK_NODE_CODE: {             /// 🍁
+
+            assert(did_enter); /// Leaf node
+            NSRange range = appendLiteral(st, node, false);
+            addOp(st, MDRenderOpKindCode, range, 0);
+
+        } break;
+        case CMARK_NODE_HTML_INLINE: {      /// 🍁
+
+            /// We don't interpret HTML. Just show it as-is – except for `<br>`, which localizers sometimes use for linebreaks.
+            assert(did_enter); /// Leaf node
+            const char *html = cmark_node_get_literal(node) ?: "";
+            if (strcasecmp(html, "<br>") == 0 || strcasecmp(html, "<br/>") == 0 || strcasecmp(html, "<br />") == 0) {
+                [st->dst appendString:@"\n"];
+            } else {
+                appendLiteral(st, node, false);
+            }
+
+        } break;
+        case CMARK_NODE_CUSTOM_INLINE: {
+
+            /// Only created through the cmark API, never by the parser. We just render the children.
+
+        } break;
+        case CMARK_NODE_EMPH: {
+
+            /// Note: The styling is up to the `MarkdownStyleSheet`. (By default, emphasis is semibold, not italic. See `-[MarkdownStyleSheet init]`)
+            if (did_exit) {
+                addOp(st, MDRenderOpKindEmphasis, rangeOfExitedNodeInDst, 0);
+            }
+
+        } break;
+        case CMARK_NODE_STRONG: {
+
+            if (did_exit) {
+                addOp(st, MDRenderOpKindStrong, rangeOfExitedNodeInDst, 0);
+            }
+
+        } break;
+        case CMARK_NODE_LINK: {
+
+            if (did_exit) {
+                [st->links addObject:stringWithCmarkString(cmark_node_get_url(node))];
+                addOp(st, MDRenderOpKindLink, rangeOfExitedNodeInDst, st->links.count - 1);
+            }
+
+        } break;
+        case CMARK_NODE_IMAGE: {            /// == `CMARK_NODE_LAST_INLINE`
+
+            /// We can't show images in UI text. We show the alt text (the children) and link it to the image.
+            if (did_exit) {
+                [st->links addObject:stringWithCmarkString(cmark_node_get_url(node))];
+                addOp(st, MDRenderOpKindImage, rangeOfExitedNodeInDst, st->links.count - 1);
+            }
+
+        } break;
+        default: {
+
+            NSLog(@"Error: Unknown node_type: %s", cmark_node_get_type_string(node));
+            assert(false);
+
+        } break;
+    }
+    
+    /// Record top-level blocks
+    if (is_top_level && (did_exit || is_leaf)) {
+        st->blocks[st->block_count - 1].dst_end = st->dst.length;
+    }
+}
@@ -8,14 +8,69 @@
 //
 
 #import <Foundation/Foundation.h>
+#import "MarkdownRenderOps.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
+@class NSTextStorage;
+
+@interface MarkdownStyleSheet : NSObject <NSCopying>
+
+/// Controls how `MarkdownRenderOps` are turned into an `NSAttributedString`.
+
+@property (class, nonatomic, readonly) MarkdownStyleSheet *defaultStyleSheet;
+
+@property (nonatomic) CGFloat emphasisWeight;   /// `NSFontWeight` for `*emphasis*`. Defaults to semibold.
+@property (nonatomic) CGFloat strongWeight;     /// `NSFontWeight` for `**strong**`. Defaults to bold.
+@property (nonatomic) CGFloat headingWeight;    /// `NSFontWeight` for `# headings`. Defaults to bold. (The size is scaled by the heading level.)
+@property (nonatomic) CGFloat blockQuoteIndent; /// Indent per level of `> block quote` nesting, in points. Defaults to 12.
+@property (nonatomic, copy, nullable) NSDictionary<NSAttributedStringKey, id> *baseAttributes; /// Added with `attributedStringByAddingStringAttributesAsBase:` at the end.
+
+@end
+
+typedef struct {
+    NSUInteger hits;
+    NSUInteger misses;
+    NSUInteger evictions;
+    NSUInteger count;
+} MarkdownParserCacheStatistics;
+
 @interface MarkdownParser : NSObject
 
 + (NSAttributedString *)attributedStringWithMarkdown:(NSString *)markdown;
++ (NSAttributedString *)attributedStringWithMarkdown:(NSString *)markdown baseAttributes:(NSDictionary<NSAttributedStringKey, id> *_Nullable)baseAttributes; /// Same as adding `baseAttributes` with `attributedStringByAddingStringAttributesAsBase:` afterwards, but the whole thing is cached.
 + (NSAttributedString *)attributedStringWithAttributedMarkdown:(NSAttributedString *)attributedMarkdown;
 
+/// Batch rendering
+///     Same results as calling `attributedStringWithMarkdown:` for each string, but parses the strings concurrently. Fonts are resolved on the calling thread at the end.
+///     Use this when rendering lots of strings at once, e.g. a whole localization catalog at launch.
++ (NSArray<NSAttributedString *> *)attributedStringsWithMarkdownStrings:(NSArray<NSString *> *)markdownStrings;
++ (NSArray<NSAttributedString *> *)attributedStringsWithMarkdownStrings:(NSArray<NSString *> *)markdownStrings baseAttributes:(NSDictionary<NSAttributedStringKey, id> *_Nullable)baseAttributes;
+
+/// Parse once, style many
+///     `attributedStringWithMarkdown:` is the same as `attributedStringWithRenderOps:styleSheet:` with the default style sheet.
++ (MarkdownRenderOps *)renderOpsWithMarkdown:(NSString *)markdown;
++ (NSAttributedString *)attributedStringWithRenderOps:(MarkdownRenderOps *)ops styleSheet:(MarkdownStyleSheet *)styleSheet;
+
+/// Cache
+///     `attributedStringWithMarkdown:` results are kept in an LRU cache. The returned strings are immutable and shared, so don't cast them to mutable.
++ (MarkdownParserCacheStatistics)cacheStatistics;
++ (void)clearCache;
+
+@end
+
+@interface MarkdownIncrementalParser : NSObject
+
+/// Keeps `textStorage` in sync with a markdown source that is being edited.
+///     After an edit, we only re-parse the top-level blocks (paragraphs, lists, ...) around the edited range and splice them into `textStorage`. So the cost of a keystroke doesn't grow with the size of the document.
+///     The result is the same as `+[MarkdownParser attributedStringWithMarkdown:]` on the whole source.
+
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithTextStorage:(NSTextStorage *)textStorage;
+
+@property (nonatomic, copy) NSString *markdown; /// Setting this does a full parse
+- (void)updateMarkdown:(NSString *)markdown editedRange:(NSRange)editedRange changeInLength:(NSInteger)delta; /// Same parameters as `-[NSTextStorageDelegate textStorage:didProcessEditing:range:changeInLength:]`
+
 @end
 
 NS_ASSUME_NONNULL_END
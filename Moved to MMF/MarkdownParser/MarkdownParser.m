@@ -8,362 +8,802 @@
 //
 
 #import "MarkdownParser.h"
-#import "AppDelegate.h"
+#import "MarkdownRenderOps.h"
+#import "MarkdownParse.h"
 #import <AppKit/AppKit.h>
 #import "cmark/branch-cjk/headers/src/cmark.h"
 #import "NSString+Additions.h"
 #import "NSAttributedString+Additions.h"
 
-@implementation MarkdownParser
+///
+/// Cache
+///
 
-+ (NSAttributedString *)attributedStringWithMarkdown:(NSString *)src {
-    return attributedStringWithMarkdown(src.attributed, false);
+/// Notes:
+/// - UI code renders the same localized strings over and over as views reload. So we keep the most recently used results around.
+/// - There are two caches:
+///     - The render ops cache maps markdown -> `MarkdownRenderOps`. So if the same string is rendered with different style sheets, we only parse it once.
+///     - The result cache maps markdown + base attributes -> the final `NSAttributedString`. That's what `attributedStringWithMarkdown:` hits when views reload.
+/// - The cached values are immutable and shared between all callers.
+/// - We only cache plain-string input. `attributedStringWithAttributedMarkdown:` carries over the attributes of its input, so we'd have to compare those on every lookup.
+
+#define kMDCacheCapacity 256
+
+static NSAttributedString *styleRenderOps(MarkdownRenderOps *ops, NSAttributedString *_Nullable src, MarkdownStyleSheet *styleSheet);
+
+@interface MDCacheKey : NSObject <NSCopying>
+@end
+@implementation MDCacheKey {
+    @public
+    NSString *_markdown;
+    NSDictionary *_baseAttributes;
+    NSUInteger _hash;
 }
-+ (NSAttributedString *)attributedStringWithAttributedMarkdown:(NSAttributedString *)src {
-    return attributedStringWithMarkdown(src, true);
+- (instancetype)initWithMarkdown:(NSString *)markdown baseAttributes:(NSDictionary *_Nullable)baseAttributes {
+    self = [super init];
+    if (self) {
+        _markdown = markdown.copy;
+        _baseAttributes = baseAttributes.copy;
+        _hash = _markdown.hash ^ (dictionaryContentHash(_baseAttributes) * 31);
+    }
+    return self;
 }
+- (id)copyWithZone:(NSZone *)zone {
+    return self; /// Immutable
+}
+- (NSUInteger)hash {
+    return _hash;
+}
+- (BOOL)isEqual:(id)object {
+    if (self == object) return YES;
+    if (![object isKindOfClass:[MDCacheKey class]]) return NO;
+    MDCacheKey *other = object;
+    if (_hash != other->_hash) return NO;
+    if (![_markdown isEqualToString:other->_markdown]) return NO;
+    if (_baseAttributes != other->_baseAttributes && ![_baseAttributes isEqualToDictionary:other->_baseAttributes]) return NO;
+    return YES;
+}
+@end
 
-static NSAttributedString *attributedStringWithMarkdown(NSAttributedString *src, Boolean keepExistingAttributes) {
-    
-    /// Irrelevant sidenote:
-    /// - I started writing this using c-style variable names with lots of 'mnemonic' abbreviations and underscores - since that's what the cmark libary uses and I thought it was interesting to try.
-    ///     But then we ended up also using lots of Cocoa APIs and all the naming got mixed up.
-    
-    /// Get markdown node iterator
-    const char *md = [src.string cStringUsingEncoding:NSUTF8StringEncoding];
-    int md_options = CMARK_OPT_HARDBREAKS;   /// Don't swallow single linebreaks. Not totally sure what this does.
-    cmark_node *root = cmark_parse_document(md, strlen(md), md_options);
-    cmark_iter *iter = cmark_iter_new(root);
-    
-    ///  Create stack
-    ///     Array of dicts that stores state of the nodes we're currently inside of.
-    NSMutableArray<NSDictionary *> *stack = [NSMutableArray array];
+@interface MDCacheEntry : NSObject
+@end
+@implementation MDCacheEntry {
+    @public
+    MDCacheKey *_key;
+    id _value;
+    MDCacheEntry *_next;                        /// Towards least recently used
+    __unsafe_unretained MDCacheEntry *_prev;    /// Towards most recently used
+}
+@end
+
+@interface MDLRUCache : NSObject
+@end
+@implementation MDLRUCache {
     
-    /// Create/init search range for src string
-    __block NSRange src_search_range = NSMakeRange(0, src.length);
+    /// Dictionary for lookup + doubly linked list for recency. All access is `@synchronized (self)`.
     
-    /// Create counter for md lists
-    __block int md_list_index = -1;
+    @public
+    NSMutableDictionary<MDCacheKey *, MDCacheEntry *> *_entries;
+    MDCacheEntry *_head;                            /// Most recently used
+    __unsafe_unretained MDCacheEntry *_tail;        /// Least recently used
+    MarkdownParserCacheStatistics _stats;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _entries = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+static void cacheUnlink(MDLRUCache *cache, MDCacheEntry *entry) {
+    if (entry->_prev) entry->_prev->_next = entry->_next;
+    else              cache->_head = entry->_next;
+    if (entry->_next) entry->_next->_prev = entry->_prev;
+    else              cache->_tail = entry->_prev;
+    entry->_next = nil;
+    entry->_prev = nil;
+}
+
+static void cachePushFront(MDLRUCache *cache, MDCacheEntry *entry) {
+    entry->_next = cache->_head;
+    entry->_prev = nil;
+    if (cache->_head) cache->_head->_prev = entry;
+    cache->_head = entry;
+    if (!cache->_tail) cache->_tail = entry;
+}
+
+- (id _Nullable)objectForKey:(MDCacheKey *)key {
+    @synchronized (self) {
+        MDCacheEntry *entry = _entries[key];
+        if (entry != nil) {
+            _stats.hits += 1;
+            cacheUnlink(self, entry);
+            cachePushFront(self, entry);
+            return entry->_value;
+        }
+        _stats.misses += 1;
+        return nil;
+    }
+}
+
+- (void)setObject:(id)value forKey:(MDCacheKey *)key {
     
-    /// Declare result
-    ///     Note: We're modifying this as we walk the markdown tree so should be mutable but all our custom`NSAttributedString` apis don't work on mutable strings, so we're making it immutable and copying it on every modification.
-    __block NSAttributedString *dst = [[NSMutableAttributedString alloc] init];
+    /// If two threads render the same string at once, the second one just replaces the first one's entry.
     
-    /// Walk the md tree
-    while (true) {
+    @synchronized (self) {
         
-        /// Increment iter
-        cmark_iter_next(iter);
-        
-        /// Get info from iter
-        cmark_event_type ev_type = cmark_iter_get_event_type(iter);
-        cmark_node *node = cmark_iter_get_node(iter);
-        
-        /// Process none event (assert false)
-        if (ev_type == CMARK_EVENT_NONE) assert(false);
-        
-        /// Process done event (break loop)
-        if (ev_type == CMARK_EVENT_DONE) break;
+        MDCacheEntry *existing = _entries[key];
+        if (existing != nil) {
+            cacheUnlink(self, existing);
+            [_entries removeObjectForKey:key];
+        }
         
-        /// Process enter / exit events
-        Boolean did_enter = ev_type == CMARK_EVENT_ENTER; /// Entered node
-        Boolean did_exit = ev_type == CMARK_EVENT_EXIT;
-        assert(did_enter || did_exit);
+        MDCacheEntry *entry = [[MDCacheEntry alloc] init];
+        entry->_key = key;
+        entry->_value = value;
+        cachePushFront(self, entry);
+        _entries[key] = entry;
         
-        /// Get info from node
-        cmark_node_type node_type = cmark_node_get_type(node);
-        const char *node_type_name = cmark_node_get_type_string(node);
-        const char *node_literal = cmark_node_get_literal(node);
-        Boolean is_leaf = cmark_node_first_child(node) == NULL;
+        /// Evict
+        while (_entries.count > kMDCacheCapacity) {
+            MDCacheEntry *lru = _tail;
+            cacheUnlink(self, lru);
+            [_entries removeObjectForKey:lru->_key];
+            _stats.evictions += 1;
+        }
+    }
+}
+
+- (MarkdownParserCacheStatistics)statistics {
+    @synchronized (self) {
+        MarkdownParserCacheStatistics stats = _stats;
+        stats.count = _entries.count;
+        return stats;
+    }
+}
+
+- (void)removeAllObjects {
+    @synchronized (self) {
+        while (_head != nil) cacheUnlink(self, _head); /// Break the links so the entries don't keep each other alive. (Not strictly necessary since `_prev` is unretained)
+        [_entries removeAllObjects];
+        _stats = (MarkdownParserCacheStatistics){0};
+    }
+}
+
+@end
+
+static MDLRUCache *resultCache(void) {
+    static MDLRUCache *cache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        cache = [[MDLRUCache alloc] init];
+    });
+    return cache;
+}
+
+static MDLRUCache *renderOpsCache(void) {
+    static MDLRUCache *cache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        cache = [[MDLRUCache alloc] init];
+    });
+    return cache;
+}
+
+static MarkdownRenderOps *cachedRenderOps(NSString *markdown) {
+    MDCacheKey *key = [[MDCacheKey alloc] initWithMarkdown:markdown baseAttributes:nil];
+    MarkdownRenderOps *ops = [renderOpsCache() objectForKey:key];
+    if (ops == nil) {
+        ops = parseRenderOps(key->_markdown, false, NULL, NULL);
+        [renderOpsCache() setObject:ops forKey:key];
+    }
+    return ops;
+}
+
+static MarkdownStyleSheet *styleSheetWithBaseAttributes(NSDictionary *_Nullable baseAttributes) {
+    if (baseAttributes == nil) return MarkdownStyleSheet.defaultStyleSheet;
+    MarkdownStyleSheet *styleSheet = [[MarkdownStyleSheet alloc] init];
+    styleSheet.baseAttributes = baseAttributes;
+    return styleSheet;
+}
+
+static NSAttributedString *cachedRender(NSString *markdown, NSDictionary *_Nullable baseAttributes) {
+    
+    MDCacheKey *key = [[MDCacheKey alloc] initWithMarkdown:markdown baseAttributes:baseAttributes];
+    
+    /// Lookup
+    NSAttributedString *result = [resultCache() objectForKey:key];
+    if (result != nil) return result;
+    
+    /// Render
+    ///     Outside the lock so other threads don't have to wait for us.
+    result = styleRenderOps(cachedRenderOps(key->_markdown), nil, styleSheetWithBaseAttributes(baseAttributes));
+    
+    /// Store
+    [resultCache() setObject:result forKey:key];
+    
+    return result;
+}
+
+static NSArray<NSAttributedString *> *batchRender(NSArray<NSString *> *markdownStrings, NSDictionary *_Nullable baseAttributes) {
+    
+    /// Notes:
+    /// - cmark is thread-safe as long as each thread works on its own document, and the parse stage is Foundation-only (See `MarkdownRenderOps`). So we parse all the cache misses concurrently.
+    /// - Afterwards, on the calling thread, we run the styling stage (which resolves `NSFont`s etc.) and store the results in the caches.
+    
+    NSUInteger count = markdownStrings.count;
+    NSMutableArray<NSAttributedString *> *results = [NSMutableArray arrayWithCapacity:count];
+    NSMutableArray<MDCacheKey *> *missKeys = [NSMutableArray array];
+    NSMutableIndexSet *missIndexes = [NSMutableIndexSet indexSet];
+    
+    /// Lookup
+    for (NSUInteger i = 0; i < count; i++) {
+        MDCacheKey *key = [[MDCacheKey alloc] initWithMarkdown:markdownStrings[i] baseAttributes:baseAttributes];
+        NSAttributedString *cached = [resultCache() objectForKey:key];
+        if (cached != nil) {
+            [results addObject:cached];
+        } else {
+            [results addObject:(id)NSNull.null];
+            [missKeys addObject:key];
+            [missIndexes addIndex:i];
+        }
+    }
+    
+    /// Parse concurrently
+    NSUInteger missCount = missKeys.count;
+    NSMutableArray<MarkdownRenderOps *> *parsed = [NSMutableArray arrayWithCapacity:missCount];
+    for (NSUInteger i = 0; i < missCount; i++) [parsed addObject:(id)NSNull.null];
+    dispatch_apply(missCount, DISPATCH_APPLY_AUTO, ^(size_t i) {
+        @autoreleasepool {
+            MarkdownRenderOps *ops = parseRenderOps(missKeys[i]->_markdown, false, NULL, NULL);
+            @synchronized (parsed) {
+                parsed[i] = ops;
+            }
+        }
+    });
+    
+    /// Style on the calling thread
+    MarkdownStyleSheet *styleSheet = styleSheetWithBaseAttributes(baseAttributes);
+    __block NSUInteger j = 0;
+    [missIndexes enumerateIndexesUsingBlock:^(NSUInteger i, BOOL * _Nonnull stop) {
+        MDCacheKey *key = missKeys[j];
+        [renderOpsCache() setObject:parsed[j] forKey:[[MDCacheKey alloc] initWithMarkdown:key->_markdown baseAttributes:nil]];
+        NSAttributedString *result = styleRenderOps(parsed[j], nil, styleSheet);
+        [resultCache() setObject:result forKey:key];
+        results[i] = result;
+        j++;
+    }];
+    
+    return results;
+}
+
+@implementation MarkdownStyleSheet
+
++ (MarkdownStyleSheet *)defaultStyleSheet {
+    static MarkdownStyleSheet *styleSheet;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        styleSheet = [[MarkdownStyleSheet alloc] init];
+    });
+    return styleSheet.copy; /// Copy so callers can't mutate the shared one
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
         
-        /// Define `leaf_node_types`
-        ///     Note: Leaf node types as documented in the cmark headers..
-        int leaf_types[] = {
-            CMARK_NODE_HTML_BLOCK,
-            CMARK_NODE_THEMATIC_BREAK,
-            CMARK_NODE_CODE_BLOCK,
-            CMARK_NODE_TEXT,
-            CMARK_NODE_SOFTBREAK,
-            CMARK_NODE_LINEBREAK,
-            CMARK_NODE_CODE,
-            CMARK_NODE_HTML_INLINE
-        };
+        /// Notes:
+        /// - We're misusing emphasis (which is usually italic) as a semibold. We're using the semibold, because for the small hint texts in the UI, bold looks way to strong. This is a very unsemantic and hacky solution. It works for now, but just keep this in mind.
+        /// - I tried using Italics in different places in the UI, and it always looked really bad. Also Chinese, Korean, and Japanese don't have italics. Edit: Actually on GitHub they do seem to have italics: https://github.com/dokuwiki/dokuwiki/issues/4080
+        _emphasisWeight = NSFontWeightSemibold;
+        _strongWeight = NSFontWeightBold;
+        _headingWeight = NSFontWeightBold;
+        _blockQuoteIndent = 12.0;
+        _baseAttributes = nil;
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    MarkdownStyleSheet *copy = [[MarkdownStyleSheet alloc] init];
+    copy->_emphasisWeight = _emphasisWeight;
+    copy->_strongWeight = _strongWeight;
+    copy->_headingWeight = _headingWeight;
+    copy->_blockQuoteIndent = _blockQuoteIndent;
+    copy->_baseAttributes = _baseAttributes;
+    return copy;
+}
+
+@end
+
+@implementation MarkdownParser
+
++ (NSAttributedString *)attributedStringWithMarkdown:(NSString *)src {
+    return cachedRender(src, nil);
+}
++ (NSAttributedString *)attributedStringWithMarkdown:(NSString *)src baseAttributes:(NSDictionary<NSAttributedStringKey, id> *)baseAttributes {
+    return cachedRender(src, baseAttributes);
+}
++ (NSAttributedString *)attributedStringWithAttributedMarkdown:(NSAttributedString *)src {
+    MarkdownRenderOps *ops = parseRenderOps(src.string, true, NULL, NULL);
+    return styleRenderOps(ops, src, MarkdownStyleSheet.defaultStyleSheet);
+}
+
++ (NSArray<NSAttributedString *> *)attributedStringsWithMarkdownStrings:(NSArray<NSString *> *)markdownStrings {
+    return batchRender(markdownStrings, nil);
+}
++ (NSArray<NSAttributedString *> *)attributedStringsWithMarkdownStrings:(NSArray<NSString *> *)markdownStrings baseAttributes:(NSDictionary<NSAttributedStringKey, id> *)baseAttributes {
+    return batchRender(markdownStrings, baseAttributes);
+}
+
++ (MarkdownRenderOps *)renderOpsWithMarkdown:(NSString *)markdown {
+    return cachedRenderOps(markdown);
+}
++ (NSAttributedString *)attributedStringWithRenderOps:(MarkdownRenderOps *)ops styleSheet:(MarkdownStyleSheet *)styleSheet {
+    return styleRenderOps(ops, nil, styleSheet);
+}
+
++ (MarkdownParserCacheStatistics)cacheStatistics {
+    return [resultCache() statistics];
+}
++ (void)clearCache {
+    [resultCache() removeAllObjects];
+    [renderOpsCache() removeAllObjects];
+}
+
+///
+/// Styling stage
+///
+
+static NSFont *monospacedFont(CGFloat size) {
+    #if GNUSTEP
+        return [NSFont userFixedPitchFontOfSize:size]; /// GNUstep doesn't have the monospaced system font. (We build on GNUstep for `MarkdownParserHarness`.)
+    #else
+        return [NSFont monospacedSystemFontOfSize:size weight:NSFontWeightRegular];
+    #endif
+}
+
+static NSColor *secondaryColor(Boolean tertiary) {
+    #if GNUSTEP
+        return tertiary ? NSColor.lightGrayColor : NSColor.darkGrayColor; /// GNUstep doesn't have the label colors
+    #else
+        return tertiary ? NSColor.tertiaryLabelColor : NSColor.secondaryLabelColor;
+    #endif
+}
+
+static void transformFonts(NSMutableAttributedString *string, NSRange range, NSFont *(^transform)(NSFont *font)) {
+    
+    /// Replaces the font of each run in `range`. Runs without a font are treated as having the system font.
+    ///     Mutating attributes inside the enumerated range is allowed for NSMutableAttributedString.
+    
+    [string enumerateAttribute:NSFontAttributeName inRange:range options:0 usingBlock:^(NSFont *_Nullable font, NSRange run, BOOL *stop) {
+        if (font == nil) font = [NSFont systemFontOfSize:NSFont.systemFontSize];
+        [string addAttribute:NSFontAttributeName value:transform(font) range:run];
+    }];
+}
+
+static void styleBlocks(NSMutableAttributedString *string, MarkdownRenderOps *ops, MarkdownStyleSheet *styleSheet) {
+    
+    /// Applies the styling for headings, block quotes, code and thematic breaks.
+    ///     We do this before the weights, so that `**strong**` inside a heading etc. still works.
+    
+    const MDRenderOp *op = ops.ops;
+    size_t op_count = ops.opCount;
+    
+    for (size_t i = 0; i < op_count; i++) {
         
-        /// Valdiate info from node
+        NSRange range = NSMakeRange(op[i].location, op[i].length);
+        if (range.length == 0) continue;
         
-#if DEBUG
-        if (node_literal != NULL) {
-            assert(is_leaf); /// I think only leaf nodes can contain text. That would simplify our control flow
+        switch (op[i].kind) {
+            case MDRenderOpKindHeading: {
+                static const CGFloat scales[] = { 1.6, 1.35, 1.2, 1.1, 1.0, 0.9 }; /// By level
+                CGFloat scale = scales[MIN(MAX(op[i].argument, 1), 6) - 1];
+                transformFonts(string, range, ^NSFont *(NSFont *font) {
+                    return fontBySettingSize(font, round(font.pointSize * scale));
+                });
+                [string addWeight:styleSheet.headingWeight forRange:&range];
+            } break;
+            case MDRenderOpKindCode:
+            case MDRenderOpKindCodeBlock: {
+                NSFont *codeFont = monospacedFont(NSFont.systemFontSize);
+                transformFonts(string, range, ^NSFont *(NSFont *font) {
+                    return fontBySettingSize(codeFont, font.pointSize);
+                });
+            } break;
+            case MDRenderOpKindThematicBreak: {
+                [string addAttribute:NSForegroundColorAttributeName value:secondaryColor(true) range:range];
+            } break;
+            default: break;
         }
-        if (is_leaf) {
-            Boolean node_has_leaf_type = false;
-            for (int i = 0; i < sizeof(leaf_types)/sizeof(leaf_types[0]); i++) {
-                if (leaf_types[i] == node_type) {
-                    node_has_leaf_type = true;
-                    break;
-                }
+    }
+    
+    /// Block quotes
+    ///     Inner quotes exit first, so they come first in the ops. We go backwards so the inner (deeper) indent wins.
+    for (size_t i = op_count; i > 0; i--) {
+        if (op[i-1].kind != MDRenderOpKindBlockQuote) continue;
+        NSRange range = NSMakeRange(op[i-1].location, op[i-1].length);
+        NSMutableParagraphStyle *style = [[NSMutableParagraphStyle alloc] init];
+        style.headIndent = style.firstLineHeadIndent = op[i-1].argument * styleSheet.blockQuoteIndent;
+        [string addAttribute:NSParagraphStyleAttributeName value:style range:range];
+        [string addAttribute:NSForegroundColorAttributeName value:secondaryColor(false) range:range];
+    }
+}
+
+static NSAttributedString *styleRenderOps(MarkdownRenderOps *ops, NSAttributedString *_Nullable src, MarkdownStyleSheet *styleSheet) {
+    
+    /// Turns the output of the parse stage into an attributed string.
+    ///     If you pass in `src`, we carry over its attributes for the `MDRenderOpKindSourceText` ops.
+    ///     Returns an immutable string.
+    
+    NSString *text = ops.text;
+    const MDRenderOp *op = ops.ops;
+    size_t op_count = ops.opCount;
+    
+    /// Carry over attributes from src
+    NSMutableAttributedString *carried = [[NSMutableAttributedString alloc] initWithString:text];
+    if (src != nil) {
+        for (size_t i = 0; i < op_count; i++) {
+            if (op[i].kind != MDRenderOpKindSourceText) continue;
+            if ((NSUInteger)op[i].argument + op[i].length > src.length) { assert(false); continue; }
+            NSAttributedString *src_substr = [src attributedSubstringFromRange:NSMakeRange(op[i].argument, op[i].length)];
+            [carried replaceCharactersInRange:NSMakeRange(op[i].location, op[i].length) withAttributedString:src_substr];
+        }
+    }
+    
+    /// Blocks & code
+    styleBlocks(carried, ops, styleSheet);
+    
+    /// Note: Everything below edits `carried` in place. The immutable `attributedStringBy...` methods would copy the whole document for every run.
+    
+    /// Weights
+    ///     Nested weights override each other: The ops are in the order that the nodes exited, so the outer node comes last and wins. We resolve that first, so we only create fonts once per run.
+    if (op_count > 0) {
+        NSFontWeight *weights = NULL;
+        for (size_t i = 0; i < op_count; i++) {
+            NSFontWeight weight;
+            if      (op[i].kind == MDRenderOpKindEmphasis)  weight = styleSheet.emphasisWeight;
+            else if (op[i].kind == MDRenderOpKindStrong)    weight = styleSheet.strongWeight;
+            else continue;
+            if (weights == NULL) {
+                weights = malloc(text.length * sizeof(NSFontWeight));
+                for (NSUInteger j = 0; j < text.length; j++) weights[j] = NAN;
             }
-            assert(node_has_leaf_type);
+            for (NSUInteger j = op[i].location; j < op[i].location + op[i].length; j++) weights[j] = weight;
         }
-#endif
-        
-        /// Use stack to track node enter and exit
+        if (weights != NULL) {
+            NSUInteger j = 0;
+            while (j < text.length) {
+                NSUInteger run_start = j;
+                NSFontWeight weight = weights[j];
+                while (j < text.length && (weights[j] == weight || (isnan(weights[j]) && isnan(weight)))) j++;
+                if (isnan(weight)) continue;
+                NSRange run = NSMakeRange(run_start, j - run_start);
+                [carried addWeight:weight forRange:&run];
+            }
+            free(weights);
+        }
+    }
+    
+    /// Links
+    ///     Images are also shown as links (to the image), since we can't show them inline.
+    ///     cmark doesn't escape destinations, so valid markdown like `[a](<b c>)` can give us a string that isn't a valid URL. We leave that text unlinked.
+    for (size_t i = 0; i < op_count; i++) {
+        if (op[i].kind != MDRenderOpKindLink && op[i].kind != MDRenderOpKindImage) continue;
+        NSURL *url = [NSURL URLWithString:ops.links[op[i].argument]];
+        if (url == nil) continue;
+        NSRange range = NSMakeRange(op[i].location, op[i].length);
+        [carried addHyperlink:url forRange:&range];
+    }
+    
+    /// Base
+    if (styleSheet.baseAttributes != nil) {
+        [carried addStringAttributesAsBase:styleSheet.baseAttributes];
+    }
+    
+    return carried.copy; /// Make immutable
+}
+
+
+@end
+
+///
+/// Incremental parsing
+///
+
+typedef struct {
+    NSRange src; /// Range of the block's lines in the markdown source (UTF-16)
+    NSRange dst; /// Range of the rendered block (including its leading separator) in the text storage
+} MDBlock;
+
+static NSUInteger *utf16LineStarts(NSString *string, size_t *outCount) {
+    
+    /// Returns the UTF-16 index of the start of each line in `string`. Same line endings as cmark. (See `buildSourceMap()` in MarkdownParse.m)
+    
+    NSUInteger len = string.length;
+    MDCharacterBuffer buffer;
+    initCharacterBuffer(&buffer, string);
+    
+    size_t capacity = 64;
+    size_t count = 1;
+    NSUInteger *result = malloc(capacity * sizeof(NSUInteger));
+    result[0] = 0;
+    for (NSUInteger i = 0; i < len; i++) {
+        unichar c = characterFromBuffer(&buffer, i);
+        Boolean is_line_end = c == '\n' || (c == '\r' && (i + 1 >= len || characterFromBuffer(&buffer, i + 1) != '\n'));
+        if (!is_line_end) continue;
+        if (count == capacity) {
+            capacity *= 2;
+            result = realloc(result, capacity * sizeof(NSUInteger));
+        }
+        result[count] = i + 1;
+        count += 1;
+    }
+    
+    *outCount = count;
+    return result;
+}
+
+static MDBlock *blocksFromRecords(NSString *source, MDBlockRecord *records, size_t count, NSUInteger src_offset, NSUInteger dst_offset) {
+    
+    /// Converts the line-based block records from `parseRenderOps()` into UTF-16 ranges.
+    ///     `source` is the string that was parsed. `src_offset` and `dst_offset` are where the parsed string and its rendering sit in the whole document.
+    
+    size_t line_count;
+    NSUInteger *line_starts = utf16LineStarts(source, &line_count);
+    
+    MDBlock *result = malloc(MAX(count, 1) * sizeof(MDBlock));
+    for (size_t i = 0; i < count; i++) {
+        size_t start_line = MIN(MAX(records[i].start_line, 1), (int)line_count);
+        size_t end_line = MIN(MAX(records[i].end_line, records[i].start_line), (int)line_count);
+        NSUInteger src_start = line_starts[start_line - 1];
+        NSUInteger src_end = (end_line < line_count) ? line_starts[end_line] : source.length;
+        result[i] = (MDBlock){
+            .src = NSMakeRange(src_offset + src_start, src_end - src_start),
+            .dst = NSMakeRange(dst_offset + records[i].dst_start, records[i].dst_end - records[i].dst_start),
+        };
+    }
+    
+    free(line_starts);
+    return result;
+}
+
+static Boolean blockTypeIsOpenEnded(cmark_node_type type) {
+    
+    /// Blocks that might swallow the blocks that come after them, depending on their content. (E.g. an unclosed code fence or a list whose items got indented.)
+    
+    switch (type) {
+        case CMARK_NODE_LIST:
+        case CMARK_NODE_BLOCK_QUOTE:
+        case CMARK_NODE_CODE_BLOCK:
+        case CMARK_NODE_HTML_BLOCK:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static Boolean mayDefineLinkReferences(NSString *string, NSRange range) {
+    
+    /// Returns true if a link reference definition (`[foo]: https://...`) might start on one of the lines in `range`.
+    ///     cmark doesn't expose its reference map (and resets it in `cmark_parser_finish()`), so we look at where a definition can start instead: At the start of a line, after indentation and container markers (`>`, `-`, `1.`), with a `[`. The label has to be followed by `:`, unless it continues on the next line.
+    ///     False positives just cost us a full parse. So we don't care whether the line is actually the start of a paragraph, or inside a code block.
+    
+    unichar *chars = malloc(MAX(range.length, 1) * sizeof(unichar));
+    [string getCharacters:chars range:range];
+    NSUInteger len = range.length;
+    
+    Boolean result = false;
+    NSUInteger i = 0;
+    while (i < len && !result) {
         
-        __block NSRange rangeOfExitedNodeInDst = NSMakeRange(NSNotFound, 0);
+        /// Skip indentation and container markers
+        while (true) {
+            while (i < len && (chars[i] == ' ' || chars[i] == '\t')) i++;
+            if (i < len && chars[i] == '>') { i++; continue; }
+            if (i + 1 < len && (chars[i] == '-' || chars[i] == '+' || chars[i] == '*') && (chars[i + 1] == ' ' || chars[i + 1] == '\t')) { i++; continue; }
+            NSUInteger j = i;
+            while (j < len && j - i < 9 && chars[j] >= '0' && chars[j] <= '9') j++;
+            if (j > i && j + 1 < len && (chars[j] == '.' || chars[j] == ')') && (chars[j + 1] == ' ' || chars[j + 1] == '\t')) { i = j + 1; continue; }
+            break;
+        }
         
-        if (!is_leaf && did_enter) {
-            /// Stack push
-            [stack addObject:@{ @"startIndexOfNodeInDst": @(dst.length) }];
-        } else if (did_exit) {
-            /// Stack pop
-            NSInteger node_start_idx = [[stack lastObject][@"startIndexOfNodeInDst"] integerValue];
-            [stack removeLastObject];
-            /// Locate the exited node in the dst string.
-            NSInteger node_end_idx = dst.length - 1;
-            rangeOfExitedNodeInDst = NSMakeRange(node_start_idx, node_end_idx - node_start_idx + 1);
+        /// Check label
+        if (i < len && chars[i] == '[') {
+            NSUInteger j = i + 1;
+            while (j < len && chars[j] != ']' && chars[j] != '\n' && chars[j] != '\r') {
+                j += (chars[j] == '\\') ? 2 : 1;
+            }
+            if (j >= len || chars[j] != ']') result = true; /// Label continues on the next line
+            else if (j + 1 < len && chars[j + 1] == ':') result = true;
         }
         
-        /// Define macros
-        ///     To help with repetitve code for adding double linebreaks between block-elements.
+        /// Next line
+        while (i < len && chars[i] != '\n' && chars[i] != '\r') i++;
+        while (i < len && (chars[i] == '\n' || chars[i] == '\r')) i++;
+    }
+    
+    free(chars);
+    return result;
+}
+
+@implementation MarkdownIncrementalParser {
+    NSTextStorage *_textStorage;
+    NSString *_markdown;
+    MDBlock *_blocks;
+    size_t _blockCount;
+    Boolean _definesLinkReferences; /// See `mayDefineLinkReferences()`
+}
+
+- (instancetype)initWithTextStorage:(NSTextStorage *)textStorage {
+    self = [super init];
+    if (self) {
+        _textStorage = textStorage;
+        _markdown = @"";
+        _blocks = NULL;
+        _blockCount = 0;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_blocks);
+}
+
+- (NSString *)markdown {
+    return _markdown;
+}
+
+- (void)setMarkdown:(NSString *)markdown {
+    
+    /// Full parse
+    
+    MDBlockRecord *records = NULL;
+    size_t count = 0;
+    NSAttributedString *rendered = styleRenderOps(parseRenderOps(markdown, false, &records, &count), nil, MarkdownStyleSheet.defaultStyleSheet);
+    
+    free(_blocks);
+    _blocks = blocksFromRecords(markdown, records, count, 0, 0);
+    _blockCount = count;
+    free(records);
+    
+    _markdown = markdown.copy;
+    _definesLinkReferences = mayDefineLinkReferences(markdown, NSMakeRange(0, markdown.length));
+    [_textStorage setAttributedString:rendered];
+}
+
+- (void)updateMarkdown:(NSString *)markdown editedRange:(NSRange)editedRange changeInLength:(NSInteger)delta {
+    
+    /// Re-parses only the top-level blocks around `editedRange` and splices the result into the text storage.
+    ///     `editedRange` and `delta` are in the coordinates of the new `markdown` – same as what `NSTextStorage` reports to its delegate after an edit.
+    ///
+    /// Notes:
+    /// - We always re-parse one extra block on each side of the edit, since edits can merge or split blocks with their neighbours. (E.g. deleting the blank line between two paragraphs.)
+    /// - If the last re-parsed block is 'open-ended' (See `blockTypeIsOpenEnded()`) we extend the re-parsed range by another block, since it might now swallow the blocks after it.
+    /// - Link reference definitions (`[foo]: https://...`) affect the whole document, so if there are any, we just do a full parse. We only look for them in the re-parsed window – the rest of the document was checked when it was last parsed.
+    
+    /// Validate
+    assert(_textStorage.length == (_blockCount == 0 ? 0 : NSMaxRange(_blocks[_blockCount - 1].dst)));
+    assert((NSInteger)_markdown.length + delta == (NSInteger)markdown.length);
+    
+    /// Fall back to full parse
+    if (_blockCount == 0 || _definesLinkReferences) {
+        [self setMarkdown:markdown];
+        return;
+    }
+    
+    /// Get edited range in old coordinates
+    NSRange oldEditedRange = NSMakeRange(editedRange.location, editedRange.length - delta);
+    
+    /// Find affected blocks
+    ///     `a` is the last block that starts at or before the edit, `b` is the last block that starts at or before the end of the edit.
+    size_t a = 0;
+    while (a + 1 < _blockCount && _blocks[a + 1].src.location <= oldEditedRange.location) a++;
+    size_t b = a;
+    while (b + 1 < _blockCount && _blocks[b + 1].src.location <= NSMaxRange(oldEditedRange)) b++;
+    
+    /// Add neighbours
+    if (a > 0) a--;
+    if (b + 1 < _blockCount) b++;
+    
+    /// Re-parse
+    
+    NSUInteger src_start;
+    NSString *window;
+    NSAttributedString *rendered;
+    MDBlockRecord *records = NULL;
+    size_t count = 0;
+    
+    while (true) {
         
-        #define nodeIsBlockElement(__cmark_node) \
-        ({ \
-            cmark_node_type type = cmark_node_get_type(__cmark_node); \
-            Boolean is_block = CMARK_NODE_FIRST_BLOCK <= type && type <= CMARK_NODE_LAST_BLOCK; \
-            is_block; \
-        })
-        #define nodeIsInlineElement(__cmark_node) \
-        ({ \
-            cmark_node_type type = cmark_node_get_type(__cmark_node); \
-            Boolean is_inline = CMARK_NODE_FIRST_INLINE <= type && type <= CMARK_NODE_LAST_INLINE; \
-            is_inline; \
-        })
-        #define addDoubleLinebreaksForBlockElementToDst() \
-            if (did_enter) { \
-                Boolean is_block = nodeIsBlockElement(node); \
-                Boolean previous_sibling_is_also_block = nodeIsBlockElement(cmark_node_previous(node)); \
-                if (is_block && previous_sibling_is_also_block) { \
-                dst = [dst attributedStringByAppending:@"\n\n".attributed]; \
-            } \
-        }
+        /// Get the source of the affected blocks in the new markdown
+        ///     The window runs up to the start of the next unaffected block, so it also contains the blank lines after the last affected block. The first window also contains any blank lines at the start of the document.
+        src_start = (a == 0) ? 0 : _blocks[a].src.location;
+        NSUInteger src_end = (b + 1 == _blockCount) ? markdown.length : _blocks[b + 1].src.location + delta;
+        window = [markdown substringWithRange:NSMakeRange(src_start, src_end - src_start)];
         
-        /// Handle all types of nodes
-        ///     Notes:
-        ///     - Leaf nodes are marked with 🍁. They only have enter events, no exit events.
-        ///     - The `command_map` dict is just a long if-else statement, but the dict makes it far more readable.
-        NSDictionary *command_map = @{
-            
-            @(CMARK_NODE_NONE): ^{
-                
-                assert(false); /// Something went wrong
-                
-            },
-            @(CMARK_NODE_DOCUMENT): ^{          /// == `CMARK_NODE_FIRST_BLOCK`
-                
-                /// Root node
-                
-            },
-            @(CMARK_NODE_BLOCK_QUOTE): ^{
-                
-                assert(false); /// Don't know how to handle
-                
-            },
-            @(CMARK_NODE_LIST): ^{
-                
-                addDoubleLinebreaksForBlockElementToDst();
-                
-                if (did_enter) {
-                    
-                    /// Initialize list item counter
-                    md_list_index = cmark_node_get_list_start(node);
-                }
-                
-            },
-            @(CMARK_NODE_ITEM): ^{
-                
-                /// Note: Even though list items are blockElements, they don't have double linebreaks between them, so we don't use addDoubleLinebreaksForBlockElementToDst()
-                
-                if (did_enter) {
-                    
-                    /// Get parent node of item (the list node)
-                    cmark_node *list_node = cmark_node_parent(node);
-                    
-                    /// Validate
-                    assert(cmark_node_get_type(list_node) == CMARK_NODE_LIST);
-                    
-                    /// Get list tightness
-                    ///     A markdown list can become non-tight when there are empty lines between the item lines.
-                    Boolean is_tight = cmark_node_get_list_tight(list_node);
-                    
-                    /// Check if this is the first `list_item`
-                    Boolean is_first_item = md_list_index == cmark_node_get_list_start(list_node);
-                    
-                    /// Get list prefix string
-                    NSString *prefix;
-                    cmark_list_type list_type = cmark_node_get_list_type(list_node);
-                    if (list_type == CMARK_BULLET_LIST) {
-                        prefix = @"• ";
-                    } else if (list_type == CMARK_ORDERED_LIST)  {
-                        if (cmark_node_get_list_delim(list_node) == CMARK_PAREN_DELIM) {
-                            prefix = stringf(@"%d) ", md_list_index);
-                        } else if (cmark_node_get_list_delim(list_node) == CMARK_PERIOD_DELIM) {
-                            prefix = stringf(@"%d. ", md_list_index);
-                        } else {
-                            assert(false);
-                        }
-                    } else {
-                        assert(false);
-                    }
-                    
-                    /// Append newline
-                    if (!is_first_item) {
-                        if (is_tight || !is_tight) { /// Turning off non-tight lists (which have a whole free line between items) bc I don't like them and accidentally produce them sometimes.
-                            dst = [dst attributedStringByAppending:@"\n".attributed];
-                        }
-                    }
-                    
-                    /// Append list-item-prefix to dst
-                    ///     Note: The next nodes we'll iterate over will be the child nodes of this item node.
-                    dst = [dst attributedStringByAppending:prefix.attributed];
-                    
-                    /// Advance list counter
-                    md_list_index += 1;
-                }
-                
-            },
-            @(CMARK_NODE_CODE_BLOCK): ^{        /// 🍁
-                
-                assert(did_enter); /// Leaf node
-                assert(false); /// Don't know how to handle
-                
-            },
-            @(CMARK_NODE_HTML_BLOCK): ^{        /// 🍁
-                
-                assert(did_enter); /// Leaf node
-                assert(false); /// Don't know how to handle
-                
-            },
-            @(CMARK_NODE_CUSTOM_BLOCK): ^{
-                
-                assert(false); /// Don't know how to handle
-                
-            },
-            @(CMARK_NODE_PARAGRAPH): ^{
-                
-                addDoubleLinebreaksForBlockElementToDst();
-                
-                /// Note: Why the isTopLevel restriction?
-                ///     Update: every list item seems to contain its own paragraph, they are all last paragraphs through, so the `is_top_level` check doesn't seem necessary.
-            },
-            @(CMARK_NODE_HEADING): ^{
-                
-                assert(false); /// Don't know how to handle
-                
-            },
-            @(CMARK_NODE_THEMATIC_BREAK): ^{    /// == `CMARK_NODE_LAST_BLOCK` || 🍁 || "thematic break" is the horizontal line aka hrule
-                
-                assert(did_enter); /// Leaf node
-                assert(false); /// Don't know how to handle
-                
-            },
-            @(CMARK_NODE_TEXT): ^{              /// == `CMARK_NODE_FIRST_INLINE` || 🍁
-                
-                assert(did_enter); /// Leaf node
-                
-                NSString *node_text = stringf(@"%s", cmark_node_get_literal(node));
-                
-                if (!keepExistingAttributes) {
-                    dst = [dst attributedStringByAppending:node_text.attributed];
-                } else {
-                    /// Get attributed substring of src which contains the same text as `node_text`
-                    ///     By appending the attributed substring of src to dst instead of appending `node_text` directly, we effectively carry over the string attributes from src into dst
-                    NSRange src_range = [src.string rangeOfString:node_text options:0 range:src_search_range];
-                    NSAttributedString *src_substr = [src attributedSubstringFromRange:src_range];
-                    dst = [dst attributedStringByAppending:src_substr];
-                    /// Remove the processed range from the search range
-                    ///     End of the search range should always be the end of the src string
-                    NSInteger new_search_range_start = src_range.location + src_range.length;
-                    src_search_range = NSMakeRange(new_search_range_start, src.length - new_search_range_start);
-                }
-                
-            },
-            @(CMARK_NODE_SOFTBREAK): ^{         /// 🍁
-                
-                assert(did_enter); /// Leaf node
-                dst = [dst attributedStringByAppending:@"\n".attributed];
-                
-            },
-            @(CMARK_NODE_LINEBREAK): ^{         /// 🍁
-                
-                /// Notes:
-                /// - I've never seen this be called. `\n\n` will start a new paragraph, not insert a 'linebreak'.
-                /// - That's because even a siingle newline char starts a new paragraph (at least for NSParagraphStyle). We should be using the "Unicode Line Separator" for simple linebreaks in UI text.
-                ///   - See: https://stackoverflow.com/questions/4404286/how-is-a-paragraph-defined-in-an-nsattributedstring
-                
-                assert(did_enter); /// Leaf node
-                dst = [dst attributedStringByAppending:@"\n".attributed];
-                
-            },
-            @(CMARK_NODE_CODE): ^{              /// 🍁
-                
-                assert(did_enter); /// Leaf node
-                assert(false); /// Don't know how to handle
-                
-            },
-            @(CMARK_NODE_HTML_INLINE): ^{       /// 🍁
-                
-                assert(did_enter); /// Leaf node
-                assert(false); /// Don't know how to handle
-                
-            },
-            @(CMARK_NODE_CUSTOM_INLINE): ^{
-                
-                assert(false); /// Don't know how to handle
-                
-            },
-            @(CMARK_NODE_EMPH): ^{
-                /// Notes:
-                /// - We're misusing emphasis (which is usually italic) as a semibold. We're using the semibold, because for the small hint texts in the UI, bold looks way to strong. This is a very unsemantic and hacky solution. It works for now, but just keep this in mind.
-                /// - I tried using Italics in different places in the UI, and it always looked really bad. Also Chinese, Korean, and Japanese don't have italics. Edit: Actually on GitHub they do seem to have italics: https://github.com/dokuwiki/dokuwiki/issues/4080
-                if (did_exit) {
-                    dst = [dst attributedStringByAddingWeight:NSFontWeightSemibold forRange:&rangeOfExitedNodeInDst];
-                }
-            },
-            @(CMARK_NODE_STRONG): ^{
-                if (did_exit) {
-                    dst = [dst attributedStringByAddingWeight:NSFontWeightBold forRange:&rangeOfExitedNodeInDst];
-                }
-            },
-            @(CMARK_NODE_LINK): ^{
-                if (did_exit) {
-                    dst = [dst attributedStringByAddingHyperlink:[NSURL URLWithString:stringf(@"%s", cmark_node_get_url(node))] forRange:&rangeOfExitedNodeInDst];
-                }
-            },
-            @(CMARK_NODE_IMAGE): ^{             /// == `CMARK_NODE_LAST_INLINE`
-                
-                assert(false); /// Don't know how to handle
-                
-            }
-        };
+        /// Render
+        rendered = styleRenderOps(parseRenderOps(window, false, &records, &count), nil, MarkdownStyleSheet.defaultStyleSheet);
         
-        /// Execute command from map for this node
-        void (^command)(void) = command_map[@(node_type)];
-        if (command != nil) {
-            command();
-        } else {
-            NSLog(@"Error: Unknown node_type: %s", node_type_name);
-            assert(false);
+        /// Extend if the last re-parsed block is open-ended
+        if (b + 1 < _blockCount && count > 0 && blockTypeIsOpenEnded(records[count - 1].type)) {
+            free(records);
+            records = NULL;
+            b++;
+            continue;
         }
         
-    } /// End iterating nodes
+        break;
+    }
+    
+    /// Fall back to full parse if the edit added a link reference definition
+    if (mayDefineLinkReferences(markdown, NSMakeRange(src_start, window.length))) {
+        free(records);
+        [self setMarkdown:markdown];
+        return;
+    }
+    
+    /// Get the rendered range we're replacing
+    NSUInteger dst_start = _blocks[a].dst.location;
+    NSUInteger dst_end = NSMaxRange(_blocks[b].dst);
+    
+    /// Add separator
+    ///     When rendered on its own, the first block in the window doesn't get the double linebreak that separates it from its previous sibling.
+    ///     Note: All top-level blocks get separated by a double linebreak. See `addDoubleLinebreaksForBlockElementToDst()` in MarkdownParse.m.
+    NSUInteger prefix_len = 0;
+    if (a > 0 && count > 0) {
+        NSMutableAttributedString *prefixed = [[NSMutableAttributedString alloc] initWithString:@"\n\n"];
+        [prefixed appendAttributedString:rendered];
+        rendered = prefixed;
+        prefix_len = 2;
+    }
     
-    /// Free iterator & and tree
-    cmark_iter_free(iter);
-    cmark_node_free(root);
+    /// Remove separator
+    ///     If the window is now empty and it was at the start of the document, the next block becomes the first block, and loses its separator.
+    Boolean remove_next_separator = a == 0 && count == 0 && b + 1 < _blockCount;
+    if (remove_next_separator) {
+        dst_end += 2;
+    }
     
-    /// Return generate string
-    return dst;
+    /// Splice
+    [_textStorage beginEditing];
+    [_textStorage replaceCharactersInRange:NSMakeRange(dst_start, dst_end - dst_start) withAttributedString:rendered];
+    [_textStorage endEditing];
+    
+    /// Update blocks
+    
+    MDBlock *new_blocks = blocksFromRecords(window, records, count, src_start, dst_start + prefix_len);
+    free(records);
+    if (count > 0 && prefix_len > 0) {
+        new_blocks[0].dst.location -= prefix_len;
+        new_blocks[0].dst.length += prefix_len;
+    }
+    
+    size_t tail_count = _blockCount - (b + 1);
+    size_t total_count = a + count + tail_count;
+    MDBlock *blocks = malloc(MAX(total_count, 1) * sizeof(MDBlock));
+    
+    memcpy(blocks, _blocks, a * sizeof(MDBlock));
+    memcpy(blocks + a, new_blocks, count * sizeof(MDBlock));
+    NSInteger dst_delta = (NSInteger)rendered.length - (NSInteger)(dst_end - dst_start);
+    for (size_t i = 0; i < tail_count; i++) {
+        MDBlock block = _blocks[b + 1 + i];
+        block.src.location += delta;
+        block.dst.location += dst_delta;
+        blocks[a + count + i] = block;
+    }
+    if (remove_next_separator) {
+        blocks[a + count].dst.location = 0;
+        blocks[a + count].dst.length -= 2; /// The blocks after it are already in the right place since `dst_delta` accounts for the removed separator.
+    }
+    
+    free(new_blocks);
+    free(_blocks);
+    _blocks = blocks;
+    _blockCount = total_count;
+    _markdown = markdown.copy;
 }
 
-
 @end
@@ -0,0 +1,43 @@
+//
+// --------------------------------------------------------------------------
+// MarkdownPrecompiledStrings.h
+// Created for Mac Mouse Fix (https://github.com/noah-nuebling/mac-mouse-fix)
+// Created by Noah Nuebling in 2026
+// Licensed under Licensed under the MMF License (https://github.com/noah-nuebling/mac-mouse-fix/blob/master/License)
+// --------------------------------------------------------------------------
+//
+
+/// Markdown from the `.xcstrings` catalogs, parsed at build time.
+///     The `precompile-markdown` command of the CLT writes a blob with the `MarkdownRenderOps` for every key and locale. At runtime we map that file into memory and only run the styling stage – cmark never runs on the launch path.
+///     Lookups binary-search the index in the mapped file, so loading the blob doesn't touch the entries.
+
+#import <Foundation/Foundation.h>
+#import "MarkdownRenderOps.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface MarkdownPrecompiledStrings : NSObject
+
+/// Writing (build time)
++ (NSData *)dataWithRenderOps:(NSDictionary<NSString *, NSDictionary<NSString *, MarkdownRenderOps *> *> *)renderOpsByLocaleAndKey; /// Outer keys are locales, inner keys are string keys
+
+/// Loading (runtime)
++ (instancetype _Nullable)mainBundleStrings; /// Loads `MarkdownStrings.mdblob` from the main bundle (once). Returns nil if we didn't ship one. The "Precompile Markdown" build phase of ObjcTests writes it.
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype _Nullable)initWithContentsOfFile:(NSString *)path; /// Maps the file. Returns nil if it's missing or malformed.
+- (instancetype _Nullable)initWithData:(NSData *)data;
+
+@property (nonatomic, readonly) NSUInteger count;
+
+/// Lookup
+- (MarkdownRenderOps *_Nullable)renderOpsForKey:(NSString *)key locale:(NSString *)locale;
+- (NSAttributedString *_Nullable)attributedStringForKey:(NSString *)key locale:(NSString *)locale; /// Styled with the default style sheet
+- (MarkdownRenderOps *_Nullable)renderOpsForKey:(NSString *)key preferredLocales:(NSArray<NSString *> *)locales; /// Tries each locale, then its less specific parents (`zh-Hant-TW` -> `zh-Hant` -> `zh`). Takes `_` or `-` separators.
+
+/// Localized lookup
+///     Looks up `key` in `mainBundleStrings` for the localizations the main bundle resolves to, then its development localization. Returns nil if there's no blob or no entry – callers parse the localized string at runtime then. (See `attributedStringWithLocalizedCoolMarkdown:`)
++ (NSAttributedString *_Nullable)localizedAttributedStringForKey:(NSString *)key;
+
+@end
+
+NS_ASSUME_NONNULL_END
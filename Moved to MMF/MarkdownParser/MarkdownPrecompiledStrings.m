@@ -0,0 +1,237 @@
+//
+// --------------------------------------------------------------------------
+// MarkdownPrecompiledStrings.m
+// Created for Mac Mouse Fix (https://github.com/noah-nuebling/mac-mouse-fix)
+// Created by Noah Nuebling in 2026
+// Licensed under Licensed under the MMF License (https://github.com/noah-nuebling/mac-mouse-fix/blob/master/License)
+// --------------------------------------------------------------------------
+//
+
+#import "MarkdownPrecompiledStrings.h"
+#import "MarkdownParser.h"
+
+///
+/// Blob format
+///
+
+/// Notes:
+/// - All integers are little-endian `uint32_t`. Offsets are from the start of the blob.
+/// - Layout: magic, version, entry count, index, payload.
+///     Each index entry is: locale offset, locale length, key offset, key length, ops offset, ops length. The locale and key are UTF-8 (no terminator), the ops are `-[MarkdownRenderOps serializedData]`.
+///     The index is sorted by locale, then key, comparing the UTF-8 bytes. That's what lets us binary-search it.
+/// - Bump `kMDBlobVersion` whenever the layout changes. (Changes to the render ops format are caught by `MarkdownRenderOps` itself.)
+
+static const uint32_t kMDBlobMagic = 'MDPC';
+static const uint32_t kMDBlobVersion = 1;
+static const size_t kMDBlobHeaderSize = 3 * sizeof(uint32_t);
+static const size_t kMDBlobIndexEntrySize = 6 * sizeof(uint32_t);
+
+static uint32_t readUInt32At(const uint8_t *bytes, size_t offset) {
+    uint32_t le;
+    memcpy(&le, bytes + offset, sizeof(le));
+    return NSSwapLittleIntToHost(le);
+}
+
+static void writeUInt32(NSMutableData *data, uint32_t value) {
+    uint32_t le = NSSwapHostIntToLittle(value);
+    [data appendBytes:&le length:sizeof(le)];
+}
+
+static int compareBytes(const void *a, size_t a_len, const void *b, size_t b_len) {
+    int result = memcmp(a, b, MIN(a_len, b_len));
+    if (result != 0) return result;
+    return (a_len < b_len) ? -1 : (a_len > b_len) ? 1 : 0;
+}
+
+@implementation MarkdownPrecompiledStrings {
+    NSData *_data;
+    const uint8_t *_bytes;
+}
+
+#pragma mark - Writing
+
++ (NSData *)dataWithRenderOps:(NSDictionary<NSString *, NSDictionary<NSString *, MarkdownRenderOps *> *> *)renderOpsByLocaleAndKey {
+
+    /// Collect entries
+    NSMutableArray<NSArray<NSData *> *> *entries = [NSMutableArray array]; /// [locale, key, ops]
+    for (NSString *locale in renderOpsByLocaleAndKey) {
+        NSDictionary<NSString *, MarkdownRenderOps *> *opsByKey = renderOpsByLocaleAndKey[locale];
+        for (NSString *key in opsByKey) {
+            [entries addObject:@[
+                [locale dataUsingEncoding:NSUTF8StringEncoding],
+                [key dataUsingEncoding:NSUTF8StringEncoding],
+                opsByKey[key].serializedData,
+            ]];
+        }
+    }
+
+    /// Sort
+    ///     Has to match the comparison in `-indexOfKey:locale:`
+    [entries sortUsingComparator:^NSComparisonResult(NSArray<NSData *> *a, NSArray<NSData *> *b) {
+        int result = compareBytes(a[0].bytes, a[0].length, b[0].bytes, b[0].length);
+        if (result == 0) result = compareBytes(a[1].bytes, a[1].length, b[1].bytes, b[1].length);
+        return (result < 0) ? NSOrderedAscending : (result > 0) ? NSOrderedDescending : NSOrderedSame;
+    }];
+
+    /// Header
+    NSMutableData *data = [NSMutableData data];
+    writeUInt32(data, kMDBlobMagic);
+    writeUInt32(data, kMDBlobVersion);
+    writeUInt32(data, (uint32_t)entries.count);
+
+    /// Index
+    size_t offset = kMDBlobHeaderSize + entries.count * kMDBlobIndexEntrySize;
+    for (NSArray<NSData *> *entry in entries) {
+        for (NSData *part in entry) {
+            writeUInt32(data, (uint32_t)offset);
+            writeUInt32(data, (uint32_t)part.length);
+            offset += part.length;
+        }
+    }
+
+    /// Payload
+    for (NSArray<NSData *> *entry in entries) {
+        for (NSData *part in entry) {
+            [data appendData:part];
+        }
+    }
+
+    assert(data.length == offset);
+    return data;
+}
+
+#pragma mark - Loading
+
++ (instancetype)mainBundleStrings {
+    static MarkdownPrecompiledStrings *strings;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSString *path = [NSBundle.mainBundle pathForResource:@"MarkdownStrings" ofType:@"mdblob"];
+        if (path != nil) strings = [[MarkdownPrecompiledStrings alloc] initWithContentsOfFile:path];
+    });
+    return strings;
+}
+
+- (instancetype)initWithContentsOfFile:(NSString *)path {
+
+    /// Map the file
+    ///     The pages are only read in when we touch them. For the lookups, that's the index plus the one entry.
+    NSError *error = nil;
+    NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedAlways error:&error];
+    if (data == nil) {
+        NSLog(@"MarkdownPrecompiledStrings: Couldn't map %@: %@", path, error);
+        return nil;
+    }
+    return [self initWithData:data];
+}
+
+- (instancetype)initWithData:(NSData *)data {
+
+    self = [super init];
+    if (!self) return nil;
+
+    _data = data;
+    _bytes = data.bytes;
+    size_t length = data.length;
+
+    /// Validate header
+    if (length < kMDBlobHeaderSize) return nil;
+    if (readUInt32At(_bytes, 0) != kMDBlobMagic) return nil;
+    if (readUInt32At(_bytes, 4) != kMDBlobVersion) return nil;
+    uint32_t count = readUInt32At(_bytes, 8);
+    if (count > (length - kMDBlobHeaderSize) / kMDBlobIndexEntrySize) return nil;
+
+    /// Validate index
+    ///     So lookups don't have to bounds-check. The render ops themselves are validated when we decode them.
+    for (uint32_t i = 0; i < count; i++) {
+        size_t entry = kMDBlobHeaderSize + i * kMDBlobIndexEntrySize;
+        for (size_t part = 0; part < 3; part++) {
+            uint64_t offset = readUInt32At(_bytes, entry + part * 8);
+            uint64_t len = readUInt32At(_bytes, entry + part * 8 + 4);
+            if (offset + len > length) return nil;
+        }
+    }
+
+    _count = count;
+    return self;
+}
+
+#pragma mark - Lookup
+
+- (NSInteger)indexOfKey:(NSString *)key locale:(NSString *)locale {
+
+    /// Binary search. Returns -1 if there's no entry.
+
+    const char *locale_c = locale.UTF8String;
+    const char *key_c = key.UTF8String;
+    size_t locale_len = strlen(locale_c);
+    size_t key_len = strlen(key_c);
+
+    NSInteger lo = 0;
+    NSInteger hi = (NSInteger)_count - 1;
+    while (lo <= hi) {
+        NSInteger mid = lo + (hi - lo) / 2;
+        size_t entry = kMDBlobHeaderSize + mid * kMDBlobIndexEntrySize;
+        int result = compareBytes(locale_c, locale_len, _bytes + readUInt32At(_bytes, entry + 0), readUInt32At(_bytes, entry + 4));
+        if (result == 0) result = compareBytes(key_c, key_len, _bytes + readUInt32At(_bytes, entry + 8), readUInt32At(_bytes, entry + 12));
+        if (result == 0) return mid;
+        if (result < 0) hi = mid - 1;
+        else            lo = mid + 1;
+    }
+    return -1;
+}
+
+- (MarkdownRenderOps *)renderOpsForKey:(NSString *)key locale:(NSString *)locale {
+
+    NSInteger index = [self indexOfKey:key locale:locale];
+    if (index < 0) return nil;
+
+    size_t entry = kMDBlobHeaderSize + index * kMDBlobIndexEntrySize;
+    uint32_t offset = readUInt32At(_bytes, entry + 16);
+    uint32_t len = readUInt32At(_bytes, entry + 20);
+
+    /// Decode without copying the bytes out of the mapped file. (`MarkdownRenderOps` copies what it keeps.)
+    NSData *opsData = [NSData dataWithBytesNoCopy:(void *)(_bytes + offset) length:len freeWhenDone:NO];
+    return [MarkdownRenderOps renderOpsWithSerializedData:opsData];
+}
+
+- (NSAttributedString *)attributedStringForKey:(NSString *)key locale:(NSString *)locale {
+    MarkdownRenderOps *ops = [self renderOpsForKey:key locale:locale];
+    if (ops == nil) return nil;
+    return [MarkdownParser attributedStringWithRenderOps:ops styleSheet:MarkdownStyleSheet.defaultStyleSheet];
+}
+
+- (MarkdownRenderOps *)renderOpsForKey:(NSString *)key preferredLocales:(NSArray<NSString *> *)locales {
+
+    /// The catalogs use `-` (`zh-Hans`), `NSLocale` uses `_` (`en_US`). We drop subtags from the end until we find an entry.
+
+    for (NSString *preferred in locales) {
+        NSString *locale = [preferred stringByReplacingOccurrencesOfString:@"_" withString:@"-"];
+        while (locale.length > 0) {
+            MarkdownRenderOps *ops = [self renderOpsForKey:key locale:locale];
+            if (ops != nil) return ops;
+            NSRange separator = [locale rangeOfString:@"-" options:NSBackwardsSearch];
+            if (separator.location == NSNotFound) break;
+            locale = [locale substringToIndex:separator.location];
+        }
+    }
+    return nil;
+}
+
+#pragma mark - Localized lookup
+
++ (NSAttributedString *)localizedAttributedStringForKey:(NSString *)key {
+
+    MarkdownPrecompiledStrings *strings = [self mainBundleStrings];
+    if (strings == nil) return nil;
+
+    NSMutableArray<NSString *> *locales = NSBundle.mainBundle.preferredLocalizations.mutableCopy;
+    NSString *developmentLocalization = NSBundle.mainBundle.developmentLocalization;
+    if (developmentLocalization != nil) [locales addObject:developmentLocalization];
+
+    MarkdownRenderOps *ops = [strings renderOpsForKey:key preferredLocales:locales];
+    if (ops == nil) return nil;
+    return [MarkdownParser attributedStringWithRenderOps:ops styleSheet:MarkdownStyleSheet.defaultStyleSheet];
+}
+
+@end
@@ -0,0 +1,58 @@
+//
+// --------------------------------------------------------------------------
+// MarkdownRenderOps.h
+// Created for Mac Mouse Fix (https://github.com/noah-nuebling/mac-mouse-fix)
+// Created by Noah Nuebling in 2026
+// Licensed under Licensed under the MMF License (https://github.com/noah-nuebling/mac-mouse-fix/blob/master/License)
+// --------------------------------------------------------------------------
+//
+
+/// The output of `MarkdownParser`'s parse stage.
+///     It's the rendered plain text plus a flat list of style operations over ranges of that text. `MarkdownParser` turns this into an `NSAttributedString` by applying a `MarkdownStyleSheet`. That way we can parse a string once and style it many ways.
+///     This is Foundation-only and immutable, so it can be created on any thread, cached, and serialized (e.g. precomputed at build time for the strings we ship).
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(uint32_t, MDRenderOpKind) {
+    MDRenderOpKindEmphasis      = 1,
+    MDRenderOpKindStrong        = 2,
+    MDRenderOpKindLink          = 3,    /// `argument` is an index into `links`
+    MDRenderOpKindSourceText    = 4,    /// `argument` is the location of this text in the markdown source. Lets the styling stage carry over attributes from attributed markdown.
+    MDRenderOpKindHeading       = 5,    /// `argument` is the heading level (1-6)
+    MDRenderOpKindBlockQuote    = 6,    /// `argument` is the nesting depth (1 for a top-level quote)
+    MDRenderOpKindCode          = 7,    /// Inline code
+    MDRenderOpKindCodeBlock     = 8,
+    MDRenderOpKindThematicBreak = 9,
+    MDRenderOpKindImage         = 10,   /// `argument` is an index into `links`. The text is the image's alt text.
+    
+    MDRenderOpKindLast          = MDRenderOpKindImage,
+};
+
+typedef struct {
+    uint32_t location;      /// UTF-16 range in `text`
+    uint32_t length;
+    uint32_t argument;
+    MDRenderOpKind kind;
+} MDRenderOp;
+
+@interface MarkdownRenderOps : NSObject
+
+/// Ops are in the order they should be applied. For nested ops that set the same thing (e.g. weight), the later one wins.
+
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithText:(NSString *)text ops:(const MDRenderOp *_Nullable)ops count:(size_t)count links:(NSArray<NSString *> *)links;
+
+@property (nonatomic, readonly) NSString *text;
+@property (nonatomic, readonly) const MDRenderOp *ops;
+@property (nonatomic, readonly) size_t opCount;
+@property (nonatomic, readonly) NSArray<NSString *> *links;
+
+/// Serialization
+- (NSData *)serializedData;
++ (instancetype _Nullable)renderOpsWithSerializedData:(NSData *)data; /// Returns nil if the data is malformed
+
+@end
+
+NS_ASSUME_NONNULL_END
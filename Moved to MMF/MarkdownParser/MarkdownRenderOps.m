@@ -0,0 +1,177 @@
+//
+// --------------------------------------------------------------------------
+// MarkdownRenderOps.m
+// Created for Mac Mouse Fix (https://github.com/noah-nuebling/mac-mouse-fix)
+// Created by Noah Nuebling in 2026
+// Licensed under Licensed under the MMF License (https://github.com/noah-nuebling/mac-mouse-fix/blob/master/License)
+// --------------------------------------------------------------------------
+//
+
+#import "MarkdownRenderOps.h"
+
+///
+/// Serialized format
+///
+
+/// Notes:
+/// - All integers are little-endian `uint32_t`. Strings are a byte count followed by UTF-8 (no terminator).
+/// - Layout: magic, version, text, op count, ops (location, length, argument, kind), link count, links.
+/// - Bump `kMDRenderOpsVersion` whenever the layout or the meaning of the ops changes. Old data is then rejected, not misinterpreted.
+
+static const uint32_t kMDRenderOpsMagic = 'MDOP';
+static const uint32_t kMDRenderOpsVersion = 2; /// 2: Added block quote, heading, code, thematic break and image ops
+
+static void writeUInt32(NSMutableData *data, uint32_t value) {
+    uint32_t le = NSSwapHostIntToLittle(value);
+    [data appendBytes:&le length:sizeof(le)];
+}
+
+static void writeString(NSMutableData *data, NSString *string) {
+    NSData *utf8 = [string dataUsingEncoding:NSUTF8StringEncoding];
+    writeUInt32(data, (uint32_t)utf8.length);
+    [data appendData:utf8];
+}
+
+typedef struct {
+    const uint8_t *bytes;
+    size_t length;
+    size_t offset;
+    Boolean failed;
+} MDReader;
+
+static uint32_t readUInt32(MDReader *r) {
+    if (r->failed || r->offset + sizeof(uint32_t) > r->length) {
+        r->failed = true;
+        return 0;
+    }
+    uint32_t le;
+    memcpy(&le, r->bytes + r->offset, sizeof(le));
+    r->offset += sizeof(le);
+    return NSSwapLittleIntToHost(le);
+}
+
+static NSString *_Nullable readString(MDReader *r) {
+    uint32_t len = readUInt32(r);
+    if (r->failed || r->offset + len > r->length) {
+        r->failed = true;
+        return nil;
+    }
+    NSString *result = [[NSString alloc] initWithBytes:r->bytes + r->offset length:len encoding:NSUTF8StringEncoding];
+    r->offset += len;
+    if (result == nil) r->failed = true;
+    return result;
+}
+
+@implementation MarkdownRenderOps {
+    MDRenderOp *_ops;
+}
+
+- (instancetype)initWithText:(NSString *)text ops:(const MDRenderOp *)ops count:(size_t)count links:(NSArray<NSString *> *)links {
+    self = [super init];
+    if (self) {
+        _text = text.copy;
+        _links = links.copy;
+        _opCount = count;
+        _ops = malloc(MAX(count, 1) * sizeof(MDRenderOp));
+        if (count > 0) memcpy(_ops, ops, count * sizeof(MDRenderOp));
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_ops);
+}
+
+- (const MDRenderOp *)ops {
+    return _ops;
+}
+
+- (BOOL)isEqual:(id)object {
+    if (self == object) return YES;
+    if (![object isKindOfClass:[MarkdownRenderOps class]]) return NO;
+    MarkdownRenderOps *other = object;
+    return _opCount == other->_opCount
+        && [_text isEqualToString:other->_text]
+        && [_links isEqualToArray:other->_links]
+        && memcmp(_ops, other->_ops, _opCount * sizeof(MDRenderOp)) == 0;
+}
+
+- (NSUInteger)hash {
+    return _text.hash ^ _opCount;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p, text: \"%@\", ops: %zu, links: %@>", self.class, self, _text, _opCount, _links];
+}
+
+#pragma mark - Serialization
+
+- (NSData *)serializedData {
+
+    NSMutableData *data = [NSMutableData dataWithCapacity:_text.length + _opCount * sizeof(MDRenderOp) + 64];
+
+    writeUInt32(data, kMDRenderOpsMagic);
+    writeUInt32(data, kMDRenderOpsVersion);
+    writeString(data, _text);
+
+    writeUInt32(data, (uint32_t)_opCount);
+    for (size_t i = 0; i < _opCount; i++) {
+        writeUInt32(data, _ops[i].location);
+        writeUInt32(data, _ops[i].length);
+        writeUInt32(data, _ops[i].argument);
+        writeUInt32(data, _ops[i].kind);
+    }
+
+    writeUInt32(data, (uint32_t)_links.count);
+    for (NSString *link in _links) {
+        writeString(data, link);
+    }
+
+    return data;
+}
+
++ (instancetype)renderOpsWithSerializedData:(NSData *)data {
+
+    MDReader r = { .bytes = data.bytes, .length = data.length, .offset = 0, .failed = false };
+
+    /// Header
+    if (readUInt32(&r) != kMDRenderOpsMagic) return nil;
+    if (readUInt32(&r) != kMDRenderOpsVersion) return nil;
+
+    /// Text
+    NSString *text = readString(&r);
+    if (r.failed) return nil;
+
+    /// Ops
+    uint32_t op_count = readUInt32(&r);
+    if (r.failed || op_count > (r.length - r.offset) / (4 * sizeof(uint32_t))) return nil; /// Don't trust the count before we allocate
+    MDRenderOp *ops = malloc(MAX(op_count, 1) * sizeof(MDRenderOp));
+    for (uint32_t i = 0; i < op_count; i++) {
+        ops[i].location = readUInt32(&r);
+        ops[i].length = readUInt32(&r);
+        ops[i].argument = readUInt32(&r);
+        ops[i].kind = readUInt32(&r);
+    }
+
+    /// Links
+    uint32_t link_count = readUInt32(&r);
+    NSMutableArray<NSString *> *links = [NSMutableArray array];
+    for (uint32_t i = 0; i < link_count && !r.failed; i++) {
+        NSString *link = readString(&r);
+        if (link != nil) [links addObject:link];
+    }
+
+    /// Validate
+    ///     Ops have to stay inside the text, and link ops have to point at a link. Otherwise the styling stage would throw.
+    for (uint32_t i = 0; i < op_count && !r.failed; i++) {
+        if (ops[i].kind < 1 || ops[i].kind > MDRenderOpKindLast) r.failed = true;
+        if ((uint64_t)ops[i].location + ops[i].length > text.length) r.failed = true;
+        if ((ops[i].kind == MDRenderOpKindLink || ops[i].kind == MDRenderOpKindImage) && ops[i].argument >= links.count) r.failed = true;
+    }
+
+    MarkdownRenderOps *result = r.failed ? nil : [[MarkdownRenderOps alloc] initWithText:text ops:ops count:op_count links:links];
+    free(ops);
+    return result;
+}
+
+@end
@@ -0,0 +1,601 @@
+//
+//  MarkdownParserBenchmarks.m
+//  objc-test-july-13-2024
+//
+//  Created by Noah Nübling on 18.10.26.
+//
+
+#import "MarkdownParserBenchmarks.h"
+#import "MarkdownParser.h"
+#import "MarkdownPrecompiledStrings.h"
+#import "NSString+Additions.h"
+#import "NSAttributedString+Additions.h"
+#import "QuartzCore/QuartzCore.h"
+#import "AppKit/AppKit.h"
+#import "../cmark/branch-cjk/headers/src/cmark.h"
+
+@implementation MarkdownParserBenchmarks
+
+void runMarkdownParserBenchmarks(void) {
+
+    @autoreleasepool {
+
+        NSLog(@"------------------");
+        NSLog(@"Node dispatch overhead:");
+        NSLog(@"------------------");
+
+        runNodeDispatchBenchmark(1000000);
+
+        NSLog(@"------------------");
+        NSLog(@"Per-node parser overhead:");
+        NSLog(@"------------------");
+
+        runPerNodeBenchmark(200);
+
+        NSLog(@"------------------");
+        NSLog(@"Attribute carryover (attributedStringWithAttributedMarkdown:):");
+        NSLog(@"------------------");
+
+        runAttributeCarryoverBenchmark(50);
+        runAttributeCarryoverBenchmark(500);
+
+        NSLog(@"------------------");
+        NSLog(@"Per-keystroke cost (MarkdownIncrementalParser vs full re-parse):");
+        NSLog(@"------------------");
+
+        runKeystrokeBenchmark(10);
+        runKeystrokeBenchmark(100);
+        runKeystrokeBenchmark(1000);
+
+        NSLog(@"------------------");
+        NSLog(@"Getting UTF-8 for cmark:");
+        NSLog(@"------------------");
+
+        runUTF8FeedingBenchmark(20, 2000);
+        runUTF8FeedingBenchmark(2000, 20);
+
+        NSLog(@"------------------");
+        NSLog(@"Result cache (attributedStringWithCoolMarkdown:):");
+        NSLog(@"------------------");
+
+        runCacheBenchmark(50, 20);
+        runCacheBenchmark(1000, 20);
+
+        NSLog(@"------------------");
+        NSLog(@"Launch-time rendering of Localizable.xcstrings (sequential vs batch):");
+        NSLog(@"------------------");
+
+        runLocalizationCatalogBenchmark(5);
+        runPrecompiledCatalogBenchmark(5);
+
+        NSLog(@"------------------");
+        NSLog(@"Parse once, style many (normal + hint style):");
+        NSLog(@"------------------");
+
+        runStyleVariantsBenchmark(200);
+
+        NSLog(@"------------------");
+        NSLog(@"CommonMark spec corpus throughput:");
+        NSLog(@"------------------");
+
+        runSpecCorpusBenchmark(20);
+    }
+}
+
+///
+/// Test data
+///
+
+static NSString *benchmarkMarkdown(NSInteger paragraphs) {
+
+    /// Returns a document that only uses node types that `MarkdownParser` can handle.
+
+    NSMutableString *md = [NSMutableString string];
+    for (NSInteger i = 0; i < paragraphs; i++) {
+        [md appendFormat:@"Paragraph %ld with some **bold** and some *emphasised* text and a [**link**](https://google.com)\n", (long)i];
+        [md appendString:@"followed by a softbreak.\n"];
+        [md appendString:@"\n"];
+        [md appendString:@"- first item\n"];
+        [md appendString:@"- second *item*\n"];
+        [md appendString:@"\n"];
+        [md appendString:@"1. numbered **item**\n"];
+        [md appendString:@"2. another item\n"];
+        [md appendString:@"\n"];
+    }
+    return md;
+}
+
+static NSInteger countNodeEvents(NSString *md) {
+    const char *md_c = [md cStringUsingEncoding:NSUTF8StringEncoding];
+    cmark_node *root = cmark_parse_document(md_c, strlen(md_c), CMARK_OPT_HARDBREAKS);
+    cmark_iter *iter = cmark_iter_new(root);
+    NSInteger count = 0;
+    while (cmark_iter_next(iter) != CMARK_EVENT_DONE) count += 1;
+    cmark_iter_free(iter);
+    cmark_node_free(root);
+    return count;
+}
+
+static void collectStringUnitValues(id object, NSMutableArray<NSString *> *values) {
+
+    /// Collects all `stringUnit.value`s in an .xcstrings catalog, including plural and device variations.
+
+    if ([object isKindOfClass:[NSDictionary class]]) {
+        NSDictionary *dict = object;
+        NSString *value = dict[@"stringUnit"][@"value"];
+        if ([value isKindOfClass:[NSString class]]) [values addObject:value];
+        for (id child in dict.allValues) collectStringUnitValues(child, values);
+    } else if ([object isKindOfClass:[NSArray class]]) {
+        for (id child in object) collectStringUnitValues(child, values);
+    }
+}
+
+static NSArray<NSString *> *localizationCatalogStrings(void) {
+
+    /// Loads all strings from the `Localizable.xcstrings` catalogs in the repo. (We find them relative to this source file.)
+
+    NSString *repoPath = [[[@(__FILE__) stringByDeletingLastPathComponent] stringByAppendingPathComponent:@"../../.."] stringByStandardizingPath];
+    NSString *localizationsPath = [repoPath stringByAppendingPathComponent:@"CLT/Mouse Fix Localizations"];
+
+    NSMutableArray<NSString *> *values = [NSMutableArray array];
+    NSDirectoryEnumerator<NSString *> *enumerator = [NSFileManager.defaultManager enumeratorAtPath:localizationsPath];
+    for (NSString *relativePath in enumerator) {
+        if (![relativePath.lastPathComponent isEqual:@"Localizable.xcstrings"]) continue;
+        NSData *data = [NSData dataWithContentsOfFile:[localizationsPath stringByAppendingPathComponent:relativePath]];
+        if (data == nil) continue;
+        id catalog = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+        collectStringUnitValues(catalog, values);
+    }
+
+    NSLog(@"Loaded %lu localized strings from %@", (unsigned long)values.count, localizationsPath);
+    return values;
+}
+
+static NSArray<NSString *> *commonMarkSpecExamples(void) {
+
+    /// Loads the examples from the CommonMark spec (`spec.txt` from https://github.com/commonmark/commonmark-spec)
+    ///     We don't ship the spec. Point the `MD_SPEC_PATH` environment variable at it. Otherwise we fall back to a small corpus that covers every node type.
+    ///     In spec.txt, examples look like this: A line of 32 backticks followed by ` example`, the markdown, a line with a `.`, the expected HTML, and another line of backticks. Tabs are written as `→`.
+
+    NSString *specPath = NSProcessInfo.processInfo.environment[@"MD_SPEC_PATH"];
+    NSString *spec = specPath ? [NSString stringWithContentsOfFile:specPath encoding:NSUTF8StringEncoding error:nil] : nil;
+
+    NSMutableArray<NSString *> *result = [NSMutableArray array];
+
+    if (spec != nil) {
+        NSString *fence = [@"" stringByPaddingToLength:32 withString:@"`" startingAtIndex:0];
+        NSString *exampleStart = [fence stringByAppendingString:@" example"];
+        NSMutableString *example = nil;
+        for (NSString *line in [spec componentsSeparatedByString:@"\n"]) {
+            if ([line isEqual:exampleStart]) {
+                example = [NSMutableString string];
+            } else if (example != nil && [line isEqual:@"."]) {
+                [result addObject:[example stringByReplacingOccurrencesOfString:@"→" withString:@"\t"]];
+                example = nil;
+            } else if (example != nil) {
+                [example appendFormat:@"%@\n", line];
+            }
+        }
+        NSLog(@"Loaded %lu examples from %@", (unsigned long)result.count, specPath);
+    }
+
+    if (result.count == 0) {
+        NSArray<NSString *> *corpus = @[
+            @"# Heading 1\n\n## Heading *2*\n\nSetext\n======\n",
+            @"> A quote with **strong** text\n>\n> > and a nested quote\n",
+            @"Some `inline code` and ``double `ticks` ``\n",
+            @"```swift\nlet x = 1\nprint(x)\n```\n\n    indented code\n",
+            @"<div>\n*html block*\n</div>\n\nInline <span>html</span> and a<br>break\n",
+            @"Above\n\n***\n\nBelow\n\n- - -\n",
+            @"![alt *text*](https://example.com/image.png \"title\") and [a link](https://example.com)\n",
+            @"![a](<b c>) and [a link](<with spaces>)\n", /// Not valid URLs once cmark unescapes them
+            @"1. one\n   - nested *bullet*\n   - another\n2. two\n\n3) paren list\n",
+            @"[ref]\n\n[ref]: https://example.com\n",
+            @"Entities &amp; escapes \\*not emphasis\\* &copy; &#35;\n",
+            @"Hard  \nbreak and soft\nbreak\n",
+        ];
+        for (NSInteger i = 0; i < 50; i++) [result addObjectsFromArray:corpus];
+        NSLog(@"MD_SPEC_PATH not set - using built-in corpus with %lu documents", (unsigned long)result.count);
+    }
+
+    return result;
+}
+
+///
+/// Benchmarks
+///
+
+static void runSpecCorpusBenchmark(NSInteger iterations) {
+
+    /// Renders every example of the CommonMark spec. This makes sure the parser handles all node types, and gives us a throughput number for varied input.
+    ///     We clear the cache before each iteration so we measure parsing, not cache hits. (Some examples are duplicates.)
+
+    NSArray<NSString *> *examples = commonMarkSpecExamples();
+    NSUInteger bytes = 0;
+    for (NSString *md in examples) bytes += [md lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+
+    /// Parse stage only
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            [MarkdownParser clearCache];
+            for (NSString *md in examples) [MarkdownParser renderOpsWithMarkdown:md];
+        }
+    }
+    CFTimeInterval parseTime = CACurrentMediaTime() - startTime;
+
+    /// Parse + style
+    startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            [MarkdownParser clearCache];
+            for (NSString *md in examples) [MarkdownParser attributedStringWithMarkdown:md];
+        }
+    }
+    CFTimeInterval fullTime = CACurrentMediaTime() - startTime;
+    [MarkdownParser clearCache];
+
+    double totalBytes = (double)bytes * iterations;
+    NSLog(@"Spec corpus - %lu documents, %lu bytes - parse: %.1f MB/s (%.1f ns/byte), parse + style: %.1f MB/s (%.1f ns/byte)", (unsigned long)examples.count, (unsigned long)bytes, totalBytes / parseTime / 1e6, parseTime / totalBytes * 1e9, totalBytes / fullTime / 1e6, fullTime / totalBytes * 1e9);
+}
+
+static void runLocalizationCatalogBenchmark(NSInteger iterations) {
+
+    /// Emulates converting all localized strings at app launch. Once with one `attributedStringWithMarkdown:` call per string, once with the batch API.
+    ///     We clear the cache before each iteration since at launch it's empty.
+
+    NSArray<NSString *> *strings = localizationCatalogStrings();
+    if (strings.count == 0) {
+        NSLog(@"Catalog - Couldn't load any strings. Skipping.");
+        return;
+    }
+
+    /// Sequential
+    NSMutableArray<NSAttributedString *> *sequentialResults = nil;
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            [MarkdownParser clearCache];
+            sequentialResults = [NSMutableArray array];
+            for (NSString *s in strings) {
+                [sequentialResults addObject:[MarkdownParser attributedStringWithMarkdown:s]];
+            }
+        }
+    }
+    CFTimeInterval sequentialTime = CACurrentMediaTime() - startTime;
+
+    /// Batch
+    NSArray<NSAttributedString *> *batchResults = nil;
+    startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            [MarkdownParser clearCache];
+            batchResults = [MarkdownParser attributedStringsWithMarkdownStrings:strings];
+        }
+    }
+    CFTimeInterval batchTime = CACurrentMediaTime() - startTime;
+    [MarkdownParser clearCache];
+
+    /// Validate
+    NSInteger mismatches = 0;
+    for (NSUInteger i = 0; i < strings.count; i++) {
+        if (![sequentialResults[i] isEqualToAttributedString:batchResults[i]]) mismatches += 1;
+    }
+
+    NSLog(@"Catalog - %lu strings, per launch - sequential: %.2f ms, batch: %.2f ms. batch is %.1fx faster. (mismatches: %ld)", (unsigned long)strings.count, sequentialTime / iterations * 1e3, batchTime / iterations * 1e3, sequentialTime / batchTime, (long)mismatches);
+}
+
+static void runPrecompiledCatalogBenchmark(NSInteger iterations) {
+
+    /// Same as above, but loading the strings from a precompiled blob (See `MarkdownPrecompiler`) instead of parsing them.
+    ///     We write the blob to a temporary file, so the loading goes through mmap like in the app.
+
+    NSArray<NSString *> *strings = localizationCatalogStrings();
+    if (strings.count == 0) {
+        NSLog(@"Precompiled - Couldn't load any strings. Skipping.");
+        return;
+    }
+
+    NSMutableDictionary<NSString *, MarkdownRenderOps *> *opsByKey = [NSMutableDictionary dictionary];
+    for (NSUInteger i = 0; i < strings.count; i++) {
+        opsByKey[stringf(@"%lu", (unsigned long)i)] = [MarkdownParser renderOpsWithMarkdown:strings[i]];
+    }
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"MarkdownParserBenchmarks.mdblob"];
+    NSData *blob = [MarkdownPrecompiledStrings dataWithRenderOps:@{ @"all": opsByKey }];
+    [blob writeToFile:path atomically:YES];
+    [MarkdownParser clearCache];
+
+    CFTimeInterval startTime = CACurrentMediaTime();
+    NSInteger mismatches = 0;
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            MarkdownPrecompiledStrings *precompiled = [[MarkdownPrecompiledStrings alloc] initWithContentsOfFile:path];
+            for (NSUInteger j = 0; j < strings.count; j++) {
+                NSAttributedString *result = [precompiled attributedStringForKey:stringf(@"%lu", (unsigned long)j) locale:@"all"];
+                if (result == nil) mismatches += 1;
+            }
+        }
+    }
+    CFTimeInterval time = CACurrentMediaTime() - startTime;
+    [NSFileManager.defaultManager removeItemAtPath:path error:nil];
+
+    NSLog(@"Precompiled - %lu strings, blob: %lu bytes, per launch: %.2f ms. (missing: %ld)", (unsigned long)strings.count, (unsigned long)blob.length, time / iterations * 1e3, (long)mismatches);
+}
+
+static void runPerNodeBenchmark(NSInteger iterations) {
+
+    /// Measures the whole parser (cmark parsing + walking + building the attributed string) and divides by the number of node events.
+
+    NSString *md = benchmarkMarkdown(20);
+    NSInteger nodeEvents = countNodeEvents(md);
+
+    CFTimeInterval startTime = CACurrentMediaTime();
+    NSUInteger totalLength = 0;
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            [MarkdownParser clearCache]; /// Measure parsing, not the cache
+            totalLength += [MarkdownParser attributedStringWithMarkdown:md].length;
+        }
+    }
+    CFTimeInterval endTime = CACurrentMediaTime();
+
+    CFTimeInterval perNode = (endTime - startTime) / (iterations * nodeEvents);
+    NSLog(@"MarkdownParser - %ld node events per doc, %ld iterations, total: %f s, per node event: %.0f ns (total length: %lu)", (long)nodeEvents, (long)iterations, endTime - startTime, perNode * 1e9, (unsigned long)totalLength);
+}
+
+static void runAttributeCarryoverBenchmark(NSInteger paragraphs) {
+
+    /// Repetitive text is the worst case for locating text nodes in the source by searching. Time per paragraph should stay flat as the document grows.
+
+    NSMutableString *md = [NSMutableString string];
+    for (NSInteger i = 0; i < paragraphs; i++) {
+        [md appendString:@"aaaa aaaa **aaaa** aaaa *aaaa* aaaa \\* aaaa &amp; aaaa\n\n"];
+    }
+    NSMutableAttributedString *src = [[NSMutableAttributedString alloc] initWithString:md];
+    [src addAttribute:NSToolTipAttributeName value:@"carried over" range:NSMakeRange(0, src.length)];
+
+    NSInteger iterations = 20;
+    CFTimeInterval startTime = CACurrentMediaTime();
+    __block NSUInteger carriedOverLength = 0;
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            NSAttributedString *result = [MarkdownParser attributedStringWithAttributedMarkdown:src];
+            carriedOverLength = 0;
+            [result enumerateAttribute:NSToolTipAttributeName inRange:NSMakeRange(0, result.length) options:0 usingBlock:^(id  _Nullable value, NSRange range, BOOL * _Nonnull stop) {
+                if (value != nil) carriedOverLength += range.length;
+            }];
+        }
+    }
+    CFTimeInterval endTime = CACurrentMediaTime();
+
+    NSLog(@"Carryover - %ld paragraphs, per paragraph: %.2f µs (chars with carried-over attributes: %lu)", (long)paragraphs, (endTime - startTime) / (iterations * paragraphs) * 1e6, (unsigned long)carriedOverLength);
+}
+
+static void runKeystrokeBenchmark(NSInteger paragraphs) {
+
+    /// Types characters into the middle of a document, once re-parsing the whole document for every keystroke and once through `MarkdownIncrementalParser`. Incremental time per keystroke should stay flat as the document grows.
+
+    NSString *md = benchmarkMarkdown(paragraphs);
+    NSInteger keystrokes = 50;
+    NSString *typed = @"abcde fghij ";
+
+    NSTextStorage *storage = [[NSTextStorage alloc] init];
+    MarkdownIncrementalParser *parser = [[MarkdownIncrementalParser alloc] initWithTextStorage:storage];
+
+    /// Find a spot in the middle of a paragraph
+    NSRange paragraphRange = [md rangeOfString:@"with some" options:0 range:NSMakeRange(md.length / 2, md.length - md.length / 2)];
+
+    /// Full re-parse
+    NSMutableString *current = md.mutableCopy;
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < keystrokes; i++) {
+        @autoreleasepool {
+            [current insertString:[typed substringWithRange:NSMakeRange(i % typed.length, 1)] atIndex:paragraphRange.location + i];
+            [storage setAttributedString:[MarkdownParser attributedStringWithMarkdown:current]];
+        }
+    }
+    CFTimeInterval fullTime = CACurrentMediaTime() - startTime;
+    [MarkdownParser clearCache]; /// Every keystroke was a cache miss. Don't keep the results around.
+
+    /// Incremental
+    current = md.mutableCopy;
+    parser.markdown = current;
+    startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < keystrokes; i++) {
+        @autoreleasepool {
+            [current insertString:[typed substringWithRange:NSMakeRange(i % typed.length, 1)] atIndex:paragraphRange.location + i];
+            [parser updateMarkdown:current editedRange:NSMakeRange(paragraphRange.location + i, 1) changeInLength:1];
+        }
+    }
+    CFTimeInterval incrementalTime = CACurrentMediaTime() - startTime;
+
+    NSLog(@"Keystroke - %ld paragraphs (%lu chars), per keystroke - full: %.1f µs, incremental: %.1f µs. incremental is %.1fx faster.", (long)paragraphs, (unsigned long)md.length, fullTime / keystrokes * 1e6, incrementalTime / keystrokes * 1e6, fullTime / incrementalTime);
+}
+
+static void runUTF8FeedingBenchmark(NSInteger paragraphs, NSInteger iterations) {
+
+    /// Isolates the cost of getting the UTF-8 bytes we hand to cmark. (Without parsing)
+    ///     - 'before' is what we used to do: `cStringUsingEncoding:` + `strlen()`
+    ///     - 'after' is what `parseMarkdown()` does for non-ASCII strings: Encode into a reused buffer with `getBytes:...`
+    ///     We add a non-ASCII character so `CFStringGetCStringPtr()` can't be used.
+
+    NSString *md = [benchmarkMarkdown(paragraphs) stringByAppendingString:@"Ünïcödé"];
+
+    /// Before
+    CFTimeInterval startTime = CACurrentMediaTime();
+    size_t sum = 0;
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            const char *bytes = [md cStringUsingEncoding:NSUTF8StringEncoding];
+            sum += strlen(bytes);
+        }
+    }
+    CFTimeInterval beforeTime = CACurrentMediaTime() - startTime;
+
+    /// After
+    startTime = CACurrentMediaTime();
+    char *buffer = NULL;
+    size_t capacity = 0;
+    for (NSInteger i = 0; i < iterations; i++) {
+        NSUInteger max_len = [md maximumLengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+        if (capacity < max_len) {
+            free(buffer);
+            buffer = malloc(max_len);
+            capacity = max_len;
+        }
+        NSUInteger used_len = 0;
+        [md getBytes:buffer maxLength:max_len usedLength:&used_len encoding:NSUTF8StringEncoding options:NSStringEncodingConversionAllowLossy range:NSMakeRange(0, md.length) remainingRange:NULL];
+        sum += used_len;
+    }
+    free(buffer);
+    CFTimeInterval afterTime = CACurrentMediaTime() - startTime;
+
+    NSLog(@"UTF-8 - %lu chars, per call - cStringUsingEncoding+strlen: %.1f µs, reused buffer: %.1f µs. (sum: %zu)", (unsigned long)md.length, beforeTime / iterations * 1e6, afterTime / iterations * 1e6, sum);
+}
+
+static void runCacheBenchmark(NSInteger distinctStrings, NSInteger reloads) {
+
+    /// Emulates views reloading and re-rendering the same set of short localized strings.
+    ///     If `distinctStrings` is larger than the cache capacity, we cycle through them in order – the worst case for an LRU cache.
+
+    NSMutableArray<NSString *> *strings = [NSMutableArray array];
+    for (NSInteger i = 0; i < distinctStrings; i++) {
+        [strings addObject:stringf(@"Localized string %ld with **bold** and a [link](https://macmousefix.com)", (long)i)];
+    }
+
+    [MarkdownParser clearCache];
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSInteger r = 0; r < reloads; r++) {
+        @autoreleasepool {
+            for (NSString *s in strings) {
+                [NSAttributedString attributedStringWithCoolMarkdown:s];
+            }
+        }
+    }
+    CFTimeInterval endTime = CACurrentMediaTime();
+
+    MarkdownParserCacheStatistics stats = [MarkdownParser cacheStatistics];
+    NSLog(@"Cache - %ld distinct strings, %ld reloads, per call: %.2f µs, hits: %lu, misses: %lu, evictions: %lu, hit rate: %.1f%%", (long)distinctStrings, (long)reloads, (endTime - startTime) / (distinctStrings * reloads) * 1e6, (unsigned long)stats.hits, (unsigned long)stats.misses, (unsigned long)stats.evictions, 100.0 * stats.hits / (stats.hits + stats.misses));
+    [MarkdownParser clearCache];
+}
+
+static void runStyleVariantsBenchmark(NSInteger iterations) {
+
+    /// Renders the same markdown in two styles (like `attributedStringByFillingOutBase` vs `...AsHint`).
+    ///     - 'before': Parse for each style
+    ///     - 'after': Parse into render ops once, then style the ops twice
+
+    NSString *md = benchmarkMarkdown(5);
+    MarkdownStyleSheet *normal = [[MarkdownStyleSheet alloc] init];
+    normal.baseAttributes = @{ NSFontAttributeName: [NSFont systemFontOfSize:NSFont.systemFontSize], NSForegroundColorAttributeName: NSColor.labelColor };
+    MarkdownStyleSheet *hint = [[MarkdownStyleSheet alloc] init];
+    hint.baseAttributes = @{ NSFontAttributeName: [NSFont systemFontOfSize:NSFont.smallSystemFontSize], NSForegroundColorAttributeName: NSColor.secondaryLabelColor };
+
+    /// Before
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            [MarkdownParser clearCache];
+            [[MarkdownParser attributedStringWithMarkdown:md] attributedStringByAddingStringAttributesAsBase:normal.baseAttributes];
+            [MarkdownParser clearCache];
+            [[MarkdownParser attributedStringWithMarkdown:md] attributedStringByAddingStringAttributesAsBase:hint.baseAttributes];
+        }
+    }
+    CFTimeInterval beforeTime = CACurrentMediaTime() - startTime;
+
+    /// After
+    startTime = CACurrentMediaTime();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            [MarkdownParser clearCache];
+            MarkdownRenderOps *ops = [MarkdownParser renderOpsWithMarkdown:md];
+            [MarkdownParser attributedStringWithRenderOps:ops styleSheet:normal];
+            [MarkdownParser attributedStringWithRenderOps:ops styleSheet:hint];
+        }
+    }
+    CFTimeInterval afterTime = CACurrentMediaTime() - startTime;
+
+    NSLog(@"Style variants - per pair - parse twice: %.1f µs, parse once: %.1f µs. parse once is %.1fx faster. (serialized ops: %lu bytes)", beforeTime / iterations * 1e6, afterTime / iterations * 1e6, beforeTime / afterTime, (unsigned long)[MarkdownParser renderOpsWithMarkdown:md].serializedData.length);
+}
+
+static void runNodeDispatchBenchmark(NSInteger iterations) {
+
+    /// Isolates the cost of dispatching a node event to its handler.
+    ///     - 'before' emulates the old `command_map`: An `NSDictionary` of 20 blocks capturing `__block` state, rebuilt for every node event, and looked up with a boxed `node_type`.
+    ///     - 'after' is the `switch` we use now.
+
+    /// Before
+    CFTimeInterval startTime = CACurrentMediaTime();
+    __block NSInteger sum = 0;
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            cmark_node_type node_type = (cmark_node_type)(i % CMARK_NODE_LAST_INLINE) + 1;
+            NSInteger value = i;
+            NSDictionary *command_map = @{
+                @(CMARK_NODE_DOCUMENT):         ^{ sum += value * 1; },
+                @(CMARK_NODE_BLOCK_QUOTE):      ^{ sum += value * 2; },
+                @(CMARK_NODE_LIST):             ^{ sum += value * 3; },
+                @(CMARK_NODE_ITEM):             ^{ sum += value * 4; },
+                @(CMARK_NODE_CODE_BLOCK):       ^{ sum += value * 5; },
+                @(CMARK_NODE_HTML_BLOCK):       ^{ sum += value * 6; },
+                @(CMARK_NODE_CUSTOM_BLOCK):     ^{ sum += value * 7; },
+                @(CMARK_NODE_PARAGRAPH):        ^{ sum += value * 8; },
+                @(CMARK_NODE_HEADING):          ^{ sum += value * 9; },
+                @(CMARK_NODE_THEMATIC_BREAK):   ^{ sum += value * 10; },
+                @(CMARK_NODE_TEXT):             ^{ sum += value * 11; },
+                @(CMARK_NODE_SOFTBREAK):        ^{ sum += value * 12; },
+                @(CMARK_NODE_LINEBREAK):        ^{ sum += value * 13; },
+                @(CMARK_NODE_CODE):             ^{ sum += value * 14; },
+                @(CMARK_NODE_HTML_INLINE):      ^{ sum += value * 15; },
+                @(CMARK_NODE_CUSTOM_INLINE):    ^{ sum += value * 16; },
+                @(CMARK_NODE_EMPH):             ^{ sum += value * 17; },
+                @(CMARK_NODE_STRONG):           ^{ sum += value * 18; },
+                @(CMARK_NODE_LINK):             ^{ sum += value * 19; },
+                @(CMARK_NODE_IMAGE):            ^{ sum += value * 20; },
+            };
+            void (^command)(void) = command_map[@(node_type)];
+            command();
+        }
+    }
+    CFTimeInterval endTime = CACurrentMediaTime();
+    CFTimeInterval beforeTime = endTime - startTime;
+    NSLog(@"command_map - sum: %ld", (long)sum);
+
+    /// After
+    startTime = CACurrentMediaTime();
+    sum = 0;
+    for (NSInteger i = 0; i < iterations; i++) {
+        cmark_node_type node_type = (cmark_node_type)(i % CMARK_NODE_LAST_INLINE) + 1;
+        NSInteger value = i;
+        switch (node_type) {
+            case CMARK_NODE_DOCUMENT:       sum += value * 1; break;
+            case CMARK_NODE_BLOCK_QUOTE:    sum += value * 2; break;
+            case CMARK_NODE_LIST:           sum += value * 3; break;
+            case CMARK_NODE_ITEM:           sum += value * 4; break;
+            case CMARK_NODE_CODE_BLOCK:     sum += value * 5; break;
+            case CMARK_NODE_HTML_BLOCK:     sum += value * 6; break;
+            case CMARK_NODE_CUSTOM_BLOCK:   sum += value * 7; break;
+            case CMARK_NODE_PARAGRAPH:      sum += value * 8; break;
+            case CMARK_NODE_HEADING:        sum += value * 9; break;
+            case CMARK_NODE_THEMATIC_BREAK: sum += value * 10; break;
+            case CMARK_NODE_TEXT:           sum += value * 11; break;
+            case CMARK_NODE_SOFTBREAK:      sum += value * 12; break;
+            case CMARK_NODE_LINEBREAK:      sum += value * 13; break;
+            case CMARK_NODE_CODE:           sum += value * 14; break;
+            case CMARK_NODE_HTML_INLINE:    sum += value * 15; break;
+            case CMARK_NODE_CUSTOM_INLINE:  sum += value * 16; break;
+            case CMARK_NODE_EMPH:           sum += value * 17; break;
+            case CMARK_NODE_STRONG:         sum += value * 18; break;
+            case CMARK_NODE_LINK:           sum += value * 19; break;
+            case CMARK_NODE_IMAGE:          sum += value * 20; break;
+            default: assert(false);
+        }
+    }
+    endTime = CACurrentMediaTime();
+    CFTimeInterval afterTime = endTime - startTime;
+    NSLog(@"switch - sum: %ld", (long)sum);
+
+    NSLog(@"Dispatch per node event - command_map: %.1f ns, switch: %.1f ns. switch is %.1fx faster.", beforeTime / iterations * 1e9, afterTime / iterations * 1e9, beforeTime / afterTime);
+}
+
+@end
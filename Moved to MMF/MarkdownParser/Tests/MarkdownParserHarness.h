@@ -0,0 +1,22 @@
+//
+//  MarkdownParserHarness.h
+//  objc-test-july-13-2024
+//
+//  Created by Noah Nübling on 18.10.26.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Headless harness for `MarkdownParser`: Throughput, allocations and peak memory over a few corpora, plus a fuzzer.
+///     Runs inside the app (see AppDelegate), or standalone on Linux with GNUstep (see `GNUmakefile` next to this file).
+///     Arguments: `[--iterations N] [--fuzz N] [--seed N] [--spec spec.txt] [--catalogs dir] [file.md ...]`
+
+@interface MarkdownParserHarness : NSObject
+
+int runMarkdownParserHarness(int argc, const char *_Nonnull argv[_Nullable]); /// Returns an exit code. Non-zero if fuzzing found failures.
+
+@end
+
+NS_ASSUME_NONNULL_END
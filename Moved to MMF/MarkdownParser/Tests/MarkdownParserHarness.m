@@ -0,0 +1,449 @@
+//
+//  MarkdownParserHarness.m
+//  objc-test-july-13-2024
+//
+//  Created by Noah Nübling on 18.10.26.
+//
+
+#import "MarkdownParserHarness.h"
+#import "MarkdownParser.h"
+#import "AppKit/AppKit.h"
+#import "../cmark/branch-cjk/headers/src/cmark.h"
+#import <stdatomic.h>
+#import <signal.h>
+#import <fcntl.h>
+#import <unistd.h>
+#import <time.h>
+#import <sys/resource.h>
+
+///
+/// Counting allocations
+///
+
+static _Atomic(uint64_t) _allocationCount;
+static Boolean _canCountAllocations;
+
+#if defined(__APPLE__)
+
+    /// libmalloc calls `malloc_logger` for every allocation if it's set. (That's how the allocation tracking in Instruments works.) It's not in the public headers.
+    typedef void (malloc_logger_t)(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t result, uint32_t num_hot_frames_to_skip);
+    extern malloc_logger_t *malloc_logger;
+    #define kMFMallocLogTypeAllocate 2
+
+    static void countingMallocLogger(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t result, uint32_t num_hot_frames_to_skip) {
+        if (type & kMFMallocLogTypeAllocate) atomic_fetch_add_explicit(&_allocationCount, 1, memory_order_relaxed);
+    }
+    static void startCountingAllocations(void) {
+        malloc_logger = countingMallocLogger;
+        _canCountAllocations = true;
+    }
+    static void stopCountingAllocations(void) {
+        malloc_logger = NULL;
+    }
+
+#elif defined(__GLIBC__) && MD_HARNESS_MAIN
+
+    /// We replace malloc & co. and forward to glibc.
+    ///     Only in the standalone harness. We don't want to replace the allocator when we're linked into the app.
+    extern void *__libc_malloc(size_t size);
+    extern void *__libc_calloc(size_t count, size_t size);
+    extern void *__libc_realloc(void *ptr, size_t size);
+
+    void *malloc(size_t size) {
+        atomic_fetch_add_explicit(&_allocationCount, 1, memory_order_relaxed);
+        return __libc_malloc(size);
+    }
+    void *calloc(size_t count, size_t size) {
+        atomic_fetch_add_explicit(&_allocationCount, 1, memory_order_relaxed);
+        return __libc_calloc(count, size);
+    }
+    void *realloc(void *ptr, size_t size) {
+        atomic_fetch_add_explicit(&_allocationCount, 1, memory_order_relaxed);
+        return __libc_realloc(ptr, size);
+    }
+    static void startCountingAllocations(void) { _canCountAllocations = true; }
+    static void stopCountingAllocations(void) {}
+
+#else
+
+    static void startCountingAllocations(void) { _canCountAllocations = false; }
+    static void stopCountingAllocations(void) {}
+
+#endif
+
+///
+/// Measuring
+///
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t peakResidentBytes(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    #if defined(__APPLE__)
+        return usage.ru_maxrss;         /// Bytes on macOS
+    #else
+        return usage.ru_maxrss * 1024;  /// Kilobytes on Linux
+    #endif
+}
+
+static NSUInteger countNodes(NSString *md) {
+    NSData *utf8 = [md dataUsingEncoding:NSUTF8StringEncoding allowLossyConversion:YES];
+    cmark_node *root = cmark_parse_document(utf8.bytes, utf8.length, CMARK_OPT_HARDBREAKS);
+    cmark_iter *iter = cmark_iter_new(root);
+    NSUInteger count = 0;
+    cmark_event_type ev;
+    while ((ev = cmark_iter_next(iter)) != CMARK_EVENT_DONE) {
+        if (ev == CMARK_EVENT_ENTER) count += 1;
+    }
+    cmark_iter_free(iter);
+    cmark_node_free(root);
+    return count;
+}
+
+static void measureCorpus(NSString *name, NSArray<NSString *> *documents, NSInteger iterations) {
+
+    /// Renders the whole corpus `iterations` times with an empty cache and logs the cost per byte and per node.
+    ///     Peak memory is for the whole process so far. We measure the corpora from small to large, so the number is mostly from the current one.
+
+    if (documents.count == 0) {
+        NSLog(@"Harness - %@: No documents. Skipping.", name);
+        return;
+    }
+
+    NSUInteger bytes = 0;
+    NSUInteger nodes = 0;
+    for (NSString *md in documents) {
+        bytes += [md lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+        nodes += countNodes(md);
+    }
+
+    uint64_t allocationsBefore = atomic_load(&_allocationCount);
+    double startTime = now();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            [MarkdownParser clearCache];
+            for (NSString *md in documents) [MarkdownParser attributedStringWithMarkdown:md];
+        }
+    }
+    double time = now() - startTime;
+    uint64_t allocations = atomic_load(&_allocationCount) - allocationsBefore;
+    [MarkdownParser clearCache];
+
+    double totalBytes = (double)bytes * iterations;
+    double totalNodes = (double)nodes * iterations;
+    NSString *allocationsPerNode = _canCountAllocations ? [NSString stringWithFormat:@"%.1f", allocations / totalNodes] : @"n/a";
+    NSLog(@"Harness - %@: %lu docs, %lu bytes, %lu nodes | %.1f ns/byte | %@ allocations/node | peak memory %.1f MB",
+          name, (unsigned long)documents.count, (unsigned long)bytes, (unsigned long)nodes,
+          time / totalBytes * 1e9, allocationsPerNode, peakResidentBytes() / 1e6);
+}
+
+///
+/// Corpora
+///
+
+static void collectStringUnitValues(id object, NSMutableArray<NSString *> *values) {
+    if ([object isKindOfClass:[NSDictionary class]]) {
+        NSDictionary *dict = object;
+        NSString *value = dict[@"stringUnit"][@"value"];
+        if ([value isKindOfClass:[NSString class]]) [values addObject:value];
+        for (id child in dict.allValues) collectStringUnitValues(child, values);
+    } else if ([object isKindOfClass:[NSArray class]]) {
+        for (id child in object) collectStringUnitValues(child, values);
+    }
+}
+
+static NSArray<NSString *> *catalogCorpus(NSString *_Nullable catalogsPath) {
+
+    /// All values from the `Localizable.xcstrings` catalogs. By default we find them relative to this source file.
+
+    if (catalogsPath == nil) {
+        NSString *repoPath = [[[@(__FILE__) stringByDeletingLastPathComponent] stringByAppendingPathComponent:@"../../.."] stringByStandardizingPath];
+        catalogsPath = [repoPath stringByAppendingPathComponent:@"CLT/Mouse Fix Localizations"];
+    }
+    NSMutableArray<NSString *> *values = [NSMutableArray array];
+    NSDirectoryEnumerator<NSString *> *enumerator = [NSFileManager.defaultManager enumeratorAtPath:catalogsPath];
+    for (NSString *relativePath in enumerator) {
+        if (![relativePath.pathExtension isEqual:@"xcstrings"]) continue;
+        NSData *data = [NSData dataWithContentsOfFile:[catalogsPath stringByAppendingPathComponent:relativePath]];
+        id catalog = data ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+        collectStringUnitValues(catalog, values);
+    }
+    return values;
+}
+
+static NSArray<NSString *> *specCorpus(NSString *_Nullable specPath) {
+
+    /// The examples from the CommonMark spec. (See `commonMarkSpecExamples()` in the benchmarks for the format.)
+
+    if (specPath == nil) specPath = NSProcessInfo.processInfo.environment[@"MD_SPEC_PATH"];
+    NSString *spec = specPath ? [NSString stringWithContentsOfFile:specPath encoding:NSUTF8StringEncoding error:nil] : nil;
+    if (spec == nil) return @[];
+
+    NSMutableArray<NSString *> *result = [NSMutableArray array];
+    NSString *exampleStart = [[@"" stringByPaddingToLength:32 withString:@"`" startingAtIndex:0] stringByAppendingString:@" example"];
+    NSMutableString *example = nil;
+    for (NSString *line in [spec componentsSeparatedByString:@"\n"]) {
+        if ([line isEqual:exampleStart])                    example = [NSMutableString string];
+        else if (example != nil && [line isEqual:@"."])     { [result addObject:[example stringByReplacingOccurrencesOfString:@"→" withString:@"\t"]]; example = nil; }
+        else if (example != nil)                            [example appendFormat:@"%@\n", line];
+    }
+    return result;
+}
+
+static NSArray<NSString *> *largeListCorpus(void) {
+    NSMutableString *md = [NSMutableString string];
+    for (NSInteger i = 0; i < 10000; i++) {
+        if (i % 3 == 0) [md appendFormat:@"%ld. item with **bold** and a [link](https://macmousefix.com/%ld)\n", (long)(i + 1), (long)i];
+        else            [md appendFormat:@"%ld. plain item\n", (long)(i + 1)];
+        if (i % 10 == 0) [md appendString:@"   - nested *bullet*\n"];
+    }
+    return @[md];
+}
+
+static NSArray<NSString *> *deepNestingCorpus(void) {
+
+    /// Deeply nested emphasis, quotes and lists. These stress the node stack and the weight resolution.
+
+    NSMutableArray<NSString *> *result = [NSMutableArray array];
+    for (NSInteger depth = 10; depth <= 1000; depth *= 10) {
+        NSMutableString *emph = [NSMutableString string];
+        for (NSInteger i = 0; i < depth; i++) [emph appendString:(i % 2 ? @"*" : @"**")];
+        [emph appendString:@"deep"];
+        for (NSInteger i = depth - 1; i >= 0; i--) [emph appendString:(i % 2 ? @"*" : @"**")];
+        [result addObject:emph];
+
+        [result addObject:[[@"" stringByPaddingToLength:depth withString:@">" startingAtIndex:0] stringByAppendingString:@" quoted"]];
+
+        NSMutableString *list = [NSMutableString string];
+        for (NSInteger i = 0; i < MIN(depth, 100); i++) {
+            [list appendFormat:@"%@- level %ld\n", [@"" stringByPaddingToLength:i * 2 withString:@" " startingAtIndex:0], (long)i];
+        }
+        [result addObject:list];
+    }
+    return result;
+}
+
+static NSArray<NSString *> *filesCorpus(NSArray<NSString *> *paths) {
+    NSMutableArray<NSString *> *result = [NSMutableArray array];
+    for (NSString *path in paths) {
+        NSString *md = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:nil];
+        if (md != nil) [result addObject:md];
+        else NSLog(@"Harness - Couldn't read %@", path);
+    }
+    return result;
+}
+
+///
+/// Fuzzing
+///
+
+/// The input we're currently running. If it trips an assert, the SIGABRT handler writes it to stderr and to `kCrashFile`.
+static char *_currentInput;
+static size_t _currentInputLength;
+static const char *kCrashFile = "markdown_harness_crash.md";
+
+static void abortHandler(int sig) {
+
+    /// Only async-signal-safe calls in here.
+
+    static const char message[] = "\nHarness - Aborted while rendering this input (also written to markdown_harness_crash.md):\n";
+    write(STDERR_FILENO, message, sizeof(message) - 1);
+    if (_currentInput != NULL) {
+        write(STDERR_FILENO, _currentInput, _currentInputLength);
+        int fd = open(kCrashFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            write(fd, _currentInput, _currentInputLength);
+            close(fd);
+        }
+    }
+    write(STDERR_FILENO, "\n", 1);
+
+    /// Re-raise with the default handler, so we still crash normally
+    signal(SIGABRT, SIG_DFL);
+    raise(SIGABRT);
+}
+
+static void setCurrentInput(NSString *md) {
+    NSData *utf8 = [md dataUsingEncoding:NSUTF8StringEncoding allowLossyConversion:YES];
+    _currentInput = realloc(_currentInput, MAX(utf8.length, 1));
+    memcpy(_currentInput, utf8.bytes, utf8.length);
+    _currentInputLength = utf8.length;
+}
+
+static uint64_t nextRandom(uint64_t *state) {
+    /// xorshift64*
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+static NSString *mutate(NSString *md, NSArray<NSString *> *seeds, uint64_t *rng) {
+
+    static NSArray<NSString *> *tokens;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        tokens = @[
+            @"*", @"**", @"_", @"__", @"`", @"```\n", @"~~~", @"[", @"]", @"(", @")", @"](", @"![", @"<", @">", @"> ", @"<br>", @"<div>\n",
+            @"#", @"# ", @"###### ", @"---\n", @"***\n", @"- ", @"+ ", @"1. ", @"2) ", @"    ", @"\t", @"\n", @"\n\n", @"\r\n", @"\r", @"  \n",
+            @"\\", @"&amp;", @"&#0;", @"&#x1F42D;", @"[ref]: /url\n", @"[ref]", @"https://", @"\u0301", @"🐭", @"한", @"中文", @"\u200B", @"\uFEFF",
+        ];
+    });
+
+    NSMutableString *result = md.mutableCopy;
+    NSInteger mutations = 1 + nextRandom(rng) % 8;
+    for (NSInteger i = 0; i < mutations; i++) {
+        NSUInteger position = result.length ? nextRandom(rng) % (result.length + 1) : 0;
+        switch (nextRandom(rng) % 6) {
+            case 0: case 1: { /// Insert a token
+                [result insertString:tokens[nextRandom(rng) % tokens.count] atIndex:position];
+            } break;
+            case 2: { /// Delete a range
+                if (result.length == 0) break;
+                NSUInteger length = MIN(1 + nextRandom(rng) % 16, result.length - MIN(position, result.length));
+                [result deleteCharactersInRange:NSMakeRange(MIN(position, result.length), length)];
+            } break;
+            case 3: { /// Duplicate a range
+                if (result.length == 0) break;
+                NSUInteger start = nextRandom(rng) % result.length;
+                NSUInteger length = MIN(1 + nextRandom(rng) % 64, result.length - start);
+                [result insertString:[result substringWithRange:NSMakeRange(start, length)] atIndex:position];
+            } break;
+            case 4: { /// Splice in another seed
+                NSString *other = seeds[nextRandom(rng) % seeds.count];
+                [result insertString:other atIndex:position];
+            } break;
+            case 5: { /// Insert a random UTF-16 unit. Can produce unpaired surrogates.
+                unichar c = (unichar)(nextRandom(rng) % 0x10000);
+                [result insertString:[NSString stringWithCharacters:&c length:1] atIndex:position];
+            } break;
+        }
+    }
+    return result;
+}
+
+static NSInteger fuzz(NSArray<NSString *> *seeds, NSInteger iterations, uint64_t seed) {
+
+    /// Renders mutated inputs and checks some invariants. Asserts in the parser abort the process (see `abortHandler()`).
+    ///     Returns the number of failures.
+
+    if (seeds.count == 0) seeds = @[@""];
+    uint64_t rng = seed ?: 1;
+    NSInteger failures = 0;
+
+    struct sigaction action = { .sa_handler = abortHandler };
+    sigemptyset(&action.sa_mask);
+    struct sigaction previousAction;
+    sigaction(SIGABRT, &action, &previousAction);
+
+    double startTime = now();
+    for (NSInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+
+            NSString *md = mutate(seeds[nextRandom(&rng) % seeds.count], seeds, &rng);
+            setCurrentInput(md);
+
+            /// Render
+            MarkdownRenderOps *ops = [MarkdownParser renderOpsWithMarkdown:md];
+            NSAttributedString *result = [MarkdownParser attributedStringWithMarkdown:md];
+            NSAttributedString *carried = [MarkdownParser attributedStringWithAttributedMarkdown:[[NSAttributedString alloc] initWithString:md]];
+
+            /// Check
+            Boolean ok = ops != nil && result != nil && carried != nil
+                && [result.string isEqualToString:ops.text]
+                && [carried.string isEqualToString:ops.text]
+                && [[MarkdownRenderOps renderOpsWithSerializedData:ops.serializedData] isEqual:ops];
+            if (!ok) {
+                failures += 1;
+                if (failures <= 10) NSLog(@"Harness - Fuzz failure #%ld for input: %@", (long)failures, md.debugDescription);
+            }
+
+            /// Don't let the cache grow our memory use or hide work
+            if (i % 256 == 0) [MarkdownParser clearCache];
+        }
+    }
+
+    sigaction(SIGABRT, &previousAction, NULL);
+    free(_currentInput);
+    _currentInput = NULL;
+
+    NSLog(@"Harness - Fuzzed %ld inputs (seed %llu) in %.1f s, %ld failures", (long)iterations, (unsigned long long)seed, now() - startTime, (long)failures);
+    return failures;
+}
+
+///
+/// Entry point
+///
+
+@implementation MarkdownParserHarness
+
+int runMarkdownParserHarness(int argc, const char *argv[]) {
+
+    @autoreleasepool {
+
+        /// Parse arguments
+        NSInteger iterations = 20;
+        NSInteger fuzzIterations = 10000;
+        uint64_t seed = (uint64_t)time(NULL);
+        NSString *specPath = nil;
+        NSString *catalogsPath = nil;
+        NSMutableArray<NSString *> *files = [NSMutableArray array];
+        for (int i = 0; i < argc; i++) {
+            Boolean hasValue = i + 1 < argc;
+            if      (hasValue && strcmp(argv[i], "--iterations") == 0)  iterations = atol(argv[++i]);
+            else if (hasValue && strcmp(argv[i], "--fuzz") == 0)        fuzzIterations = atol(argv[++i]);
+            else if (hasValue && strcmp(argv[i], "--seed") == 0)        seed = strtoull(argv[++i], NULL, 10);
+            else if (hasValue && strcmp(argv[i], "--spec") == 0)        specPath = @(argv[++i]);
+            else if (hasValue && strcmp(argv[i], "--catalogs") == 0)    catalogsPath = @(argv[++i]);
+            else                                                        [files addObject:@(argv[i])];
+        }
+
+        NSArray<NSString *> *catalogs = catalogCorpus(catalogsPath);
+        NSArray<NSString *> *spec = specCorpus(specPath);
+        NSArray<NSString *> *deep = deepNestingCorpus();
+        NSArray<NSString *> *largeList = largeListCorpus();
+        NSArray<NSString *> *extraFiles = filesCorpus(files);
+
+        /// Measure
+        startCountingAllocations();
+        if (!_canCountAllocations) NSLog(@"Harness - Can't count allocations on this platform");
+        measureCorpus(@"catalogs", catalogs, iterations);
+        measureCorpus(@"spec", spec, iterations);
+        measureCorpus(@"deep nesting", deep, iterations);
+        measureCorpus(@"large list", largeList, iterations);
+        measureCorpus(@"files", extraFiles, iterations);
+        stopCountingAllocations();
+
+        /// Fuzz
+        NSMutableArray<NSString *> *seeds = [NSMutableArray array];
+        [seeds addObjectsFromArray:catalogs];
+        [seeds addObjectsFromArray:spec];
+        [seeds addObjectsFromArray:deep];
+        NSInteger failures = fuzz(seeds, fuzzIterations, seed);
+
+        return failures == 0 ? 0 : 1;
+    }
+}
+
+@end
+
+#if MD_HARNESS_MAIN
+
+int main(int argc, const char *argv[]) {
+
+    /// Standalone harness. (Only defined when building with the `GNUmakefile`, since the app and the CLT have their own `main`.)
+
+    @autoreleasepool {
+        #if GNUSTEP
+            [NSApplication sharedApplication]; /// Loads the GNUstep backend, which we need for fonts
+        #endif
+    }
+    return runMarkdownParserHarness(argc - 1, argv + 1);
+}
+
+#endif
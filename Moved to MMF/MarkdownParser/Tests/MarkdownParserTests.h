@@ -0,0 +1,18 @@
+//
+//  MarkdownParserTests.h
+//  objc-test-july-13-2024
+//
+//  Created by Noah Nübling on 18.10.26.
+//
+
+#import <Foundation/Foundation.h>
+
+@interface MarkdownParserTests : NSObject
+
+void markdownparser_incremental_tests(void);
+void markdownparser_renderops_tests(void);
+void markdownparser_precompiled_tests(void);
+void markdownparser_sourcemap_tests(void);
+void markdownparser_blockops_tests(void);
+
+@end
@@ -0,0 +1,305 @@
+//
+//  MarkdownParserTests.m
+//  objc-test-july-13-2024
+//
+//  Created by Noah Nübling on 18.10.26.
+//
+
+#import "MarkdownParserTests.h"
+#import "MarkdownParser.h"
+#import "MarkdownPrecompiledStrings.h"
+#import "AppKit/AppKit.h"
+
+@implementation MarkdownParserTests
+
+static Boolean checkEdit(MarkdownIncrementalParser *parser, NSTextStorage *storage, NSString *md, NSRange replacedRange, NSString *replacement) {
+    
+    /// Applies an edit to `md` through the incremental parser and checks that the result is the same as a full parse of the edited markdown.
+    
+    NSString *newMd = [md stringByReplacingCharactersInRange:replacedRange withString:replacement];
+    NSRange editedRange = NSMakeRange(replacedRange.location, replacement.length);
+    NSInteger delta = (NSInteger)replacement.length - (NSInteger)replacedRange.length;
+    
+    parser.markdown = md;
+    [parser updateMarkdown:newMd editedRange:editedRange changeInLength:delta];
+    
+    NSAttributedString *expected = [MarkdownParser attributedStringWithMarkdown:newMd];
+    Boolean ok = [storage isEqualToAttributedString:expected];
+    if (!ok) {
+        NSLog(@"MarkdownParser: IncrementalTests: Mismatch after replacing %@ with '%@'\n--- incremental:\n%@\n--- full:\n%@", NSStringFromRange(replacedRange), replacement, storage.string, expected.string);
+    }
+    return ok;
+}
+
+void markdownparser_incremental_tests(void) {
+    
+    /// Replays a bunch of edits against a small document and compares the incremental result with a full parse after each one.
+    
+    #define mflog(msg...) NSLog(@"MarkdownParser: IncrementalTests: " msg)
+    
+    NSString *md =
+        @"First paragraph with **bold** text\n"
+        @"and a softbreak.\n"
+        @"\n"
+        @"- first item\n"
+        @"- second *item*\n"
+        @"\n"
+        @"Middle paragraph with a [link](https://google.com)\n"
+        @"\n"
+        @"1. numbered\n"
+        @"2. another\n"
+        @"\n"
+        @"Last paragraph";
+    
+    NSTextStorage *storage = [[NSTextStorage alloc] init];
+    MarkdownIncrementalParser *parser = [[MarkdownIncrementalParser alloc] initWithTextStorage:storage];
+    
+    NSInteger failures = 0;
+    NSInteger edits = 0;
+    
+    /// Insert / delete a character at every position
+    for (NSUInteger i = 0; i <= md.length; i++) {
+        failures += !checkEdit(parser, storage, md, NSMakeRange(i, 0), @"x"); edits++;
+        if (i < md.length) {
+            failures += !checkEdit(parser, storage, md, NSMakeRange(i, 1), @""); edits++;
+        }
+    }
+    
+    /// Edits that change the block structure
+    NSRange firstBlankLine = [md rangeOfString:@"\n\n"];
+    failures += !checkEdit(parser, storage, md, NSMakeRange(firstBlankLine.location, 2), @"\n");           edits++; /// Merge paragraph and list
+    failures += !checkEdit(parser, storage, md, NSMakeRange(firstBlankLine.location, 0), @"\n\n");         edits++; /// Split paragraph
+    failures += !checkEdit(parser, storage, md, NSMakeRange(md.length, 0), @"\n\n- trailing item");        edits++; /// Append list
+    failures += !checkEdit(parser, storage, md, NSMakeRange(0, 0), @"- leading item\n\n");                 edits++; /// Prepend list
+    failures += !checkEdit(parser, storage, md, NSMakeRange(0, md.length), @"");                           edits++; /// Delete everything
+    failures += !checkEdit(parser, storage, md, NSMakeRange(0, [md rangeOfString:@"- first"].location), @""); edits++; /// Delete first block
+    failures += !checkEdit(parser, storage, md, [md rangeOfString:@"Middle"], @"- Middle");                edits++; /// Turn paragraph into list item
+    failures += !checkEdit(parser, storage, md, [md rangeOfString:@"1. numbered"], @"   numbered");        edits++; /// Turn list item into paragraph continuation
+    
+    /// Link reference definitions
+    ///     These affect blocks outside the re-parsed window. "]:" in prose or code shouldn't matter.
+    NSString *refMd = @"See [docs][] and Note[1]: not a definition.\n\nSome `a]: b` code\n\nEnd";
+    failures += !checkEdit(parser, storage, refMd, NSMakeRange(refMd.length, 0), @"\n\n[docs]: https://macmousefix.com"); edits++; /// Add definition
+    failures += !checkEdit(parser, storage, refMd, NSMakeRange(refMd.length, 0), @"\n\n> - [docs]:\n>   https://macmousefix.com"); edits++; /// Add nested definition
+    failures += !checkEdit(parser, storage, refMd, [refMd rangeOfString:@"End"], @"[docs\nlabel]: /url"); edits++; /// Label over two lines
+    NSString *definedMd = [refMd stringByAppendingString:@"\n\n[docs]: https://macmousefix.com"];
+    failures += !checkEdit(parser, storage, definedMd, [definedMd rangeOfString:@"[docs]: "], @"");       edits++; /// Break definition
+    failures += !checkEdit(parser, storage, definedMd, NSMakeRange(0, 0), @"x");                         edits++;
+    
+    /// Edits from an empty document
+    failures += !checkEdit(parser, storage, @"", NSMakeRange(0, 0), @"a");                                 edits++;
+    failures += !checkEdit(parser, storage, @"", NSMakeRange(0, 0), md);                                   edits++;
+    
+    mflog("%ld edits, %ld failures", (long)edits, (long)failures);
+    assert(failures == 0);
+    
+    #undef mflog
+}
+
+void markdownparser_renderops_tests(void) {
+    
+    /// Checks that render ops survive serialization, and that styling them gives the same result as the direct API.
+    
+    #define mflog(msg...) NSLog(@"MarkdownParser: RenderOpsTests: " msg)
+    
+    NSArray<NSString *> *inputs = @[
+        @"",
+        @"Plain text",
+        @"Some **bold** and *emphasised* text with a [**nested** link](https://google.com)\nand a softbreak.",
+        @"***both***, **outer *inner* outer** and *outer **inner** outer*",
+        @"- first item\n- second *item*\n\n1. numbered\n2. another",
+        @"Ünïcödé 🐭 with **bold 🐭** and a [link 🐭](https://macmousefix.com)",
+        @"# Heading **bold**\n\n> quote\n> > nested\n\n`code` and ![image](https://example.com/a.png)\n\n---\n\n```\nblock\n```\n<b>html</b>",
+        @"![a](<b c>) and [link](<with spaces>)", /// Destinations that aren't valid URLs
+    ];
+    
+    NSInteger failures = 0;
+    for (NSString *md in inputs) {
+        
+        [MarkdownParser clearCache];
+        MarkdownRenderOps *ops = [MarkdownParser renderOpsWithMarkdown:md];
+        
+        /// Round trip
+        MarkdownRenderOps *decoded = [MarkdownRenderOps renderOpsWithSerializedData:ops.serializedData];
+        if (![decoded isEqual:ops]) {
+            mflog("Serialization round trip failed for '%@'. Before: %@, after: %@", md, ops, decoded);
+            failures += 1;
+        }
+        
+        /// Styling
+        NSAttributedString *styled = [MarkdownParser attributedStringWithRenderOps:decoded styleSheet:MarkdownStyleSheet.defaultStyleSheet];
+        NSAttributedString *direct = [MarkdownParser attributedStringWithMarkdown:md];
+        if (![styled isEqualToAttributedString:direct]) {
+            mflog("Styled ops differ from direct result for '%@'", md);
+            failures += 1;
+        }
+    }
+    
+    /// Malformed data
+    NSData *valid = [MarkdownParser renderOpsWithMarkdown:inputs[2]].serializedData;
+    for (NSUInteger len = 0; len < valid.length; len++) {
+        if ([MarkdownRenderOps renderOpsWithSerializedData:[valid subdataWithRange:NSMakeRange(0, len)]] != nil) {
+            mflog("Accepted truncated data (%lu of %lu bytes)", (unsigned long)len, (unsigned long)valid.length);
+            failures += 1;
+            break;
+        }
+    }
+    
+    mflog("%lu inputs, %ld failures", (unsigned long)inputs.count, (long)failures);
+    assert(failures == 0);
+    
+    #undef mflog
+}
+
+void markdownparser_precompiled_tests(void) {
+    
+    /// Checks that strings from a precompiled blob are the same as parsing them directly, and that lookups find the right entry.
+    
+    #define mflog(msg...) NSLog(@"MarkdownParser: PrecompiledTests: " msg)
+    
+    NSDictionary<NSString *, NSDictionary<NSString *, NSString *> *> *markdown = @{
+        @"en": @{
+            @"intro": @"Some **bold** and a [link](https://macmousefix.com)",
+            @"empty": @"",
+            @"list|plural.one": @"- one *item*",
+        },
+        @"de": @{
+            @"intro": @"Etwas **Fettes** und ein [Link](https://macmousefix.com)",
+        },
+        @"zh-Hans": @{
+            @"intro": @"一些**粗体**文字",
+        },
+    };
+    
+    NSMutableDictionary *renderOps = [NSMutableDictionary dictionary];
+    for (NSString *locale in markdown) {
+        NSMutableDictionary *opsByKey = [NSMutableDictionary dictionary];
+        for (NSString *key in markdown[locale]) opsByKey[key] = [MarkdownParser renderOpsWithMarkdown:markdown[locale][key]];
+        renderOps[locale] = opsByKey;
+    }
+    NSData *blob = [MarkdownPrecompiledStrings dataWithRenderOps:renderOps];
+    MarkdownPrecompiledStrings *strings = [[MarkdownPrecompiledStrings alloc] initWithData:blob];
+    
+    NSInteger failures = 0;
+    
+    /// Lookups
+    for (NSString *locale in markdown) {
+        for (NSString *key in markdown[locale]) {
+            NSAttributedString *loaded = [strings attributedStringForKey:key locale:locale];
+            NSAttributedString *direct = [MarkdownParser attributedStringWithMarkdown:markdown[locale][key]];
+            if (![loaded isEqualToAttributedString:direct]) {
+                mflog("Loaded string differs for %@ / %@", locale, key);
+                failures += 1;
+            }
+        }
+    }
+    
+    /// Missing entries
+    if ([strings renderOpsForKey:@"intro" locale:@"fr"] != nil || [strings renderOpsForKey:@"missing" locale:@"en"] != nil) {
+        mflog("Found an entry that doesn't exist");
+        failures += 1;
+    }
+    
+    /// Locale fallback
+    struct { NSArray<NSString *> *preferred; NSString *expected; } fallbacks[] = {
+        { @[@"de_DE"],               @"de" },
+        { @[@"zh-Hans-CN"],          @"zh-Hans" },
+        { @[@"fr", @"en-GB"],        @"en" },
+        { @[@"zh-Hant", @"de"],      @"de" },   /// `zh` isn't in the blob, so `zh-Hant` doesn't match `zh-Hans`
+        { @[@"fr"],                  nil },
+    };
+    for (size_t i = 0; i < sizeof(fallbacks) / sizeof(fallbacks[0]); i++) {
+        MarkdownRenderOps *ops = [strings renderOpsForKey:@"intro" preferredLocales:fallbacks[i].preferred];
+        MarkdownRenderOps *expected = fallbacks[i].expected ? [strings renderOpsForKey:@"intro" locale:fallbacks[i].expected] : nil;
+        if (!(ops == expected || [ops isEqual:expected])) {
+            mflog("Wrong fallback for %@ (expected %@)", fallbacks[i].preferred, fallbacks[i].expected);
+            failures += 1;
+        }
+    }
+    
+    /// Malformed blobs
+    for (NSUInteger len = 0; len < blob.length; len++) {
+        if ([[MarkdownPrecompiledStrings alloc] initWithData:[blob subdataWithRange:NSMakeRange(0, len)]] != nil) {
+            mflog("Accepted truncated blob (%lu of %lu bytes)", (unsigned long)len, (unsigned long)blob.length);
+            failures += 1;
+            break;
+        }
+    }
+    
+    mflog("%lu entries, %ld failures", (unsigned long)strings.count, (long)failures);
+    assert(failures == 0);
+    
+    #undef mflog
+}
+
+void markdownparser_sourcemap_tests(void) {
+    
+    /// Attributed markdown on inputs where the source map or the search fallback doesn't line up with the node text. These used to hit asserts.
+    
+    #define mflog(msg...) NSLog(@"MarkdownParser: SourceMapTests: " msg)
+    
+    unichar loneSurrogate[] = { 'a', 0xD800, 'b', ' ', '*', '*', 'c', '*', '*' };
+    NSArray<NSString *> *inputs = @[
+        @"Caf&eacute; and Cafe\u0301", /// Entity -> precomposed "é", search finds the decomposed one
+        @"Cafe\u0301 **bold** and Caf\u00e9",
+        [NSString stringWithCharacters:loneSurrogate length:sizeof(loneSurrogate) / sizeof(unichar)], /// Lossy UTF-8 encoding -> byte table doesn't add up
+        @"Escaped \\*stars\\* and &amp; entities",
+    ];
+    
+    NSInteger failures = 0;
+    for (NSString *md in inputs) {
+        NSAttributedString *src = [[NSAttributedString alloc] initWithString:md attributes:@{ NSForegroundColorAttributeName: NSColor.systemRedColor }];
+        NSAttributedString *result = [MarkdownParser attributedStringWithAttributedMarkdown:src];
+        NSAttributedString *plain = [MarkdownParser attributedStringWithMarkdown:md];
+        if (![result.string isEqual:plain.string]) {
+            mflog("Text differs for '%@': '%@' vs '%@'", md, result.string, plain.string);
+            failures += 1;
+        }
+    }
+    
+    mflog("%lu inputs, %ld failures", (unsigned long)inputs.count, (long)failures);
+    assert(failures == 0);
+    
+    #undef mflog
+}
+
+void markdownparser_blockops_tests(void) {
+    
+    /// Heading and block quote ops should cover the block's own text, not the double linebreak that separates it from the block before it.
+    
+    #define mflog(msg...) NSLog(@"MarkdownParser: BlockOpsTests: " msg)
+    
+    NSArray<NSArray *> *cases = @[ /// Markdown, op kind, text the op should cover
+        @[@"# First",                       @(MDRenderOpKindHeading),    @"First"],
+        @[@"Intro\n\n# Heading",            @(MDRenderOpKindHeading),    @"Heading"],
+        @[@"- item\n\n## Sub **bold**",     @(MDRenderOpKindHeading),    @"Sub bold"],
+        @[@"Intro\n\n> quote",              @(MDRenderOpKindBlockQuote), @"quote"],
+        @[@"Intro\n\n> first\n>\n> second", @(MDRenderOpKindBlockQuote), @"first\n\nsecond"],
+    ];
+    
+    NSInteger failures = 0;
+    for (NSArray *c in cases) {
+        NSString *md = c[0];
+        MDRenderOpKind kind = [c[1] unsignedIntValue];
+        NSString *expected = c[2];
+        
+        MarkdownRenderOps *ops = [MarkdownParser renderOpsWithMarkdown:md];
+        NSString *covered = nil;
+        for (size_t i = 0; i < ops.opCount; i++) {
+            if (ops.ops[i].kind != kind) continue;
+            covered = [ops.text substringWithRange:NSMakeRange(ops.ops[i].location, ops.ops[i].length)];
+            break;
+        }
+        if (![covered isEqual:expected]) {
+            mflog("Op for '%@' covers '%@', expected '%@'", md, covered, expected);
+            failures += 1;
+        }
+    }
+    
+    mflog("%lu cases, %ld failures", (unsigned long)cases.count, (long)failures);
+    assert(failures == 0);
+    
+    #undef mflog
+}
+
+@end
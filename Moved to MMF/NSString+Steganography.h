@@ -12,7 +12,9 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+#ifndef MF_SWIFT_UNBRIDGED /// NSString+Additions.h defines this, too
 #define MF_SWIFT_UNBRIDGED(args...) args
+#endif
 
 @interface NSAttributedString (MFSteganography)
 
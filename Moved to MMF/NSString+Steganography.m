@@ -8,6 +8,7 @@
 //
 
 #import "NSString+Steganography.h"
+#import "NSString+Additions.h"
 #import "BiMap.h"
 
 #if IS_MAIN_APP
@@ -92,7 +93,7 @@ typedef NS_ENUM(UTF32Char, MFZeroWidthCharacter) {
                         "\u200B\u200D\u200B\u200C\u200B";       /// End sequence
     
     NSRegularExpressionOptions expressionOptions = 0;
-    NSRegularExpression *expression = [NSRegularExpression regularExpressionWithPattern:pattern options:expressionOptions error:nil];
+    NSRegularExpression *expression = cachedRegularExpression(pattern, expressionOptions); /// Compiled once, not on every call
     NSMatchingOptions matchingOptions = 0;
     NSArray<NSTextCheckingResult *> *matches = [expression matchesInString:self options:matchingOptions range:NSMakeRange(0, self.length)];
     
@@ -353,7 +354,7 @@ typedef NS_ENUM(UTF32Char, MFZeroWidthCharacter) {
     /// Finds secret messages in the string.
     NSString *pattern = @"(?:\u200b[\u200c\u200d]{8})*\u200b"; /// Matches packets of 8 200c or 200d chars surrounded by 200b chars.
     NSRegularExpressionOptions expressionOptions = 0;
-    NSRegularExpression *expression = [NSRegularExpression regularExpressionWithPattern:pattern options:expressionOptions error:nil];
+    NSRegularExpression *expression = cachedRegularExpression(pattern, expressionOptions); /// Compiled once, not on every call
     NSMatchingOptions matchingOptions = 0;
     NSArray<NSTextCheckingResult *> *matches = [expression matchesInString:self options:matchingOptions range:NSMakeRange(0, self.length)];
     